@@ -25,6 +25,7 @@
 
 #include <qwt_scale_draw.h>
 #include <qwt_legend.h>
+#include "trace.hpp"
 #include <QColor>
 #include <cmath>
 #include <iostream>
@@ -162,6 +163,7 @@ TimeDomainDisplayPlot::TimeDomainDisplayPlot(QWidget* parent, unsigned int xNumD
   d_sample_rate = 1;
   d_data_starting_point = 0.0;
   d_curves_hidden = false;
+  d_first_replot = true;
   d_nbPtsXAxis = 0;
 
   d_nb_ref_curves = 0;
@@ -448,7 +450,14 @@ TimeDomainDisplayPlot::plotNewData(const std::string &sender,
 //        }
 //      }
 
-      replot();
+      // The first frame ends the connect-to-usable time of the startup trace
+      if (d_first_replot) {
+        TRACE_SCOPE("TimeDomainDisplayPlot: first replot");
+        replot();
+        d_first_replot = false;
+      } else {
+        replot();
+      }
 
       Q_EMIT newData();
 
@@ -1038,26 +1047,27 @@ void TimeDomainDisplayPlot::unregisterReferenceWaveform(QString name)
 void TimeDomainDisplayPlot::addPreview(QVector<QVector<double> > curvesToBePreviewed, double reftimebase,
 				       double timebase, double timeposition)
 {
-	d_preview_ydata.resize(curvesToBePreviewed[0].size());
-	for (int i = 0; i < curvesToBePreviewed.size(); ++i) {
-		for (int j = 0; j < curvesToBePreviewed[i].size(); ++j) {
-			d_preview_ydata[j].push_back(curvesToBePreviewed[i][j]);
-		}
+	/* One vector of samples per curve */
+	d_preview_ydata = curvesToBePreviewed;
+
+	if (d_preview_ydata.isEmpty()) {
+		return;
 	}
 
+	const int nr_of_samples = d_preview_ydata[0].size();
 
 	double mid_point_on_screen = (timebase * 8) - ((
 						timebase * 8) - timeposition);
 	double x_axis_step_size = (reftimebase /
-				   (curvesToBePreviewed.size() / xAxisNumDiv()));
+				   (nr_of_samples / xAxisNumDiv()));
 
 	QVector<double> xData;
-	for (int i = -(curvesToBePreviewed.size() / 2); i < (curvesToBePreviewed.size() / 2);
+	for (int i = -(nr_of_samples / 2); i < (nr_of_samples / 2);
 	     ++i) {
 		xData.push_back(mid_point_on_screen + ((double)i * x_axis_step_size));
 	}
 
-	for (int i = 0; i < curvesToBePreviewed[0].size(); ++i) {
+	for (int i = 0; i < d_preview_ydata.size(); ++i) {
 		QwtPlotCurve *curve = new QwtPlotCurve();
 		curve->setSamples(xData, d_preview_ydata[i]);
 
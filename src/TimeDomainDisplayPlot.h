@@ -224,6 +224,7 @@ private:
 
   unsigned int d_nbPtsXAxis;
   bool d_curves_hidden;
+  bool d_first_replot;
 
   QColor getChannelColor();
 
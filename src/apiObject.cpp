@@ -18,6 +18,7 @@
  */
 
 #include "apiObject.hpp"
+#include "trace.hpp"
 
 #include <QDebug>
 #include <QJSEngine>
@@ -25,6 +26,10 @@
 #include <QMetaProperty>
 #include <QSettings>
 
+#include <qwt_series_data.h>
+
+#include <cstring>
+
 using namespace adiscope;
 
 ApiObject::ApiObject() : QObject(nullptr)
@@ -35,6 +40,27 @@ ApiObject::~ApiObject()
 {
 }
 
+QByteArray ApiObject::arrayBuffer(const QwtSeriesData<QPointF> *data, bool x)
+{
+	const size_t size = data ? data->size() : 0;
+	double *values;
+	QByteArray buffer = arrayBuffer(size, values);
+
+	/* Curves drawn from the buffers of a plot are copied at once */
+	auto raw = dynamic_cast<const QwtCPointerData *>(data);
+
+	if (raw) {
+		memcpy(values, x ? raw->xData() : raw->yData(),
+		       size * sizeof(double));
+		return buffer;
+	}
+
+	for (size_t i = 0; i < size; ++i)
+		values[i] = x ? data->sample(i).x() : data->sample(i).y();
+
+	return buffer;
+}
+
 template <typename T> void ApiObject::save(QSettings& settings,
 		const QString& prop, const QList<T>& list)
 {
@@ -188,6 +214,8 @@ void ApiObject::save_nogroup(ApiObject *obj, QSettings& settings)
 
 void ApiObject::load(QSettings& settings)
 {
+	TRACE_SCOPE("ApiObject::load " + objectName());
+
 	settings.beginGroup(objectName());
 
 	load_nogroup(this, settings);
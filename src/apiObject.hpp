@@ -20,11 +20,14 @@
 #ifndef APIOBJECT_HPP
 #define APIOBJECT_HPP
 
+#include <QByteArray>
 #include <QObject>
 
 class QJSEngine;
+class QPointF;
 class QSettings;
 template <typename T> class QList;
+template <typename T> class QwtSeriesData;
 
 namespace adiscope {
 	class ApiObject : public QObject
@@ -46,6 +49,26 @@ namespace adiscope {
 
 		void js_register(QJSEngine *engine);
 
+	protected:
+		/*
+		 * The script engine exposes a QByteArray as an ArrayBuffer
+		 * sharing its memory, which scripts read through a typed
+		 * array, e.g. new Float64Array(channel.data_buffer).
+		 * The values are written through the returned pointer.
+		 */
+		template <typename T>
+		static QByteArray arrayBuffer(size_t count, T *&values)
+		{
+			QByteArray buffer(count * sizeof(T), Qt::Uninitialized);
+
+			values = reinterpret_cast<T *>(buffer.data());
+			return buffer;
+		}
+
+		/* The X or Y values of a curve, as doubles */
+		static QByteArray arrayBuffer(const QwtSeriesData<QPointF> *data,
+				bool x = false);
+
 	private:
 		template <typename T> void save(QSettings& settings,
 				const QString& prop, const QList<T>& list);
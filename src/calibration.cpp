@@ -27,8 +27,15 @@
 #include <QtGlobal>
 #include <iio.h>
 #include <QThread>
+#include <QDateTime>
+#include <QSettings>
 
 #include "calibration_api.hpp"
+#include "trace.hpp"
+
+/* A cached calibration is redone past these limits */
+#define CALIB_CACHE_MAX_TEMP_DRIFT	5.0	/* degrees Celsius */
+#define CALIB_CACHE_MAX_AGE		(24 * 3600)	/* seconds */
 
 using namespace adiscope;
 
@@ -495,81 +502,155 @@ bool Calibration::adc_data_capture(int16_t *dataCh0, int16_t *dataCh1,
 	return true;
 }
 
+bool Calibration::capture_offset_averages(struct iio_buffer *buffer,
+	int16_t offset0, int16_t offset1, double& avg0, double& avg1)
+{
+	iio_channel_attr_write_longlong(m_ad5625_channel2, "raw", offset0);
+	iio_channel_attr_write_longlong(m_ad5625_channel3, "raw", offset1);
+
+	// Allow some time for the voltage to settle
+	QThread::msleep(5);
+
+	int ret = iio_buffer_refill(buffer);
+
+	if (ret < 0) {
+		qDebug(CAT_CALIBRATION) << "Could not refill m2k-adc buffer! Error:" << ret;
+		return false;
+	}
+
+	// Both channels are averaged in place, in the same pass
+	ptrdiff_t p_inc = iio_buffer_step(buffer);
+	uintptr_t p_dat;
+	uintptr_t p_end = (uintptr_t)iio_buffer_end(buffer);
+	int64_t sum0 = 0, sum1 = 0;
+	size_t n = 0;
+
+	for (p_dat = (uintptr_t)iio_buffer_first(buffer, m_adc_channel0);
+			p_dat < p_end; p_dat += p_inc, n++) {
+		sum0 += ((int16_t*)p_dat)[0];
+		sum1 += ((int16_t*)p_dat)[1];
+	}
+
+	if (!n)
+		return false;
+
+	avg0 = (double)sum0 / n;
+	avg1 = (double)sum1 / n;
+
+	return true;
+}
+
+int16_t Calibration::fit_offset(int16_t low, double avgLow, int16_t high,
+	double avgHigh, int16_t center, size_t span)
+{
+	// The average is a linear function of the DAC code; find its zero
+	const double slope = (avgHigh - avgLow) / (high - low);
+
+	if (slope == 0.0)
+		return center;
+
+	const double zero = low - avgLow / slope;
+	const double min = center - (double)(span / 2);
+	const double max = center + (double)(span / 2);
+
+	return (int16_t)qRound(qBound(min, zero, max));
+}
+
 bool Calibration::fine_tune(size_t span, int16_t centerVal0, int16_t centerVal1,
 	size_t num_samples)
 {
-	int16_t *candidateOffsets0 = new int16_t[span + 1];
-	int16_t *candidateOffsets1 = new int16_t[span + 1];
-	double *averagesCh0 = new double[span + 1];
-	double *averagesCh1 = new double[span + 1];
-	double minAvg0, minAvg1;
-	int16_t *dataCh0 = new int16_t[num_samples];
-	int16_t *dataCh1 = new int16_t[num_samples];
-	int16_t offset0, offset1;
-	size_t i, i0 = 0, i1 = 0;
-	bool ret = true;
-
-	offset0 = centerVal0 - span / 2;
-	offset1 = centerVal1 - span / 2;
-	for (i = 0; i < span + 1; i++) {
-		candidateOffsets0[i] = offset0;
-		candidateOffsets1[i] = offset1;
-		iio_channel_attr_write_double(m_ad5625_channel2, "raw",
-			offset0);
-		iio_channel_attr_write_double(m_ad5625_channel3, "raw",
-			offset1);
-		offset0++;
-		offset1++;
-
-		// Allow some time for the voltage to settle
-		QThread::msleep(5);
-
-		ret = adc_data_capture(dataCh0, dataCh1, num_samples);
+	bool channel0Enabled = iio_channel_is_enabled(m_adc_channel0);
+	bool channel1Enabled = iio_channel_is_enabled(m_adc_channel1);
+	int16_t low0 = centerVal0 - span / 2, high0 = centerVal0 + span / 2;
+	int16_t low1 = centerVal1 - span / 2, high1 = centerVal1 + span / 2;
+	double avgLow0, avgLow1, avgHigh0, avgHigh1;
+	double minAvg0 = 0, minAvg1 = 0;
+	int16_t offset0, offset1, best0, best1;
+	bool ret = false;
+
+	setChannelEnableState(m_adc_channel0, true);
+	setChannelEnableState(m_adc_channel1, true);
+
+	// The block is queued, and filled, as soon as the buffer is created:
+	// the first offsets have to be in place and settled before that
+	iio_channel_attr_write_longlong(m_ad5625_channel2, "raw", low0);
+	iio_channel_attr_write_longlong(m_ad5625_channel3, "raw", low1);
+	QThread::msleep(5);
+
+	// A single kernel block: each refill holds samples captured after
+	// the new offsets were written. The count only applies to the
+	// buffer being created, so the default is restored right away.
+	iio_device_set_kernel_buffers_count(m_m2k_adc, 1);
+	struct iio_buffer *buffer = iio_device_create_buffer(m_m2k_adc,
+		num_samples, false);
+	iio_device_set_kernel_buffers_count(m_m2k_adc, 4);
 
-		if (!ret) {
-			qDebug(CAT_CALIBRATION) << "failed to get samples";
-			goto out_cleanup;
-		}
+	if (!buffer) {
+		qDebug(CAT_CALIBRATION) << "Could not create m2k-adc buffer!" <<
+			strerror(errno) << "Aborting calibration.";
+		goto out_restore;
+	}
 
-		averagesCh0[i] = qAbs(average(dataCh0, num_samples));
-		averagesCh1[i] = qAbs(average(dataCh1, num_samples));
+	// Two points at the ends of the range give the line of each channel
+	if (!capture_offset_averages(buffer, low0, low1, avgLow0, avgLow1) ||
+			!capture_offset_averages(buffer, high0, high1,
+						 avgHigh0, avgHigh1)) {
+		qDebug(CAT_CALIBRATION) << "failed to get samples";
+		goto out_cleanup;
 	}
 
-	minAvg0 = qAbs(averagesCh0[0]);
-	minAvg1 = qAbs(averagesCh1[0]);
+	offset0 = fit_offset(low0, avgLow0, high0, avgHigh0, centerVal0, span);
+	offset1 = fit_offset(low1, avgLow1, high1, avgHigh1, centerVal1, span);
+
+	// The fitted code and its neighbours absorb the rounding and the
+	// noise of the fit; the one closest to zero is kept
+	best0 = offset0;
+	best1 = offset1;
+
+	for (int d = -1; d <= 1; d++) {
+		double avg0, avg1;
 
-	for (i = 1; i < span + 1; i++) {
-		if (averagesCh0[i] < minAvg0) {
-			minAvg0 = averagesCh0[i];
-			i0 = i;
+		if (!capture_offset_averages(buffer, offset0 + d, offset1 + d,
+					     avg0, avg1)) {
+			qDebug(CAT_CALIBRATION) << "failed to get samples";
+			goto out_cleanup;
+		}
+
+		if (d == -1 || qAbs(avg0) < minAvg0) {
+			minAvg0 = qAbs(avg0);
+			best0 = offset0 + d;
 		}
-		if (averagesCh1[i] < minAvg1) {
-			minAvg1 = averagesCh1[i];
-			i1 = i;
+		if (d == -1 || qAbs(avg1) < minAvg1) {
+			minAvg1 = qAbs(avg1);
+			best1 = offset1 + d;
 		}
 	}
 
-	setCalibrationMode(NONE);
+	ret = true;
 
-	m_adc_ch0_offset = candidateOffsets0[i0];
-	m_adc_ch1_offset = candidateOffsets1[i1];
+	m_adc_ch0_offset = best0;
+	m_adc_ch1_offset = best1;
 
 	qDebug(CAT_CALIBRATION) << "After Fine-Tunning";
 	qDebug(CAT_CALIBRATION) << "ADC channel 0 offset(raw):" << m_adc_ch0_offset;
 	qDebug(CAT_CALIBRATION) << "ADC channel 1 offset(raw):" << m_adc_ch1_offset;
 
-	iio_channel_attr_write_longlong(m_ad5625_channel2, "raw",
-		m_adc_ch0_offset);
-	iio_channel_attr_write_longlong(m_ad5625_channel3, "raw",
-		m_adc_ch1_offset);
-
 out_cleanup:
-	delete[] candidateOffsets0;
-	delete[] candidateOffsets1;
-	delete[] averagesCh0;
-	delete[] averagesCh1;
-	delete[] dataCh0;
-	delete[] dataCh1;
+	iio_buffer_destroy(buffer);
+
+	if (ret) {
+		setCalibrationMode(NONE);
+
+		iio_channel_attr_write_longlong(m_ad5625_channel2, "raw",
+			m_adc_ch0_offset);
+		iio_channel_attr_write_longlong(m_ad5625_channel3, "raw",
+			m_adc_ch1_offset);
+	}
+
+out_restore:
+	setChannelEnableState(m_adc_channel0, channel0Enabled);
+	setChannelEnableState(m_adc_channel1, channel1Enabled);
+
 	return ret;
 }
 
@@ -844,6 +925,7 @@ float Calibration::convVoltsToSample(float voltage, float correctionGain)
 
 bool Calibration::calibrateAll()
 {
+	TRACE_SCOPE("Calibration::calibrateAll");
 	bool ok;
 	configHwSamplerate();
 
@@ -876,6 +958,7 @@ bool Calibration::calibrateAll()
 	}
 
 	updateCorrections();
+	saveCalibrationCache();
 	return true;
 
 calibration_fail:
@@ -888,6 +971,88 @@ void Calibration::cancelCalibration()
 	m_cancel=true;
 }
 
+QString Calibration::firmwareVersion() const
+{
+	const char *fw = iio_context_get_attr_value(m_ctx, "fw_version");
+
+	return fw ? QString(fw) : QString();
+}
+
+QString Calibration::cacheGroup() const
+{
+	const char *serial = iio_context_get_attr_value(m_ctx, "hw_serial");
+
+	if (!serial || !serial[0])
+		return QString();
+
+	return QString("calibration_cache/") + serial;
+}
+
+Calibration::cache_status Calibration::loadCachedCalibration()
+{
+	const QString group = cacheGroup();
+
+	if (!m_initialized || group.isEmpty())
+		return CACHE_MISSING;
+
+	QSettings settings;
+	settings.beginGroup(group);
+
+	if (!settings.contains("timestamp") ||
+			settings.value("fw_version").toString() != firmwareVersion())
+		return CACHE_MISSING;
+
+	m_adc_ch0_offset = settings.value("adc_offset0").toInt();
+	m_adc_ch1_offset = settings.value("adc_offset1").toInt();
+	m_adc_ch0_gain = settings.value("adc_gain0").toDouble();
+	m_adc_ch1_gain = settings.value("adc_gain1").toDouble();
+	m_dac_a_ch_offset = settings.value("dac_a_offset").toInt();
+	m_dac_b_ch_offset = settings.value("dac_b_offset").toInt();
+	m_dac_a_ch_vlsb = settings.value("dac_a_vlsb").toDouble();
+	m_dac_b_ch_vlsb = settings.value("dac_b_vlsb").toDouble();
+
+	setCalibrationMode(NONE);
+	updateCorrections();
+
+	const double temp = getIioDevTemp("ad9963");
+	const double drift = qAbs(temp - settings.value("temperature").toDouble());
+	const qint64 age = settings.value("timestamp").toDateTime().secsTo(
+		QDateTime::currentDateTimeUtc());
+
+	qDebug(CAT_CALIBRATION) << "Applied cached calibration of" << group <<
+		"temperature drift:" << drift << "age(s):" << age;
+
+	if (drift > CALIB_CACHE_MAX_TEMP_DRIFT || age < 0 ||
+			age > CALIB_CACHE_MAX_AGE)
+		return CACHE_OUTDATED;
+
+	return CACHE_VALID;
+}
+
+void Calibration::saveCalibrationCache() const
+{
+	const QString group = cacheGroup();
+
+	if (group.isEmpty())
+		return;
+
+	QSettings settings;
+	settings.beginGroup(group);
+
+	settings.setValue("fw_version", firmwareVersion());
+	settings.setValue("temperature", getIioDevTemp("ad9963"));
+	settings.setValue("timestamp", QDateTime::currentDateTimeUtc());
+
+	settings.setValue("adc_offset0", m_adc_ch0_offset);
+	settings.setValue("adc_offset1", m_adc_ch1_offset);
+	settings.setValue("adc_gain0", m_adc_ch0_gain);
+	settings.setValue("adc_gain1", m_adc_ch1_gain);
+	settings.setValue("dac_a_offset", m_dac_a_ch_offset);
+	settings.setValue("dac_b_offset", m_dac_b_ch_offset);
+	settings.setValue("dac_a_vlsb", m_dac_a_ch_vlsb);
+	settings.setValue("dac_b_vlsb", m_dac_b_ch_vlsb);
+}
+
 bool Calibration::setGainMode(int ch, int mode)
 {
         switch (mode) {
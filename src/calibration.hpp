@@ -27,6 +27,8 @@
 #include <string>
 #include <memory>
 
+#include <QString>
+
 extern "C" {
 	struct iio_context;
 	struct iio_device;
@@ -58,6 +60,12 @@ public:
                 HIGH
         };
 
+	enum cache_status {
+		CACHE_MISSING,
+		CACHE_VALID,
+		CACHE_OUTDATED
+	};
+
 	Calibration(struct iio_context *ctx, QJSEngine *engine,
 		    std::shared_ptr<M2kAdc> adc = nullptr,
 		    std::shared_ptr<M2kDac> dac_a = nullptr,
@@ -77,6 +85,16 @@ public:
 	bool calibrateDACgain();
 	void cancelCalibration();
 
+	/*
+	 * Applies the results of the last calibration of this device,
+	 * saved by calibrateAll(). The cache is keyed by the serial number
+	 * and the firmware version; it is reported as outdated when the
+	 * temperature drifted or the values are too old, in which case
+	 * the device should be calibrated again.
+	 */
+	cache_status loadCachedCalibration();
+	void saveCalibrationCache() const;
+
 	int adcOffsetChannel0() const;
 	int adcOffsetChannel1() const;
 	int dacAoffset() const;
@@ -105,6 +123,10 @@ public:
 private:
 	bool adc_data_capture(int16_t *dataCh0, int16_t *dataCh1,
 			      size_t num_sampl_per_chn);
+	bool capture_offset_averages(struct iio_buffer *buffer,
+		int16_t offset0, int16_t offset1, double& avg0, double& avg1);
+	static int16_t fit_offset(int16_t low, double avgLow, int16_t high,
+		double avgHigh, int16_t center, size_t span);
 	bool fine_tune(size_t span, int16_t centerVal0, int16_t centerVal1,
 		size_t num_samples);
 
@@ -113,6 +135,8 @@ private:
 	void dacAOutputDC(int16_t value);
 	void dacBOutputDC(int16_t value);
 	void configHwSamplerate();
+	QString cacheGroup() const;
+	QString firmwareVersion() const;
 
 	ApiObject *m_api;
 	bool m_cancel;
@@ -0,0 +1,755 @@
+/*
+ * Copyright 2019 Analog Devices, Inc.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Radio; see the file LICENSE.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include "capture_file.hpp"
+#include "config.h"
+
+#include <QDateTime>
+
+#include <algorithm>
+#include <cstring>
+
+/* Rows of zeros written at once when a capture is completed early */
+#define CAPTURE_FILL_ROWS	4096
+
+using namespace adiscope;
+
+namespace {
+
+const uint32_t LocalHeaderSig = 0x04034b50;
+const uint32_t CentralHeaderSig = 0x02014b50;
+const uint32_t EndOfDirectorySig = 0x06054b50;
+const size_t LocalHeaderSize = 30;
+const size_t CentralHeaderSize = 46;
+const size_t EndOfDirectorySize = 22;
+
+/* Extra field used to align the data of the zip members */
+const uint16_t PaddingExtraId = 0xd935;
+
+uint32_t crc32_update(uint32_t crc, const void *data, size_t size)
+{
+	static uint32_t table[256];
+	static bool table_ready = false;
+
+	if (!table_ready) {
+		for (uint32_t i = 0; i < 256; i++) {
+			uint32_t c = i;
+
+			for (int k = 0; k < 8; k++)
+				c = (c & 1) ? 0xedb88320 ^ (c >> 1) : c >> 1;
+			table[i] = c;
+		}
+		table_ready = true;
+	}
+
+	const uchar *ptr = static_cast<const uchar *>(data);
+
+	for (size_t i = 0; i < size; i++)
+		crc = table[(crc ^ ptr[i]) & 0xff] ^ (crc >> 8);
+
+	return crc;
+}
+
+void put16(QByteArray& out, uint16_t value)
+{
+	out.append((char) (value & 0xff));
+	out.append((char) (value >> 8));
+}
+
+void put32(QByteArray& out, uint32_t value)
+{
+	put16(out, value & 0xffff);
+	put16(out, value >> 16);
+}
+
+uint16_t get16(const uchar *ptr)
+{
+	return ptr[0] | (ptr[1] << 8);
+}
+
+uint32_t get32(const uchar *ptr)
+{
+	return get16(ptr) | ((uint32_t) get16(ptr + 2) << 16);
+}
+
+/* Header of a .npy member; its size keeps the data aligned to 64 bytes */
+QByteArray npy_header(const QByteArray& descr, const QVector<uint64_t>& shape)
+{
+	QByteArray dims;
+
+	/* Python tuple syntax: (), (n,) or (n, m) */
+	for (int i = 0; i < shape.size(); i++) {
+		if (i)
+			dims += ", ";
+		dims += QByteArray::number((qulonglong) shape[i]);
+	}
+	if (shape.size() == 1)
+		dims += ",";
+
+	QByteArray dict = "{'descr': '" + descr +
+		"', 'fortran_order': False, 'shape': (" + dims + "), }";
+
+	const int prefix = 10;
+	const int total = (prefix + dict.size() + 1 + 63) / 64 * 64;
+
+	dict += QByteArray(total - prefix - dict.size() - 1, ' ');
+	dict += '\n';
+
+	QByteArray header("\x93NUMPY\x01\x00", 8);
+
+	put16(header, dict.size());
+	return header + dict;
+}
+
+QByteArray ucs4(const QString& str, int width)
+{
+	const QVector<uint> chars = str.toUcs4();
+	QByteArray out;
+
+	for (int i = 0; i < width; i++)
+		put32(out, i < chars.size() ? chars[i] : 0);
+
+	return out;
+}
+
+size_t descr_size(const QByteArray& descr)
+{
+	return descr.mid(2).toUInt();
+}
+
+double element(const QByteArray& descr, const uchar *ptr)
+{
+	if (descr == "<f8") {
+		double v;
+		memcpy(&v, ptr, sizeof(v));
+		return v;
+	} else if (descr == "<f4") {
+		float v;
+		memcpy(&v, ptr, sizeof(v));
+		return v;
+	} else if (descr == "<i8") {
+		int64_t v;
+		memcpy(&v, ptr, sizeof(v));
+		return v;
+	} else if (descr == "<i4") {
+		int32_t v;
+		memcpy(&v, ptr, sizeof(v));
+		return v;
+	} else if (descr == "<u4") {
+		return get32(ptr);
+	} else if (descr == "<i2") {
+		return (int16_t) get16(ptr);
+	}
+
+	return 0.0;
+}
+}
+
+CaptureFileWriter::CaptureFileWriter() :
+	failed(false),
+	type(INT16),
+	nb_channels(0),
+	nb_samples(0),
+	rows_written(0)
+{
+}
+
+CaptureFileWriter::~CaptureFileWriter()
+{
+	if (file.isOpen())
+		close();
+}
+
+bool CaptureFileWriter::writeData(const void *data, size_t size)
+{
+	if (failed)
+		return false;
+
+	if (file.write(static_cast<const char *>(data), size) != (qint64) size) {
+		failed = true;
+		return false;
+	}
+
+	if (!entries.isEmpty()) {
+		Entry& entry = entries.last();
+
+		entry.crc = crc32_update(entry.crc, data, size);
+		entry.size += size;
+	}
+
+	return true;
+}
+
+void CaptureFileWriter::beginEntry(const QString& name, size_t alignment)
+{
+	Entry entry;
+
+	entry.name = name.toLatin1();
+	entry.crc = 0xffffffff;
+	entry.size = 0;
+	entry.offset = file.pos();
+
+	/* Pad the extra field so that the data starts aligned */
+	const size_t start = entry.offset + LocalHeaderSize + entry.name.size();
+	size_t padding = (alignment - start % alignment) % alignment;
+
+	if (padding && padding < 4)
+		padding += alignment;
+
+	QByteArray header;
+
+	put32(header, LocalHeaderSig);
+	put16(header, 20);	/* version needed: 2.0 */
+	put16(header, 0);	/* flags */
+	put16(header, 0);	/* stored */
+	put16(header, 0);	/* time */
+	put16(header, (1 << 5) | 1); /* date: 1980-01-01 */
+	put32(header, 0);	/* crc, patched by endEntry() */
+	put32(header, 0);	/* compressed size */
+	put32(header, 0);	/* size */
+	put16(header, entry.name.size());
+	put16(header, padding);
+	header += entry.name;
+
+	if (padding) {
+		put16(header, PaddingExtraId);
+		put16(header, padding - 4);
+		header += QByteArray(padding - 4, '\0');
+	}
+
+	if (failed)
+		return;
+
+	/* The local header is not part of the checksum of the entry */
+	if (file.write(header) != header.size()) {
+		failed = true;
+		return;
+	}
+
+	entries.push_back(entry);
+}
+
+void CaptureFileWriter::endEntry()
+{
+	if (failed || entries.isEmpty())
+		return;
+
+	Entry& entry = entries.last();
+	QByteArray sizes;
+
+	entry.crc ^= 0xffffffff;
+	put32(sizes, entry.crc);
+	put32(sizes, entry.size);
+	put32(sizes, entry.size);
+
+	const qint64 end = file.pos();
+
+	if (!file.seek(entry.offset + 14) ||
+			file.write(sizes) != sizes.size() || !file.seek(end))
+		failed = true;
+}
+
+void CaptureFileWriter::writeArray(const QString& name,
+		const QByteArray& descr, const QVector<uint64_t>& shape,
+		const void *data, size_t size)
+{
+	const QByteArray header = npy_header(descr, shape);
+
+	beginEntry(name + ".npy", 1);
+	writeData(header.constData(), header.size());
+	writeData(data, size);
+	endEntry();
+}
+
+void CaptureFileWriter::writeString(const QString& name, const QString& value)
+{
+	const int width = std::max(1, value.toUcs4().size());
+	const QByteArray data = ucs4(value, width);
+
+	writeArray(name, "<U" + QByteArray::number(width),
+			QVector<uint64_t>(), data.constData(), data.size());
+}
+
+void CaptureFileWriter::writeStrings(const QString& name,
+		const QStringList& values)
+{
+	int width = 1;
+	QByteArray data;
+
+	for (const QString& value : values)
+		width = std::max(width, value.toUcs4().size());
+
+	for (const QString& value : values)
+		data += ucs4(value, width);
+
+	writeArray(name, "<U" + QByteArray::number(width),
+			QVector<uint64_t>() << values.size(),
+			data.constData(), data.size());
+}
+
+bool CaptureFileWriter::open(const QString& filename, const CaptureInfo& info,
+		SampleType type, uint64_t nb_samples)
+{
+	const unsigned int channels = info.channel_names.size();
+
+	if (file.isOpen() || !channels || (type == INT16 &&
+			((unsigned int) info.gain.size() != channels ||
+			 (unsigned int) info.offset.size() != channels)))
+		return false;
+
+	file.setFileName(filename);
+	if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+		return false;
+
+	this->type = type;
+	this->nb_channels = channels;
+	this->nb_samples = nb_samples;
+	rows_written = 0;
+	failed = false;
+	entries.clear();
+
+	const uint32_t version = 1;
+	const QVector<uint64_t> scalar;
+	const QVector<uint64_t> per_channel = QVector<uint64_t>() << channels;
+	QVector<double> gain = info.gain, offset = info.offset;
+
+	if (type == FLOAT64) {
+		gain.fill(1.0, channels);
+		offset.fill(0.0, channels);
+	}
+
+	writeArray("version", "<u4", scalar, &version, sizeof(version));
+	writeArray("sample_rate", "<f8", scalar, &info.sample_rate,
+			sizeof(info.sample_rate));
+	writeArray("trigger_index", "<i8", scalar, &info.trigger_index,
+			sizeof(info.trigger_index));
+	writeArray("gain", "<f8", per_channel, gain.constData(),
+			channels * sizeof(double));
+	writeArray("offset", "<f8", per_channel, offset.constData(),
+			channels * sizeof(double));
+	writeStrings("channel_names", info.channel_names);
+	writeString("tool", info.tool);
+	writeString("scopy_version", QString(SCOPY_VERSION_GIT));
+	writeString("date", QDateTime::currentDateTime().toString(Qt::ISODate));
+
+	if (!info.x.isEmpty()) {
+		writeArray("x", "<f8", QVector<uint64_t>() << info.x.size(),
+				info.x.constData(), info.x.size() * sizeof(double));
+		writeString("x_name", info.x_name);
+	}
+
+	/* The samples come last, as they are written in chunks */
+	const QByteArray header = npy_header(type == INT16 ? "<i2" : "<f8",
+			QVector<uint64_t>() << nb_samples << channels);
+
+	beginEntry("samples.npy", 64);
+	writeData(header.constData(), header.size());
+
+	if (failed) {
+		file.close();
+		file.remove();
+	}
+
+	return !failed;
+}
+
+bool CaptureFileWriter::write(const int16_t *data, size_t nb_rows)
+{
+	if (!file.isOpen() || type != INT16 ||
+			rows_written + nb_rows > nb_samples)
+		return false;
+
+	rows_written += nb_rows;
+	return writeData(data, nb_rows * nb_channels * sizeof(int16_t));
+}
+
+bool CaptureFileWriter::write(const double *data, size_t nb_rows)
+{
+	if (!file.isOpen() || type != FLOAT64 ||
+			rows_written + nb_rows > nb_samples)
+		return false;
+
+	rows_written += nb_rows;
+	return writeData(data, nb_rows * nb_channels * sizeof(double));
+}
+
+bool CaptureFileWriter::writeDirectory()
+{
+	QByteArray directory;
+	const qint64 start = file.pos();
+
+	for (const Entry& entry : entries) {
+		put32(directory, CentralHeaderSig);
+		put16(directory, 20);	/* version made by */
+		put16(directory, 20);	/* version needed */
+		put16(directory, 0);	/* flags */
+		put16(directory, 0);	/* stored */
+		put16(directory, 0);	/* time */
+		put16(directory, (1 << 5) | 1);
+		put32(directory, entry.crc);
+		put32(directory, entry.size);
+		put32(directory, entry.size);
+		put16(directory, entry.name.size());
+		put16(directory, 0);	/* extra */
+		put16(directory, 0);	/* comment */
+		put16(directory, 0);	/* disk */
+		put16(directory, 0);	/* internal attributes */
+		put32(directory, 0);	/* external attributes */
+		put32(directory, entry.offset);
+		directory += entry.name;
+	}
+
+	const uint32_t directory_size = directory.size();
+
+	put32(directory, EndOfDirectorySig);
+	put16(directory, 0);	/* disk */
+	put16(directory, 0);	/* disk of the directory */
+	put16(directory, entries.size());
+	put16(directory, entries.size());
+	put32(directory, directory_size);
+	put32(directory, start);
+	put16(directory, 0);	/* comment */
+
+	entries.clear();
+
+	/* Without Zip64, the offsets have 32 bits */
+	if (start + directory.size() > 0xffffffffLL)
+		failed = true;
+
+	return writeData(directory.constData(), directory.size());
+}
+
+bool CaptureFileWriter::close()
+{
+	if (!file.isOpen())
+		return false;
+
+	const size_t row_size = nb_channels * (type == INT16 ?
+			sizeof(int16_t) : sizeof(double));
+	const std::vector<char> zeros(CAPTURE_FILL_ROWS * row_size, 0);
+
+	while (!failed && rows_written < nb_samples) {
+		const size_t rows = std::min<uint64_t>(CAPTURE_FILL_ROWS,
+				nb_samples - rows_written);
+
+		writeData(zeros.data(), rows * row_size);
+		rows_written += rows;
+	}
+
+	endEntry();
+	writeDirectory();
+	file.close();
+
+	if (failed)
+		file.remove();
+
+	return !failed;
+}
+
+void CaptureFileWriter::abort()
+{
+	if (file.isOpen()) {
+		file.close();
+		file.remove();
+	}
+}
+
+CaptureFileReader::CaptureFileReader() :
+	map(nullptr),
+	nb_samples(0),
+	nb_channels(0)
+{
+}
+
+CaptureFileReader::~CaptureFileReader()
+{
+	close();
+}
+
+bool CaptureFileReader::isCaptureFile(const QString& filename)
+{
+	return filename.endsWith(".npz", Qt::CaseInsensitive);
+}
+
+void CaptureFileReader::close()
+{
+	if (map) {
+		file.unmap(map);
+		map = nullptr;
+	}
+
+	file.close();
+	arrays.clear();
+	capture_info = CaptureInfo();
+	nb_samples = 0;
+	nb_channels = 0;
+}
+
+bool CaptureFileReader::parseArray(const uchar *member, size_t size,
+		Array& array)
+{
+	if (size < 10 || memcmp(member, "\x93NUMPY", 6))
+		return false;
+
+	size_t header_size, dict_size;
+
+	if (member[6] == 1) {
+		dict_size = get16(member + 8);
+		header_size = 10 + dict_size;
+	} else if (member[6] == 2 && size >= 12) {
+		dict_size = get32(member + 8);
+		header_size = 12 + dict_size;
+	} else {
+		return false;
+	}
+
+	if (header_size > size)
+		return false;
+
+	const QByteArray dict = QByteArray::fromRawData(
+			reinterpret_cast<const char *>(member) +
+			header_size - dict_size, dict_size);
+
+	if (!dict.contains("'fortran_order': False"))
+		return false;
+
+	int pos = dict.indexOf("'descr': '");
+	if (pos < 0)
+		return false;
+	pos += 10;
+	array.descr = dict.mid(pos, dict.indexOf('\'', pos) - pos);
+
+	pos = dict.indexOf("'shape': (");
+	if (pos < 0)
+		return false;
+	pos += 10;
+
+	array.shape.clear();
+	for (const QByteArray& dim : dict.mid(pos,
+				dict.indexOf(')', pos) - pos).split(',')) {
+		bool ok;
+		const uint64_t value = dim.trimmed().toULongLong(&ok);
+
+		if (ok)
+			array.shape.push_back(value);
+	}
+
+	uint64_t count = 1;
+	for (uint64_t dim : array.shape)
+		count *= dim;
+
+	const size_t item = array.descr.startsWith("<U") ?
+		4 * descr_size(array.descr) : descr_size(array.descr);
+
+	array.data = member + header_size;
+	array.size = size - header_size;
+
+	return item && count * item <= array.size;
+}
+
+bool CaptureFileReader::readDirectory()
+{
+	const qint64 size = file.size();
+
+	if (size < (qint64) EndOfDirectorySize)
+		return false;
+
+	/* The end of the directory is followed by the comment, if any */
+	const qint64 last = std::max<qint64>(0, size - EndOfDirectorySize - 0xffff);
+	qint64 end = size - EndOfDirectorySize;
+
+	while (end >= last && get32(map + end) != EndOfDirectorySig)
+		end--;
+	if (end < last)
+		return false;
+
+	const unsigned int nb_entries = get16(map + end + 10);
+	qint64 pos = get32(map + end + 16);
+
+	for (unsigned int i = 0; i < nb_entries; i++) {
+		if (pos + (qint64) CentralHeaderSize > size ||
+				get32(map + pos) != CentralHeaderSig)
+			return false;
+
+		const uint16_t method = get16(map + pos + 10);
+		const uint32_t member_size = get32(map + pos + 20);
+		const uint16_t name_size = get16(map + pos + 28);
+		const uint16_t extra_size = get16(map + pos + 30);
+		const uint16_t comment_size = get16(map + pos + 32);
+		const uint32_t offset = get32(map + pos + 42);
+		const QString name = QString::fromLatin1(reinterpret_cast<
+				const char *>(map + pos + CentralHeaderSize),
+				name_size);
+
+		pos += CentralHeaderSize + name_size + extra_size + comment_size;
+
+		if (offset + (qint64) LocalHeaderSize > size ||
+				get32(map + offset) != LocalHeaderSig)
+			return false;
+
+		const qint64 data = offset + LocalHeaderSize +
+			get16(map + offset + 26) + get16(map + offset + 28);
+
+		/* Only stored members can be used in place */
+		if (method != 0 || data + member_size > size ||
+				!name.endsWith(".npy"))
+			continue;
+
+		Array array;
+
+		if (parseArray(map + data, member_size, array))
+			arrays[name.left(name.size() - 4)] = array;
+	}
+
+	return true;
+}
+
+bool CaptureFileReader::readDoubles(const QString& name,
+		QVector<double>& values) const
+{
+	if (!arrays.contains(name))
+		return false;
+
+	const Array& array = arrays[name];
+	const size_t item = descr_size(array.descr);
+	size_t count = 1;
+
+	for (uint64_t dim : array.shape)
+		count *= dim;
+
+	values.resize(count);
+	for (size_t i = 0; i < count; i++)
+		values[i] = element(array.descr, array.data + i * item);
+
+	return true;
+}
+
+QStringList CaptureFileReader::readStrings(const QString& name) const
+{
+	QStringList strings;
+
+	if (!arrays.contains(name) || !arrays[name].descr.startsWith("<U"))
+		return strings;
+
+	const Array& array = arrays[name];
+	const size_t width = descr_size(array.descr);
+	size_t count = 1;
+
+	for (uint64_t dim : array.shape)
+		count *= dim;
+
+	for (size_t i = 0; i < count; i++) {
+		QVector<uint> chars;
+
+		for (size_t j = 0; j < width; j++) {
+			const uint c = get32(array.data + (i * width + j) * 4);
+
+			if (!c)
+				break;
+			chars.push_back(c);
+		}
+
+		strings.push_back(QString::fromUcs4(chars.constData(),
+					chars.size()));
+	}
+
+	return strings;
+}
+
+bool CaptureFileReader::open(const QString& filename)
+{
+	close();
+
+	file.setFileName(filename);
+	if (!file.open(QIODevice::ReadOnly))
+		return false;
+
+	map = file.map(0, file.size());
+
+	if (!map || !readDirectory() || !arrays.contains("samples")) {
+		close();
+		return false;
+	}
+
+	const Array& samples = arrays["samples"];
+
+	if (samples.shape.size() != 2 || (samples.descr != "<i2" &&
+				samples.descr != "<f8")) {
+		close();
+		return false;
+	}
+
+	nb_samples = samples.shape[0];
+	nb_channels = samples.shape[1];
+
+	QVector<double> values;
+
+	if (readDoubles("sample_rate", values) && values.size() == 1)
+		capture_info.sample_rate = values[0];
+	if (readDoubles("trigger_index", values) && values.size() == 1)
+		capture_info.trigger_index = (int64_t) values[0];
+
+	if (!readDoubles("gain", capture_info.gain) ||
+			(unsigned int) capture_info.gain.size() != nb_channels)
+		capture_info.gain.fill(1.0, nb_channels);
+	if (!readDoubles("offset", capture_info.offset) ||
+			(unsigned int) capture_info.offset.size() != nb_channels)
+		capture_info.offset.fill(0.0, nb_channels);
+
+	capture_info.channel_names = readStrings("channel_names");
+	while ((unsigned int) capture_info.channel_names.size() < nb_channels)
+		capture_info.channel_names.push_back("CH" + QString::number(
+				capture_info.channel_names.size() + 1));
+
+	capture_info.tool = readStrings("tool").value(0);
+	capture_info.x_name = readStrings("x_name").value(0);
+	readDoubles("x", capture_info.x);
+
+	return true;
+}
+
+QVector<double> CaptureFileReader::channel(unsigned int chn) const
+{
+	QVector<double> values;
+
+	if (chn >= nb_channels)
+		return values;
+
+	const Array& samples = arrays["samples"];
+	const double gain = capture_info.gain[chn];
+	const double offset = capture_info.offset[chn];
+
+	values.resize(nb_samples);
+
+	if (samples.descr == "<i2") {
+		const uchar *ptr = samples.data + chn * sizeof(int16_t);
+		const size_t stride = nb_channels * sizeof(int16_t);
+
+		for (uint64_t i = 0; i < nb_samples; i++, ptr += stride)
+			values[i] = (int16_t) get16(ptr) * gain + offset;
+	} else {
+		const uchar *ptr = samples.data + chn * sizeof(double);
+		const size_t stride = nb_channels * sizeof(double);
+
+		for (uint64_t i = 0; i < nb_samples; i++, ptr += stride)
+			values[i] = element(samples.descr, ptr) * gain + offset;
+	}
+
+	return values;
+}
@@ -0,0 +1,169 @@
+/*
+ * Copyright 2019 Analog Devices, Inc.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Radio; see the file LICENSE.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef CAPTURE_FILE_HPP
+#define CAPTURE_FILE_HPP
+
+#include <QFile>
+#include <QMap>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+#include <cstdint>
+#include <vector>
+
+namespace adiscope {
+
+/*
+ * Description of a capture, stored next to the samples.
+ *
+ * The value of sample i of channel c is samples[i][c] * gain[c] +
+ * offset[c]. For float captures the gains are 1 and the offsets 0.
+ */
+struct CaptureInfo
+{
+	QString tool;
+	double sample_rate;
+
+	/* Index of the trigger sample; it can be outside the capture */
+	int64_t trigger_index;
+
+	QStringList channel_names;
+	QVector<double> gain, offset;
+
+	/* Optional X axis (the frequencies of a spectrum) */
+	QString x_name;
+	QVector<double> x;
+
+	CaptureInfo() : sample_rate(0), trigger_index(0) {}
+};
+
+/*
+ * Capture files are uncompressed NumPy .npz archives, so they can be
+ * opened with numpy.load() without any other code:
+ *
+ *   version        uint32, the version of the format (1)
+ *   samples        int16 or float64 array of shape (samples, channels)
+ *   gain, offset   float64 arrays of shape (channels,)
+ *   sample_rate    float64
+ *   trigger_index  int64
+ *   channel_names  unicode array of shape (channels,)
+ *   tool, scopy_version, date
+ *                  unicode strings
+ *   x, x_name      the X axis, if there is one
+ *
+ * The members are stored without compression and the samples are
+ * aligned to 64 bytes in the file, which lets the reader use them
+ * straight from a memory map. Files are limited to 4 GiB (no Zip64).
+ */
+class CaptureFileWriter
+{
+public:
+	enum SampleType {
+		INT16,
+		FLOAT64,
+	};
+
+	CaptureFileWriter();
+	~CaptureFileWriter();
+
+	/* Writes the metadata; the samples are then appended in chunks
+	 * with write(), for a total of nb_samples rows */
+	bool open(const QString& filename, const CaptureInfo& info,
+			SampleType type, uint64_t nb_samples);
+
+	/* Appends nb_rows rows of interleaved channel values */
+	bool write(const int16_t *data, size_t nb_rows);
+	bool write(const double *data, size_t nb_rows);
+
+	/* Fills the missing rows with zeros and completes the archive */
+	bool close();
+
+	/* Removes the incomplete file */
+	void abort();
+
+private:
+	struct Entry {
+		QByteArray name;
+		uint32_t crc;
+		uint32_t size;
+		uint32_t offset;
+	};
+
+	QFile file;
+	QVector<Entry> entries;
+	bool failed;
+
+	SampleType type;
+	unsigned int nb_channels;
+	uint64_t nb_samples, rows_written;
+
+	bool writeData(const void *data, size_t size);
+	void beginEntry(const QString& name, size_t alignment);
+	void endEntry();
+	void writeArray(const QString& name, const QByteArray& descr,
+			const QVector<uint64_t>& shape, const void *data,
+			size_t size);
+	void writeString(const QString& name, const QString& value);
+	void writeStrings(const QString& name, const QStringList& values);
+	bool writeDirectory();
+};
+
+class CaptureFileReader
+{
+public:
+	CaptureFileReader();
+	~CaptureFileReader();
+
+	bool open(const QString& filename);
+	void close();
+
+	const CaptureInfo& info() const { return capture_info; }
+	uint64_t nbSamples() const { return nb_samples; }
+	unsigned int nbChannels() const { return nb_channels; }
+
+	/* The scaled values of one channel */
+	QVector<double> channel(unsigned int chn) const;
+
+	static bool isCaptureFile(const QString& filename);
+
+private:
+	struct Array {
+		QByteArray descr;
+		QVector<uint64_t> shape;
+		const uchar *data;
+		size_t size;
+	};
+
+	QFile file;
+	uchar *map;
+	QMap<QString, Array> arrays;
+	CaptureInfo capture_info;
+	uint64_t nb_samples;
+	unsigned int nb_channels;
+
+	bool readDirectory();
+	bool parseArray(const uchar *member, size_t size, Array& array);
+	bool readDoubles(const QString& name, QVector<double>& values) const;
+	QStringList readStrings(const QString& name) const;
+};
+}
+
+#endif /* CAPTURE_FILE_HPP */
@@ -0,0 +1,520 @@
+/*
+ * Copyright 2019 Analog Devices, Inc.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Radio; see the file LICENSE.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include "dac_streamer.hpp"
+#include "logging_categories.h"
+#include "waveform_synth.hpp"
+
+#include <QFile>
+
+#include <volk/volk.h>
+#include <iio.h>
+
+#include <algorithm>
+#include <cstring>
+
+/* Size of the chunks read from the files, in samples */
+#define READ_CHUNK	16384
+
+/* Default number of kernel buffers used by libiio */
+#define IIO_DEFAULT_KERNEL_BUFFERS	4
+
+using namespace adiscope;
+
+namespace {
+
+/* Raw binary file of native endian 32-bit floats */
+class RawFloatReader : public SampleFileReader
+{
+public:
+	explicit RawFloatReader(const QString& path) : file(path) {}
+
+	bool open() { return file.open(QIODevice::ReadOnly); }
+
+	size_t read(float *out, size_t n)
+	{
+		qint64 ret = file.read(reinterpret_cast<char *>(out),
+				n * sizeof(float));
+
+		return ret > 0 ? ret / sizeof(float) : 0;
+	}
+
+	bool rewind() { return file.seek(0); }
+
+private:
+	QFile file;
+};
+
+/* RIFF WAVE file with 8-bit or 16-bit PCM or 32-bit float samples */
+class WavReader : public SampleFileReader
+{
+public:
+	WavReader(const QString& path, unsigned int channel) :
+		file(path), channel(channel), data_start(0), data_size(0),
+		data_left(0)
+	{
+	}
+
+	bool open()
+	{
+		riff_header_t riff;
+		chunk_header_t header;
+		bool has_fmt = false;
+
+		if (!file.open(QIODevice::ReadOnly) ||
+				file.read(riff.data, sizeof(riff.data)) !=
+				sizeof(riff.data) ||
+				memcmp(riff.riff, "RIFF", 4) ||
+				memcmp(riff.id, "WAVE", 4)) {
+			return false;
+		}
+
+		while (file.read(header.data, sizeof(header.data)) ==
+				sizeof(header.data)) {
+			if (!memcmp(header.id, "fmt ", 4)) {
+				if (file.read(hdr.header_data,
+						sizeof(hdr.header_data)) !=
+						sizeof(hdr.header_data)) {
+					return false;
+				}
+
+				has_fmt = true;
+				file.seek(file.pos() + header.size -
+						sizeof(hdr.header_data));
+			} else if (!memcmp(header.id, "data", 4)) {
+				data_start = file.pos();
+				data_size = std::min<qint64>(header.size,
+						file.size() - data_start);
+				break;
+			} else {
+				/* Chunks are word aligned */
+				file.seek(file.pos() + header.size +
+						(header.size & 1));
+			}
+		}
+
+		if (!has_fmt || !data_start || !hdr.noChan ||
+				channel >= hdr.noChan) {
+			return false;
+		}
+
+		switch (hdr.format) {
+		case 1: /* PCM */
+			if (hdr.bitsPerSample != 8 && hdr.bitsPerSample != 16) {
+				return false;
+			}
+			break;
+		case 3: /* IEEE float */
+			if (hdr.bitsPerSample != 32) {
+				return false;
+			}
+			break;
+		default:
+			return false;
+		}
+
+		return rewind();
+	}
+
+	size_t read(float *out, size_t n)
+	{
+		const unsigned int sample_size = hdr.bitsPerSample / 8;
+		const unsigned int frame_size = sample_size * hdr.noChan;
+
+		n = std::min<qint64>(n, data_left / frame_size);
+		chunk.resize(n * frame_size);
+
+		qint64 ret = file.read(chunk.data(), chunk.size());
+		if (ret <= 0) {
+			return 0;
+		}
+
+		n = ret / frame_size;
+		data_left -= n * frame_size;
+
+		/* Deinterleave the channel we are interested in */
+		if (hdr.noChan > 1) {
+			const char *src = chunk.data() + channel * sample_size;
+
+			for (size_t i = 0; i < n; i++) {
+				memmove(chunk.data() + i * sample_size,
+				        src + i * frame_size, sample_size);
+			}
+		}
+
+		if (hdr.format == 3) {
+			memcpy(out, chunk.data(), n * sizeof(float));
+		} else if (hdr.bitsPerSample == 16) {
+			volk_16i_s32f_convert_32f(out, reinterpret_cast<
+					const int16_t *>(chunk.data()),
+					32768.0f, n);
+		} else {
+			const uint8_t *src = reinterpret_cast<
+				const uint8_t *>(chunk.data());
+
+			for (size_t i = 0; i < n; i++) {
+				out[i] = ((float) src[i] - 128.0f) / 128.0f;
+			}
+		}
+
+		return n;
+	}
+
+	bool rewind()
+	{
+		data_left = data_size;
+		return file.seek(data_start);
+	}
+
+private:
+	QFile file;
+	unsigned int channel;
+	wav_header_t hdr;
+	qint64 data_start, data_size, data_left;
+	std::vector<char> chunk;
+};
+
+/*
+ * CSV/TXT file, with or without the Scopy file header. When the header
+ * is present the first column holds the sample index and is skipped.
+ */
+class CsvReader : public SampleFileReader
+{
+public:
+	CsvReader(const QString& path, unsigned int channel) :
+		file(path), column(channel)
+	{
+	}
+
+	bool open()
+	{
+		return file.open(QIODevice::ReadOnly) && rewind();
+	}
+
+	size_t read(float *out, size_t n)
+	{
+		size_t count = 0;
+
+		while (count < n && !file.atEnd()) {
+			QByteArray line = file.readLine().trimmed();
+
+			if (line.isEmpty()) {
+				continue;
+			}
+
+			/* Lines of the Scopy file header */
+			if (line.startsWith(';')) {
+				has_header = true;
+				skip_names = true;
+				continue;
+			}
+
+			/* The line following the header has the column names */
+			if (skip_names) {
+				skip_names = false;
+				continue;
+			}
+
+			const char sep = line.contains(',') ? ',' :
+				(line.contains(';') ? ';' : '\t');
+			const QList<QByteArray> cells = line.split(sep);
+			const int idx = column + (has_header ? 1 : 0);
+			bool ok = false;
+
+			if (idx < cells.size()) {
+				out[count] = cells[idx].trimmed().toFloat(&ok);
+			}
+
+			if (ok) {
+				count++;
+			}
+		}
+
+		return count;
+	}
+
+	bool rewind()
+	{
+		has_header = false;
+		skip_names = false;
+		return file.seek(0);
+	}
+
+private:
+	QFile file;
+	int column;
+	bool has_header, skip_names;
+};
+}
+
+size_t SampleFileReader::skip(size_t n)
+{
+	float tmp[READ_CHUNK];
+	size_t skipped = 0;
+
+	while (skipped < n) {
+		size_t ret = read(tmp, std::min<size_t>(READ_CHUNK,
+					n - skipped));
+		if (!ret) {
+			break;
+		}
+
+		skipped += ret;
+	}
+
+	return skipped;
+}
+
+SampleFileReader *SampleFileReader::create(const signal_generator_data& data)
+{
+	switch (data.file_type) {
+	case FORMAT_BIN_FLOAT: {
+		RawFloatReader *reader = new RawFloatReader(data.file);
+
+		if (reader->open()) {
+			return reader;
+		}
+
+		delete reader;
+		break;
+	}
+	case FORMAT_WAVE: {
+		WavReader *reader = new WavReader(data.file, data.file_channel);
+
+		if (reader->open()) {
+			return reader;
+		}
+
+		delete reader;
+		break;
+	}
+	case FORMAT_CSV: {
+		CsvReader *reader = new CsvReader(data.file, data.file_channel);
+
+		if (reader->open()) {
+			return reader;
+		}
+
+		delete reader;
+		break;
+	}
+	default:
+		break;
+	}
+
+	return nullptr;
+}
+
+bool SampleFileReader::scanCsv(const QString& path, unsigned int& nb_columns,
+		size_t& nb_samples, double& sample_rate)
+{
+	QFile file(path);
+	bool has_header = false, skip_names = false;
+
+	nb_columns = 0;
+	nb_samples = 0;
+	sample_rate = 0;
+
+	if (!file.open(QIODevice::ReadOnly)) {
+		return false;
+	}
+
+	while (!file.atEnd()) {
+		QByteArray line = file.readLine().trimmed();
+
+		if (line.isEmpty()) {
+			continue;
+		}
+
+		/* Same layout as the one handled by CsvReader */
+		if (line.startsWith(';')) {
+			if (line.startsWith(";Sample rate")) {
+				QByteArray value = line.mid(12).trimmed();
+
+				if (!value.isEmpty() && (value[0] == ',' ||
+						value[0] == ';' ||
+						value[0] == '\t')) {
+					value = value.mid(1);
+				}
+
+				sample_rate = value.trimmed().toDouble();
+			}
+
+			has_header = true;
+			skip_names = true;
+			continue;
+		}
+
+		if (skip_names) {
+			skip_names = false;
+			continue;
+		}
+
+		if (!nb_columns) {
+			const char sep = line.contains(',') ? ',' :
+				(line.contains(';') ? ';' : '\t');
+			const int cells = line.count(sep) + 1;
+
+			nb_columns = cells - (has_header ? 1 : 0);
+		}
+
+		nb_samples++;
+	}
+
+	return nb_columns > 0;
+}
+
+DacFileStreamer::DacFileStreamer(struct iio_channel *chn,
+		SampleFileReader *reader, float amplitude, float offset,
+		unsigned long phase, float low, float high, float coef) :
+	chn(chn), buf(nullptr), reader(reader),
+	amplitude(amplitude), offset(offset), phase(phase),
+	low(low), high(high), coef(coef),
+	running(false)
+{
+}
+
+DacFileStreamer::~DacFileStreamer()
+{
+	stop();
+}
+
+bool DacFileStreamer::start(size_t buffer_size, unsigned int kernel_buffers)
+{
+	const struct iio_device *dev = iio_channel_get_device(chn);
+
+	if (running || !reader) {
+		return false;
+	}
+
+	volts.resize(buffer_size);
+	raw.resize(buffer_size);
+
+	reader->rewind();
+	reader->skip(phase);
+
+	iio_device_set_kernel_buffers_count(dev, kernel_buffers);
+	buf = iio_device_create_buffer(dev, buffer_size, false);
+	if (!buf) {
+		qDebug(CAT_SIGNAL_GENERATOR) << "Unable to create streaming buffer";
+		iio_device_set_kernel_buffers_count(dev,
+				IIO_DEFAULT_KERNEL_BUFFERS);
+		return false;
+	}
+
+	/* The first chunk is pushed before returning, so that the DMA
+	 * sync can be released right away by the caller */
+	if (!push(fill())) {
+		stop();
+		return false;
+	}
+
+	running = true;
+	thread = std::thread(&DacFileStreamer::run, this);
+
+	return true;
+}
+
+void DacFileStreamer::stop()
+{
+	running = false;
+
+	if (buf) {
+		/* Unblock a pending iio_buffer_push() */
+		iio_buffer_cancel(buf);
+	}
+
+	if (thread.joinable()) {
+		thread.join();
+	}
+
+	if (buf) {
+		const struct iio_device *dev = iio_buffer_get_device(buf);
+
+		iio_buffer_destroy(buf);
+		iio_device_set_kernel_buffers_count(dev,
+				IIO_DEFAULT_KERNEL_BUFFERS);
+		buf = nullptr;
+	}
+}
+
+size_t DacFileStreamer::fill()
+{
+	size_t count = 0;
+	bool rewound = false;
+
+	while (count < volts.size()) {
+		size_t ret = reader->read(volts.data() + count,
+				volts.size() - count);
+
+		if (ret) {
+			count += ret;
+			rewound = false;
+			continue;
+		}
+
+		/* Loop back to the start; give up on empty files */
+		if (rewound || !reader->rewind()) {
+			break;
+		}
+
+		rewound = true;
+	}
+
+	float *data = volts.data();
+
+	for (size_t i = 0; i < count; i++) {
+		data[i] = data[i] * amplitude + offset;
+	}
+
+	WaveformSynth::toRaw(data, raw.data(), count, low, high, coef);
+
+	return count;
+}
+
+bool DacFileStreamer::push(size_t nb_samples)
+{
+	if (!nb_samples) {
+		return false;
+	}
+
+	iio_channel_write(chn, buf, raw.data(), nb_samples * sizeof(short));
+
+	ssize_t ret = iio_buffer_push_partial(buf, nb_samples);
+	if (ret < 0) {
+		qDebug(CAT_SIGNAL_GENERATOR) << "Streaming buffer push failed:"
+			<< ret;
+		return false;
+	}
+
+	return true;
+}
+
+void DacFileStreamer::run()
+{
+	/* iio_buffer_push() blocks while all the kernel buffers are queued,
+	 * so the next chunk is prepared while the previous ones play. */
+	while (running) {
+		if (!push(fill())) {
+			break;
+		}
+	}
+
+	running = false;
+}
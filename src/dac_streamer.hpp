@@ -0,0 +1,114 @@
+/*
+ * Copyright 2019 Analog Devices, Inc.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Radio; see the file LICENSE.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef DAC_STREAMER_HPP
+#define DAC_STREAMER_HPP
+
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "signal_generator.hpp"
+
+extern "C" {
+	struct iio_buffer;
+	struct iio_channel;
+}
+
+namespace adiscope {
+
+/*
+ * Sequential reader of one channel of a waveform file. The data is never
+ * loaded in memory as a whole: files are read and converted one chunk
+ * at a time.
+ */
+class SampleFileReader
+{
+public:
+	virtual ~SampleFileReader() {}
+
+	/* Read up to n samples. Returns 0 at the end of the file. */
+	virtual size_t read(float *out, size_t n) = 0;
+
+	/* Restart from the first sample of the file */
+	virtual bool rewind() = 0;
+
+	/* Skip n samples; returns the number of samples skipped */
+	size_t skip(size_t n);
+
+	/* Returns NULL if the file can't be opened or the format can't
+	 * be streamed */
+	static SampleFileReader *create(const struct signal_generator_data& data);
+
+	/* Reads the layout of a CSV/TXT file without keeping its values.
+	 * sample_rate is 0 if the file has no Scopy header. */
+	static bool scanCsv(const QString& path, unsigned int& nb_columns,
+			    size_t& nb_samples, double& sample_rate);
+};
+
+/*
+ * Plays back a waveform file on a DAC channel using non-cyclic buffers.
+ *
+ * A refill thread reads the file chunk by chunk, converts the samples to
+ * raw DAC codes and pushes them. The kernel keeps several buffers queued,
+ * so the DMA never runs dry while the next chunk is being prepared.
+ * The file is played back in a loop until stop() is called.
+ */
+class DacFileStreamer
+{
+public:
+	static const size_t default_buffer_size = 65536;
+	static const unsigned int default_kernel_buffers = 8;
+
+	DacFileStreamer(struct iio_channel *chn, SampleFileReader *reader,
+			float amplitude, float offset, unsigned long phase,
+			float low, float high, float coef);
+	~DacFileStreamer();
+
+	/* Creates the buffer and pushes the first chunk synchronously */
+	bool start(size_t buffer_size = default_buffer_size,
+		   unsigned int kernel_buffers = default_kernel_buffers);
+	void stop();
+
+	bool isRunning() const { return running; }
+	struct iio_channel *channel() const { return chn; }
+
+private:
+	struct iio_channel *chn;
+	struct iio_buffer *buf;
+	std::unique_ptr<SampleFileReader> reader;
+
+	float amplitude, offset;
+	unsigned long phase;
+	float low, high, coef;
+
+	std::vector<float> volts;
+	std::vector<short> raw;
+
+	std::thread thread;
+	std::atomic<bool> running;
+
+	size_t fill();
+	bool push(size_t nb_samples);
+	void run();
+};
+}
+
+#endif /* DAC_STREAMER_HPP */
@@ -725,6 +725,11 @@ QVector<double> dBgraph::getYAxisData()
 	return data;
 }
 
+const QwtSeriesData<QPointF> *dBgraph::curveData() const
+{
+	return curve.data();
+}
+
 void dBgraph::enableFrequencyBar(bool enable)
 {
 	d_frequencyBar->setVisible(enable);
@@ -89,6 +89,7 @@ public:
 	QString cursorIntersection(qreal text);
 	QVector<double> getXAxisData();
 	QVector<double> getYAxisData();
+	const QwtSeriesData<QPointF> *curveData() const;
 
 	void enableFrequencyBar(bool enable);
 	void setYAxisInterval(double min, double max, double correction);
@@ -341,6 +341,7 @@ void adiscope::Debugger::on_runButton_clicked()
 		l.removeFirst();
 	contents = l.join('\n');
 
+	Q_EMIT scriptAboutToRun();
 	result = eng->evaluate(contents, scriptFile.fileName());
 
 	if (result.isError()) {
@@ -55,6 +55,7 @@ public:
 
 Q_SIGNALS:
 	void newDebuggerInstance();
+	void scriptAboutToRun();
 
 public Q_SLOTS:
 	void updateSources(void);
@@ -24,23 +24,16 @@
 #include "osc_adc.h"
 #include "hardware_trigger.hpp"
 #include "utils.h"
-
-#include <gnuradio/blocks/keep_one_in_n.h>
-#include <gnuradio/blocks/moving_average_ff.h>
-#include <gnuradio/blocks/rms_ff.h>
-#include <gnuradio/blocks/short_to_float.h>
-#include <gnuradio/blocks/sub_ff.h>
-#include <gnuradio/filter/dc_blocker_ff.h>
+#include "dmm_integrator.hpp"
+#include "dmm_logger.hpp"
 
 #include <boost/make_shared.hpp>
 
+#include <algorithm>
+#include <cmath>
 #include <memory>
-#include <QDateTime>
-#include <QFile>
 #include <QFileDialog>
 #include <QMessageBox>
-#include <QTextStream>
-#include <QThread>
 #include <QJSEngine>
 
 #include "dmm_api.hpp"
@@ -54,11 +47,13 @@ DMM::DMM(struct iio_context *ctx, Filter *filt, std::shared_ptr<GenericAdc> adc,
 	manager(iio_manager::get_instance(ctx, filt->device_name(TOOL_DMM))),
 	adc(adc),
 	signal(boost::make_shared<signal_sample>()),
-	interrupt_data_logging(false),
+	logger(std::make_shared<DmmLogger>()),
 	data_logging(false),
 	filename(""),
 	use_timer(false),
 	logging_refresh_rate(0),
+	integration_time(0.1),
+	mains_rejection(MAINS_REJECTION_50_60HZ),
 	wheelEventGuard(nullptr)
 {
 	ui->setupUi(this);
@@ -116,6 +111,14 @@ DMM::DMM(struct iio_context *ctx, Filter *filt, std::shared_ptr<GenericAdc> adc,
 			use_timer = false;
 		else use_timer = true;
 		logging_refresh_rate = value * 1000;
+		logger->setInterval(value);
+	});
+
+	connect(&*logger, &DmmLogger::error, this,
+			[&](const QString& message) {
+		ui->lblFileStatus->setText(message);
+		setDynamicProperty(ui->filename, "invalid", true);
+		ui->btnDataLogging->setChecked(false);
 	});
 
 	data_logging_timer->setValue(0);
@@ -190,6 +193,7 @@ void DMM::disconnectAll()
 DMM::~DMM()
 {
 	ui->run_button->setChecked(false);
+	logger->stop();
 	disconnectAll();
 
 	if (saveOnExit) {
@@ -202,9 +206,6 @@ DMM::~DMM()
 
 void DMM::updateValuesList(std::vector<float> values)
 {
-	if(!use_timer)
-		boost::unique_lock<boost::mutex> lock(data_mutex);
-
 	double volts_ch1 = adc->convSampleToVolts(0, (double) values[0]);
 	double volts_ch2 = adc->convSampleToVolts(1, (double) values[1]);
 
@@ -219,9 +220,6 @@ void DMM::updateValuesList(std::vector<float> values)
 
 	checkPeakValues(0, volts_ch1);
 	checkPeakValues(1, volts_ch2);
-
-	if(!use_timer)
-		data_cond.notify_all();
 }
 
 void DMM::checkPeakValues(int ch, double peak)
@@ -307,74 +305,108 @@ void DMM::toggleTimer(bool start)
 }
 
 
-gr::basic_block_sptr DMM::configureGraph(gr::basic_block_sptr s2f,
-		bool is_low_ac, bool is_high_ac)
+double DMM::mainsPeriod() const
 {
-	/* 10 fps refresh rate for the plot */
-	auto keep_one = gr::blocks::keep_one_in_n::make(sizeof(float),
-			is_high_ac ? (sample_rate / 10.0) : 1000.0);
+	switch (mains_rejection) {
+	case MAINS_REJECTION_50HZ:
+		return 1.0 / 50.0;
+	case MAINS_REJECTION_60HZ:
+		return 1.0 / 60.0;
+	case MAINS_REJECTION_50_60HZ:
+		/* Shortest time holding whole cycles of both */
+		return 1.0 / 10.0;
+	default:
+		return 0.0;
+	}
+}
 
-	/* TODO: figure out best value for the blocker parameter */
-	auto blocker = gr::filter::dc_blocker_ff::make(1000, true);
+double DMM::effectiveIntegrationTime() const
+{
+	const double period = mainsPeriod();
 
-	manager->connect(s2f, 0, blocker, 0);
+	if (period == 0.0)
+		return integration_time;
 
-	if (is_low_ac || is_high_ac) {
-		/* TODO: figure out best value for the RMS parameter */
-		auto rms = gr::blocks::rms_ff::make(0.0001);
-		manager->connect(blocker, 0, rms, 0);
+	/* Round to a whole number of power line cycles */
+	return std::max(1.0, std::round(integration_time / period)) * period;
+}
 
-		manager->connect(rms, 0, keep_one, 0);
-	} else {
-		auto sub = gr::blocks::sub_ff::make();
+double DMM::readingRate() const
+{
+	return (double) sample_rate / integrationSamples();
+}
 
-		manager->connect(s2f, 0, sub, 0);
-		manager->connect(blocker, 0, sub, 1);
-		manager->connect(sub, 0, keep_one, 0);
-	}
+unsigned long DMM::integrationSamples() const
+{
+	return std::max(1L, std::lround(effectiveIntegrationTime() *
+				sample_rate));
+}
 
-	return keep_one;
+boost::shared_ptr<dmm_integrator> DMM::createIntegrator(
+		bool is_low_ac, bool is_high_ac)
+{
+	/* In AC mode the mean of each segment is removed, which sets the
+	 * lower end of the band: 20 Hz for low AC, 800 Hz for high AC */
+	unsigned long segment = 0;
+
+	if (is_high_ac)
+		segment = sample_rate / 800;
+	else if (is_low_ac)
+		segment = sample_rate / 20;
+
+	return boost::make_shared<dmm_integrator>(integrationSamples(),
+			is_low_ac || is_high_ac, segment);
 }
 
 void DMM::configureModes()
 {
-	auto s2f1 = gr::blocks::short_to_float::make();
-	auto s2f2 = gr::blocks::short_to_float::make();
-
 	bool is_low_ac_ch1 = ui->btn_ch1_ac->isChecked();
 	bool is_low_ac_ch2 = ui->btn_ch2_ac->isChecked();
 	bool is_high_ac_ch1 = ui->btn_ch1_ac2->isChecked();
 	bool is_high_ac_ch2 = ui->btn_ch2_ac2->isChecked();
 
-	if (is_high_ac_ch1) {
-		id_ch1 = manager->connect(s2f1, 0, 0, false, sample_rate / 10);
-	} else {
-		/* Low-frequency AC: decimate data rate */
-		auto keep_one1 = gr::blocks::keep_one_in_n::make(
-				sizeof(short), sample_rate / 1e4);
-		id_ch1 = manager->connect(keep_one1, 0, 0, false,
-				sample_rate / 10);
+	/* Every sample goes through the integrators, which output one
+	 * value per integration period */
+	auto integrator1 = createIntegrator(is_low_ac_ch1, is_high_ac_ch1);
+	auto integrator2 = createIntegrator(is_low_ac_ch2, is_high_ac_ch2);
 
-		manager->connect(keep_one1, 0, s2f1, 0);
-	}
+	id_ch1 = manager->connect(integrator1, 0, 0, false, sample_rate / 10);
+	id_ch2 = manager->connect(integrator2, 1, 0, false, sample_rate / 10);
 
-	if (is_high_ac_ch2) {
-		id_ch2 = manager->connect(s2f2, 1, 0, false, sample_rate / 10);
-	} else {
-		/* Low-frequency AC: decimate data rate */
-		auto keep_one2 = gr::blocks::keep_one_in_n::make(
-				sizeof(short), sample_rate / 1e4);
-		id_ch2 = manager->connect(keep_one2, 1, 0, false,
-				sample_rate / 10);
+	manager->connect(integrator1, 0, signal, 0);
+	manager->connect(integrator2, 0, signal, 1);
 
-		manager->connect(keep_one2, 0, s2f2, 0);
-	}
+	/* The logger gets the readings straight from the flowgraph */
+	uint32_t ac_flags = 0;
+
+	if (is_low_ac_ch1 || is_high_ac_ch1)
+		ac_flags |= 1 << 0;
+	if (is_low_ac_ch2 || is_high_ac_ch2)
+		ac_flags |= 1 << 1;
+
+	auto logger_sink = boost::make_shared<dmm_logger_sink>(logger,
+			effectiveIntegrationTime(), ac_flags);
 
-	auto block1 = configureGraph(s2f1, is_low_ac_ch1, is_high_ac_ch1);
-	auto block2 = configureGraph(s2f2, is_low_ac_ch2, is_high_ac_ch2);
+	manager->connect(integrator1, 0, logger_sink, 0);
+	manager->connect(integrator2, 0, logger_sink, 1);
+}
 
-	manager->connect(block1, 0, signal, 0);
-	manager->connect(block2, 0, signal, 1);
+void DMM::setIntegrationTime(double time)
+{
+	integration_time = std::min(std::max(time, 0.001), 10.0);
+	toggleAC();
+	updateHistorySize();
+}
+
+void DMM::setMainsRejection(int rejection)
+{
+	if (rejection < MAINS_REJECTION_NONE ||
+			rejection > MAINS_REJECTION_50_60HZ)
+		return;
+
+	mains_rejection = static_cast<MainsRejection>(rejection);
+	toggleAC();
+	updateHistorySize();
 }
 
 void DMM::chooseFile()
@@ -382,7 +414,8 @@ void DMM::chooseFile()
 	QString selectedFilter;
 	filename = QFileDialog::getSaveFileName(this,
 		tr("Scopy DMM data logging"), "",
-		tr("Comma-separated values files (*.csv);;All Files(*)"),
+		tr("Comma-separated values files (*.csv);;"
+		   "Binary files (*.bin);;All Files(*)"),
 		&selectedFilter);
 	ui->filename->setText(filename);
 
@@ -405,6 +438,36 @@ void DMM::enableDataLogging(bool en)
 	}
 }
 
+bool DMM::startLogger()
+{
+	if (logger->isRunning())
+		return true;
+
+	/* The conversion to volts is linear */
+	for (unsigned int ch = 0; ch < 2; ch++) {
+		const double offset = adc->convSampleToVolts(ch, 0.0);
+
+		logger->setConversion(ch, adc->convSampleToVolts(ch, 1.0) -
+				offset, offset);
+	}
+
+	const DmmLogger::Format format = filename.endsWith(".bin",
+			Qt::CaseInsensitive) ? DmmLogger::BINARY :
+		DmmLogger::CSV;
+
+	if (!logger->start(filename, format, ui->btn_append->isChecked(),
+				use_timer ? logging_refresh_rate / 1000.0 : 0.0)) {
+		ui->lblFileStatus->setText("File is open in another program");
+		setDynamicProperty(ui->filename, "invalid", true);
+		ui->btnDataLogging->setChecked(false);
+		return false;
+	}
+
+	ui->lblFileStatus->setText("Choose a file");
+	setDynamicProperty(ui->filename, "invalid", false);
+	return true;
+}
+
 void DMM::toggleDataLogging(bool en)
 {
 	data_logging = en;
@@ -426,57 +489,16 @@ void DMM::toggleDataLogging(bool en)
 		return;
 	}
 
-	if(ui->run_button->isChecked()) {
+	if(en && ui->run_button->isChecked()) {
 		ui->btn_overwrite->setEnabled(false);
 		ui->btn_append->setEnabled(false);
-	}
-
-	if(en && ui->run_button->isChecked()) {
-		QFile file(filename);
-
-		if(ui->btn_overwrite->isChecked() || file.size() == 0) {
-			if( !file.open(QIODevice::WriteOnly)) {
-				ui->lblFileStatus->setText("File is open in another program");
-				setDynamicProperty(ui->filename, "invalid", true);
-				if(ui->run_button->isChecked()) {
-					ui->btnDataLogging->setChecked(false);
-				}
-				return;
-			} else {
-				ui->lblFileStatus->setText("Choose a file");
-				setDynamicProperty(ui->filename, "invalid", false);
-			}
-			QTextStream out(&file);
-
-			/* Write the header */
-			out << ";Generated by Scopy-" << QString(SCOPY_VERSION_GIT) << "\n" <<
-			       ";Started on " <<  QDateTime::currentDateTime().toString() << "\n";
-			out << "Timestamp,Channel_0_DC_RMS,Channel_0_AC_RMS,Channel_1_DC_RMS,Channel_1_AC_RMS\n";
-
-			file.close();
-		}
-	}
-	else {
+		startLogger();
+	} else {
+		if (!en)
+			logger->stop();
 		ui->btn_overwrite->setEnabled(true);
 		ui->btn_append->setEnabled(true);
 	}
-
-	/* If running, start the thread */
-	if(ui->run_button->isChecked() && en) {
-		if(data_logging_thread.joinable())
-			return;
-
-		interrupt_data_logging = false;
-		data_logging_thread = std::thread(&DMM::dataLoggingThread, this);
-	}
-	else if(!en) {
-		if(!use_timer)
-			data_cond.notify_all();
-		interrupt_data_logging = true;
-		if(data_logging_thread.joinable()) {
-			data_logging_thread.detach();
-		}
-	}
 }
 
 void DMM::startDataLogging(bool start)
@@ -488,94 +510,18 @@ void DMM::startDataLogging(bool start)
 	if(start) {
 		if(filename == "")
 			return;
-		if(data_logging_thread.joinable())
-			return;
 
-		interrupt_data_logging = false;
 		ui->btn_overwrite->setEnabled(false);
 		ui->btn_append->setEnabled(false);
-		data_logging_thread = std::thread(&DMM::dataLoggingThread, this);
-
+		startLogger();
 	}
 	else {
-		if(!use_timer)
-			data_cond.notify_all();
-		interrupt_data_logging = true;
-		if(data_logging_thread.joinable()) {
-			data_logging_thread.detach();
-		}
+		logger->stop();
 		ui->btn_overwrite->setEnabled(true);
 		ui->btn_append->setEnabled(true);
 	}
 }
 
-void DMM::dataLoggingThread()
-{
-	QString separator = ",";
-	QFile file(filename);
-
-	QTextStream out(&file);
-
-	while(!interrupt_data_logging) {
-		if (!file.isOpen()) {
-			if (!file.open(QIODevice::Append)) {
-				ui->lblFileStatus->setText("File is open in another program");
-				setDynamicProperty(ui->filename, "invalid", true);
-				if(ui->run_button->isChecked()) {
-					ui->btnDataLogging->setChecked(false);
-				}
-				return;
-			} else {
-				ui->lblFileStatus->setText("Choose a file");
-			}
-		}
-		bool is_low_ac_ch1 = ui->btn_ch1_ac->isChecked();
-		bool is_low_ac_ch2 = ui->btn_ch2_ac->isChecked();
-		bool is_high_ac_ch1 = ui->btn_ch1_ac2->isChecked();
-		bool is_high_ac_ch2 = ui->btn_ch2_ac2->isChecked();
-		QString ch1_dc_rms="-", ch2_dc_rms="-", ch1_ac_rms="-", ch2_ac_rms="-";
-
-		out << QDateTime::currentDateTime().time().toString() << separator;
-
-		if(!use_timer) {
-			boost::unique_lock<boost::mutex> lock(data_mutex);
-			data_cond.wait(lock);
-		}
-
-
-		if(!is_low_ac_ch1 && !is_high_ac_ch1) {
-			ch1_dc_rms = QString::number(ui->lcdCh1->value());
-		}
-		else {
-			ch1_ac_rms = QString::number(ui->lcdCh1->value());
-		}
-
-
-		if(!is_low_ac_ch2 && !is_high_ac_ch2) {
-			ch2_dc_rms = QString::number(ui->lcdCh2->value());
-		}
-		else {
-			ch2_ac_rms = QString::number(ui->lcdCh2->value());
-		}
-
-		/* Write the values to file */
-		out <<  ch1_dc_rms << separator <<
-			ch1_ac_rms << separator <<
-			ch2_dc_rms << separator <<
-			ch2_ac_rms << "\n";
-
-		if (file.isOpen()) {
-			file.close();
-		}
-		if (use_timer) {
-			QThread::msleep(logging_refresh_rate);
-		}
-	}
-	if (file.isOpen()) {
-		file.close();
-	}
-}
-
 void DMM::toggleAC()
 {
 	bool started = manager->started() && ui->run_button->isChecked();
@@ -597,22 +543,30 @@ void DMM::toggleAC()
 
 int DMM::numSamplesFromIdx(int idx)
 {
+	double seconds;
+
 	switch(idx) {
 	case 0:
-		return 10;
+		seconds = 1;
+		break;
 	case 1:
-		return 100;
+		seconds = 10;
+		break;
 	case 2:
-		return 600;
+		seconds = 60;
+		break;
 	default:
 		throw std::runtime_error("Invalid IDX");
 	}
+
+	return std::max(1, (int) std::lround(seconds * readingRate()));
 }
 
 void DMM::setHistorySizeCh1(int idx)
 {
 	int num_samples = numSamplesFromIdx(idx);
 
+	ui->sismograph_ch1->setSampleRate(readingRate());
 	ui->sismograph_ch1->setNumSamples(num_samples);
 }
 
@@ -620,9 +574,16 @@ void DMM::setHistorySizeCh2(int idx)
 {
 	int num_samples = numSamplesFromIdx(idx);
 
+	ui->sismograph_ch2->setSampleRate(readingRate());
 	ui->sismograph_ch2->setNumSamples(num_samples);
 }
 
+void DMM::updateHistorySize()
+{
+	setHistorySizeCh1(ui->historySizeCh1->currentIndex());
+	setHistorySizeCh2(ui->historySizeCh2->currentIndex());
+}
+
 void DMM::writeAllSettingsToHardware()
 {
 	adc->setSampleRate(sample_rate);
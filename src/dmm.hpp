@@ -23,6 +23,7 @@
 #include <QPushButton>
 #include <QWidget>
 #include <atomic>
+#include <memory>
 
 #include "apiObject.hpp"
 #include "filter.hpp"
@@ -30,10 +31,7 @@
 #include "signal_sample.hpp"
 #include "tool.hpp"
 #include "scroll_filter.hpp"
-#include <thread>
 #include "spinbox_a.hpp"
-#include <boost/thread/mutex.hpp>
-#include <boost/thread/condition_variable.hpp>
 
 namespace Ui {
 	class DMM;
@@ -44,6 +42,8 @@ class QJSEngine;
 namespace adiscope {
 	class DMM_API;
 	class GenericAdc;
+	class dmm_integrator;
+	class DmmLogger;
 
 	class DMM : public Tool
 	{
@@ -59,6 +59,13 @@ namespace adiscope {
 				ToolLauncher *parent);
 		~DMM();
 
+		enum MainsRejection {
+			MAINS_REJECTION_NONE,
+			MAINS_REJECTION_50HZ,
+			MAINS_REJECTION_60HZ,
+			MAINS_REJECTION_50_60HZ,
+		};
+
 	private:
 		Ui::DMM *ui;
 		boost::shared_ptr<iio_manager> manager;
@@ -67,25 +74,35 @@ namespace adiscope {
 		boost::shared_ptr<signal_sample> signal;
 		unsigned long sample_rate;
 
-		std::atomic<bool> interrupt_data_logging;
+		std::shared_ptr<DmmLogger> logger;
 		std::atomic<bool> data_logging;
 		QString filename;
-		std::thread data_logging_thread;
 		bool use_timer;
 		unsigned long logging_refresh_rate;
 		PositionSpinButton *data_logging_timer;
 
-		boost::mutex data_mutex;
-		boost::condition_variable data_cond;
 		MouseWheelWidgetGuard *wheelEventGuard;
 
 		std::vector<double> m_min, m_max;
 
+		/* Requested integration time, in seconds; it is rounded to
+		 * whole power line cycles unless mains rejection is off */
+		double integration_time;
+		MainsRejection mains_rejection;
+
 		void disconnectAll();
-		gr::basic_block_sptr configureGraph(gr::basic_block_sptr s2f,
+		boost::shared_ptr<dmm_integrator> createIntegrator(
 				bool is_low_ac, bool is_high_ac);
 		void configureModes();
+		double mainsPeriod() const;
+		double effectiveIntegrationTime() const;
+		unsigned long integrationSamples() const;
+		double readingRate() const;
+		void setIntegrationTime(double time);
+		void setMainsRejection(int rejection);
 		int numSamplesFromIdx(int idx);
+		void updateHistorySize();
+		bool startLogger();
 		void writeAllSettingsToHardware();
 		void checkPeakValues(int, double);
 
@@ -106,8 +123,6 @@ namespace adiscope {
 
 		void startDataLogging(bool);
 
-		void dataLoggingThread();
-
 		void chooseFile();
 
 		void resetPeakHold(bool);
@@ -165,4 +165,37 @@ void DMM_API::setDataLoggingAppend(bool val)
 	dmm->ui->btn_overwrite->setChecked(!val);
 }
 
+double DMM_API::getIntegrationTime() const
+{
+	return dmm->integration_time;
+}
+
+void DMM_API::setIntegrationTime(double time)
+{
+	dmm->setIntegrationTime(time);
+}
+
+int DMM_API::getMainsRejection() const
+{
+	return dmm->mains_rejection;
+}
+
+void DMM_API::setMainsRejection(int rejection)
+{
+	dmm->setMainsRejection(rejection);
+}
+
+double DMM_API::getNplc() const
+{
+	const double period = dmm->mainsPeriod();
+
+	if (period == 0.0)
+		return 0.0;
+
+	/* Cycles of the lowest of the two frequencies when both are
+	 * rejected */
+	return dmm->effectiveIntegrationTime() *
+		(dmm->mains_rejection == DMM::MAINS_REJECTION_60HZ ? 60 : 50);
+}
+
 }
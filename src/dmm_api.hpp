@@ -44,6 +44,11 @@ class DMM_API : public ApiObject
 		   WRITE setDataLoggingAppend)
 	Q_PROPERTY(bool peak_hold_en READ getPeakHoldEn
 		  WRITE setPeakHoldEn)
+	Q_PROPERTY(double integration_time READ getIntegrationTime
+		   WRITE setIntegrationTime)
+	Q_PROPERTY(int mains_rejection READ getMainsRejection
+		   WRITE setMainsRejection)
+	Q_PROPERTY(double nplc READ getNplc STORED false)
 
 public:
 	bool get_mode_ac_high_ch1() const;
@@ -85,6 +90,18 @@ public:
 	bool getPeakHoldEn() const;
 	void setPeakHoldEn(bool);
 
+	/* Integration time in seconds, before the rounding to whole
+	 * power line cycles */
+	double getIntegrationTime() const;
+	void setIntegrationTime(double);
+
+	/* 0: off, 1: 50 Hz, 2: 60 Hz, 3: both 50 Hz and 60 Hz */
+	int getMainsRejection() const;
+	void setMainsRejection(int);
+
+	/* Integration time in power line cycles; 0 if rejection is off */
+	double getNplc() const;
+
 	Q_INVOKABLE void show();
 
 	explicit DMM_API(DMM *dmm) : ApiObject(), dmm(dmm) {}
@@ -0,0 +1,133 @@
+/*
+ * Copyright 2019 Analog Devices, Inc.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Radio; see the file LICENSE.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include "dmm_integrator.hpp"
+
+#include <gnuradio/io_signature.h>
+
+#include <algorithm>
+#include <cmath>
+
+using namespace adiscope;
+
+dmm_integrator::dmm_integrator(unsigned long window, bool ac,
+		unsigned long segment) :
+	gr::block("dmm_integrator",
+			gr::io_signature::make(1, 1, sizeof(short)),
+			gr::io_signature::make(1, 1, sizeof(float))),
+	d_window(std::max(window, 1UL)),
+	d_segment((ac && segment) ? std::min(segment, d_window) : d_window),
+	d_ac(ac),
+	d_window_count(0),
+	d_segment_count(0),
+	d_segment_sum(0),
+	d_segment_sq(0),
+	d_sum(0),
+	d_energy(0.0)
+{
+}
+
+dmm_integrator::~dmm_integrator()
+{
+}
+
+void dmm_integrator::forecast(int noutput_items,
+		gr_vector_int &ninput_items_required)
+{
+	/* The accumulators are kept between calls: any amount of input
+	 * can be consumed, even if it doesn't complete a window */
+	ninput_items_required[0] = 1;
+}
+
+void dmm_integrator::closeSegment()
+{
+	if (d_ac && d_segment_count) {
+		const double sum = (double) d_segment_sum;
+
+		d_energy += (double) d_segment_sq -
+			sum * sum / (double) d_segment_count;
+	}
+
+	d_sum += d_segment_sum;
+	d_segment_sum = 0;
+	d_segment_sq = 0;
+	d_segment_count = 0;
+}
+
+int dmm_integrator::general_work(int noutput_items,
+		gr_vector_int &ninput_items,
+		gr_vector_const_void_star &input_items,
+		gr_vector_void_star &output_items)
+{
+	const short *in = static_cast<const short *>(input_items[0]);
+	float *out = static_cast<float *>(output_items[0]);
+	const unsigned long available = ninput_items[0];
+	unsigned long consumed = 0;
+	int produced = 0;
+
+	while (consumed < available && produced < noutput_items) {
+		const unsigned long n = std::min(available - consumed,
+				std::min(d_segment - d_segment_count,
+					d_window - d_window_count));
+		const short *ptr = in + consumed;
+		int64_t sum = 0;
+
+		/* The inner loops only use integer additions and are
+		 * vectorized by the compiler */
+		if (d_ac) {
+			int64_t sq = 0;
+
+			for (unsigned long i = 0; i < n; i++) {
+				const int32_t x = ptr[i];
+
+				sum += x;
+				sq += x * x;
+			}
+
+			d_segment_sq += sq;
+		} else {
+			for (unsigned long i = 0; i < n; i++)
+				sum += ptr[i];
+		}
+
+		d_segment_sum += sum;
+		d_segment_count += n;
+		d_window_count += n;
+		consumed += n;
+
+		if (d_segment_count == d_segment || d_window_count == d_window)
+			closeSegment();
+
+		if (d_window_count == d_window) {
+			if (d_ac)
+				out[produced++] = (float) std::sqrt(
+					std::max(d_energy, 0.0) / d_window);
+			else
+				out[produced++] = (float) ((double) d_sum /
+					d_window);
+
+			d_window_count = 0;
+			d_sum = 0;
+			d_energy = 0.0;
+		}
+	}
+
+	consume_each(consumed);
+	return produced;
+}
@@ -0,0 +1,81 @@
+/*
+ * Copyright 2019 Analog Devices, Inc.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Radio; see the file LICENSE.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef DMM_INTEGRATOR_HPP
+#define DMM_INTEGRATOR_HPP
+
+#include <cstdint>
+
+#include <gnuradio/block.h>
+
+namespace adiscope {
+	/*
+	 * Integrating front end of the voltmeter.
+	 *
+	 * Every raw sample is added to integer accumulators (a boxcar
+	 * filter); one value is output at the end of each window of
+	 * 'window' samples. In DC mode the value is the mean of the window.
+	 * In AC mode the window is split in segments of 'segment' samples
+	 * and the value is the RMS of the samples around the mean of their
+	 * segment, which removes the frequencies below about
+	 * 1 / segment duration.
+	 *
+	 * Integrating over a whole number of power line cycles rejects the
+	 * mains interference, as the boxcar response has nulls at all the
+	 * multiples of 1 / window duration.
+	 */
+	class dmm_integrator : public gr::block
+	{
+	public:
+		explicit dmm_integrator(unsigned long window,
+				bool ac = false, unsigned long segment = 0);
+		~dmm_integrator();
+
+		unsigned long window() const { return d_window; }
+
+		void forecast(int noutput_items,
+				gr_vector_int &ninput_items_required);
+
+		int general_work(int noutput_items,
+				gr_vector_int &ninput_items,
+				gr_vector_const_void_star &input_items,
+				gr_vector_void_star &output_items);
+
+	private:
+		const unsigned long d_window;
+		const unsigned long d_segment;
+		const bool d_ac;
+
+		/* Samples accumulated in the current window / segment */
+		unsigned long d_window_count;
+		unsigned long d_segment_count;
+
+		/* Sum and sum of squares of the current segment */
+		int64_t d_segment_sum;
+		int64_t d_segment_sq;
+
+		/* Sum and AC energy of the closed segments of the window */
+		int64_t d_sum;
+		double d_energy;
+
+		void closeSegment();
+	};
+}
+
+#endif /* DMM_INTEGRATOR_HPP */
@@ -0,0 +1,350 @@
+/*
+ * Copyright 2019 Analog Devices, Inc.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Radio; see the file LICENSE.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include "dmm_logger.hpp"
+#include "logging_categories.h"
+#include "config.h"
+
+#include <gnuradio/io_signature.h>
+
+#include <QDateTime>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+/* Size of the formatted data written at once */
+#define LOGGER_WRITE_SIZE	(1 << 20)
+
+/* Time the writer sleeps when the ring is empty */
+#define LOGGER_POLL_MS		10
+
+/* Largest difference between the sample clock and the system clock
+ * before the timestamps are anchored again */
+#define LOGGER_MAX_SKEW_US	1000000
+
+using namespace adiscope;
+
+namespace {
+
+int64_t now_us()
+{
+	return std::chrono::duration_cast<std::chrono::microseconds>(
+		std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+void append(std::vector<char>& out, const void *data, size_t n)
+{
+	const char *ptr = static_cast<const char *>(data);
+
+	out.insert(out.end(), ptr, ptr + n);
+}
+}
+
+DmmLogger::DmmLogger(QObject *parent) :
+	QObject(parent),
+	ring(ring_size),
+	head(0),
+	tail(0),
+	dropped_count(0),
+	format(CSV),
+	start_time(0),
+	interval_us(0),
+	cached_second(-1),
+	running(false)
+{
+	for (unsigned int i = 0; i < 2; i++) {
+		gain[i] = 1.0;
+		offset[i] = 0.0;
+	}
+}
+
+DmmLogger::~DmmLogger()
+{
+	stop();
+}
+
+bool DmmLogger::start(const QString& filename, Format format, bool append,
+		double interval)
+{
+	if (running)
+		return false;
+
+	if (thread.joinable())
+		thread.join();
+
+	file.setFileName(filename);
+
+	QIODevice::OpenMode mode = QIODevice::WriteOnly | QIODevice::Unbuffered;
+	mode |= append ? QIODevice::Append : QIODevice::Truncate;
+
+	if (!file.open(mode))
+		return false;
+
+	this->format = format;
+	setInterval(interval);
+	dropped_count = 0;
+	start_time = now_us();
+	cached_second = -1;
+
+	std::vector<char> out;
+
+	if (file.size() == 0)
+		writeHeader(out);
+
+	if (!write(out)) {
+		file.close();
+		return false;
+	}
+
+	running = true;
+	thread = std::thread(&DmmLogger::run, this);
+
+	return true;
+}
+
+void DmmLogger::stop()
+{
+	running = false;
+
+	if (thread.joinable())
+		thread.join();
+
+	if (dropped_count)
+		qDebug(CAT_VOLTMETER) << "Data logger dropped" <<
+			(qulonglong) dropped_count << "readings";
+}
+
+void DmmLogger::setInterval(double interval)
+{
+	interval_us = (int64_t) (interval * 1e6);
+}
+
+void DmmLogger::setConversion(unsigned int chn, double gain, double offset)
+{
+	if (chn < 2) {
+		this->gain[chn] = gain;
+		this->offset[chn] = offset;
+	}
+}
+
+void DmmLogger::push(const Reading& reading)
+{
+	const uint64_t pos = head.load(std::memory_order_relaxed);
+
+	if (pos - tail.load(std::memory_order_acquire) >= ring_size) {
+		dropped_count++;
+		return;
+	}
+
+	ring[pos % ring_size] = reading;
+	head.store(pos + 1, std::memory_order_release);
+}
+
+void DmmLogger::writeHeader(std::vector<char>& out)
+{
+	if (format == BINARY) {
+		const uint32_t record_size = sizeof(int64_t) +
+			2 * sizeof(float) + sizeof(uint32_t);
+
+		append(out, "SCPYDMM1", 8);
+		append(out, &record_size, sizeof(record_size));
+	} else {
+		const QByteArray header = (";Generated by Scopy-" +
+			QString(SCOPY_VERSION_GIT) + "\n;Started on " +
+			QDateTime::currentDateTime().toString() + "\n" +
+			"Timestamp,Channel_0_DC_RMS,Channel_0_AC_RMS,"
+			"Channel_1_DC_RMS,Channel_1_AC_RMS\n").toUtf8();
+
+		append(out, header.constData(), header.size());
+	}
+}
+
+void DmmLogger::formatReading(std::vector<char>& out, const Reading& r)
+{
+	double volts[2];
+
+	for (unsigned int i = 0; i < 2; i++)
+		volts[i] = r.values[i] * gain[i] + offset[i];
+
+	if (format == BINARY) {
+		const float values[2] = { (float) volts[0], (float) volts[1] };
+
+		append(out, &r.timestamp, sizeof(r.timestamp));
+		append(out, values, sizeof(values));
+		append(out, &r.ac_flags, sizeof(r.ac_flags));
+		return;
+	}
+
+	/* The date and time are only formatted once per second */
+	const int64_t second = r.timestamp / 1000000;
+
+	if (second != cached_second) {
+		cached_second = second;
+		cached_time = QDateTime::fromMSecsSinceEpoch(second * 1000)
+			.toString("yyyy-MM-dd hh:mm:ss").toLatin1();
+	}
+
+	char line[128];
+	char *p = line;
+
+	p += snprintf(p, 8, ".%03d,", (int) (r.timestamp / 1000 % 1000));
+
+	for (unsigned int i = 0; i < 2; i++) {
+		const bool ac = (r.ac_flags >> i) & 1;
+
+		if (ac)
+			p += snprintf(p, line + sizeof(line) - p, "-,%g",
+					volts[i]);
+		else
+			p += snprintf(p, line + sizeof(line) - p, "%g,-",
+					volts[i]);
+
+		*p++ = i ? '\n' : ',';
+	}
+
+	append(out, cached_time.constData(), cached_time.size());
+	append(out, line, p - line);
+}
+
+bool DmmLogger::write(std::vector<char>& out)
+{
+	const bool ok = out.empty() || file.write(out.data(), out.size()) ==
+		(qint64) out.size();
+
+	out.clear();
+	return ok;
+}
+
+void DmmLogger::run()
+{
+	std::vector<char> out;
+	auto last_write = std::chrono::steady_clock::now();
+	int64_t next_time = 0;
+	bool ok = true;
+
+	out.reserve(LOGGER_WRITE_SIZE + 256);
+
+	while (ok) {
+		/* Read the flag first: the readings pushed before the
+		 * logger was stopped are still written */
+		const bool stopping = !running;
+		const uint64_t end = head.load(std::memory_order_acquire);
+		uint64_t pos = tail.load(std::memory_order_relaxed);
+
+		for (; pos < end && out.size() < LOGGER_WRITE_SIZE; pos++) {
+			const Reading& r = ring[pos % ring_size];
+			const int64_t interval = interval_us;
+
+			/* Left over from a previous run */
+			if (r.timestamp < start_time)
+				continue;
+
+			if (interval) {
+				if (r.timestamp < next_time)
+					continue;
+				next_time = r.timestamp + interval;
+			}
+
+			formatReading(out, r);
+		}
+
+		tail.store(pos, std::memory_order_release);
+
+		const auto now = std::chrono::steady_clock::now();
+
+		if (stopping || out.size() >= LOGGER_WRITE_SIZE ||
+				now - last_write >= std::chrono::milliseconds(
+					flush_period_ms)) {
+			ok = write(out);
+			last_write = now;
+		}
+
+		if (stopping && pos == end)
+			break;
+
+		if (pos == end)
+			std::this_thread::sleep_for(std::chrono::milliseconds(
+						LOGGER_POLL_MS));
+	}
+
+	file.close();
+
+	if (!ok) {
+		running = false;
+		Q_EMIT error(tr("Could not write to the file"));
+	}
+}
+
+dmm_logger_sink::dmm_logger_sink(std::shared_ptr<DmmLogger> logger,
+		double period, uint32_t ac_flags) :
+	gr::sync_block("dmm_logger_sink",
+			gr::io_signature::make(2, 2, sizeof(float)),
+			gr::io_signature::make(0, 0, 0)),
+	d_logger(logger),
+	d_period_us(period * 1e6),
+	d_ac_flags(ac_flags),
+	d_anchored(false),
+	d_origin(0),
+	d_count(0)
+{
+}
+
+dmm_logger_sink::~dmm_logger_sink()
+{
+}
+
+int dmm_logger_sink::work(int noutput_items,
+		gr_vector_const_void_star &input_items,
+		gr_vector_void_star &output_items)
+{
+	const float *ch0 = static_cast<const float *>(input_items[0]);
+	const float *ch1 = static_cast<const float *>(input_items[1]);
+
+	if (!d_logger->isRunning()) {
+		d_anchored = false;
+		return noutput_items;
+	}
+
+	/* The last reading of the batch was just completed */
+	const int64_t now = now_us();
+	const int64_t last = d_origin + (int64_t) ((d_count +
+			noutput_items - 1) * d_period_us);
+
+	if (!d_anchored || std::llabs(now - last) > LOGGER_MAX_SKEW_US) {
+		d_origin = now - (int64_t) ((noutput_items - 1) * d_period_us);
+		d_count = 0;
+		d_anchored = true;
+	}
+
+	for (int i = 0; i < noutput_items; i++) {
+		DmmLogger::Reading r;
+
+		r.timestamp = d_origin + (int64_t) ((d_count + i) * d_period_us);
+		r.values[0] = ch0[i];
+		r.values[1] = ch1[i];
+		r.ac_flags = d_ac_flags;
+
+		d_logger->push(r);
+	}
+
+	d_count += noutput_items;
+	return noutput_items;
+}
@@ -0,0 +1,149 @@
+/*
+ * Copyright 2019 Analog Devices, Inc.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Radio; see the file LICENSE.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef DMM_LOGGER_HPP
+#define DMM_LOGGER_HPP
+
+#include <QFile>
+#include <QObject>
+#include <QString>
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include <gnuradio/sync_block.h>
+
+namespace adiscope {
+
+/*
+ * Writes the voltmeter readings to a file on a worker thread.
+ *
+ * The readings are pushed from the flowgraph into a single-producer,
+ * single-consumer ring which never blocks: if the writer falls behind by
+ * more than the size of the ring, the new readings are dropped and
+ * counted. The writer formats the readings in batches and writes them
+ * at least once per flush period, so a crash loses at most that much.
+ *
+ * Binary files start with the 8 bytes "SCPYDMM1", followed by the size
+ * of a record as a little-endian uint32. Each record holds the timestamp
+ * in microseconds since the epoch (int64), the two values in volts
+ * (float32) and the AC flags (uint32, bit n set if channel n measures
+ * AC). A file can be read in NumPy with the dtype
+ * [('t', '<i8'), ('ch', '<f4', 2), ('ac', '<u4')] at offset 12.
+ */
+class DmmLogger : public QObject
+{
+	Q_OBJECT
+
+public:
+	enum Format {
+		CSV,
+		BINARY,
+	};
+
+	struct Reading {
+		int64_t timestamp;	/* us since the epoch */
+		float values[2];	/* raw ADC values */
+		uint32_t ac_flags;
+	};
+
+	static const size_t ring_size = 1 << 16;
+	static const unsigned int flush_period_ms = 1000;
+
+	explicit DmmLogger(QObject *parent = nullptr);
+	~DmmLogger();
+
+	/* Opens the file and starts the writer thread. Readings with a
+	 * timestamp before the start are discarded. If interval is not
+	 * zero, at most one reading per interval (in seconds) is written. */
+	bool start(const QString& filename, Format format, bool append,
+			double interval);
+	void stop();
+	bool isRunning() const { return running; }
+
+	void setInterval(double interval);
+
+	/* Linear conversion of the raw values of a channel to volts */
+	void setConversion(unsigned int chn, double gain, double offset);
+
+	/* Producer side, called from the flowgraph thread */
+	void push(const Reading& reading);
+
+	uint64_t dropped() const { return dropped_count; }
+
+Q_SIGNALS:
+	void error(const QString& message);
+
+private:
+	std::vector<Reading> ring;
+	std::atomic<uint64_t> head, tail;
+	std::atomic<uint64_t> dropped_count;
+
+	QFile file;
+	Format format;
+	int64_t start_time;
+	std::atomic<int64_t> interval_us;
+	double gain[2], offset[2];
+
+	/* Date and time of the last second written to a CSV file */
+	int64_t cached_second;
+	QByteArray cached_time;
+
+	std::thread thread;
+	std::atomic<bool> running;
+
+	void run();
+	void writeHeader(std::vector<char>& out);
+	void formatReading(std::vector<char>& out, const Reading& r);
+	bool write(std::vector<char>& out);
+};
+
+/*
+ * Sink of the voltmeter flowgraph feeding a DmmLogger.
+ *
+ * The readings are timestamped here using the sample clock: one reading
+ * every 'period' seconds, anchored to the system clock at the first
+ * reading and again if the stream was interrupted.
+ */
+class dmm_logger_sink : public gr::sync_block
+{
+public:
+	explicit dmm_logger_sink(std::shared_ptr<DmmLogger> logger,
+			double period, uint32_t ac_flags);
+	~dmm_logger_sink();
+
+	int work(int noutput_items,
+			gr_vector_const_void_star &input_items,
+			gr_vector_void_star &output_items);
+
+private:
+	std::shared_ptr<DmmLogger> d_logger;
+	const double d_period_us;
+	const uint32_t d_ac_flags;
+
+	bool d_anchored;
+	int64_t d_origin;
+	uint64_t d_count;
+};
+}
+
+#endif /* DMM_LOGGER_HPP */
@@ -0,0 +1,193 @@
+/*
+ * Copyright 2019 Analog Devices, Inc.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Radio; see the file LICENSE.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+
+#include "export_service.hpp"
+
+#include <QFile>
+#include <QFileInfo>
+#include <QProgressDialog>
+#include <QtConcurrentRun>
+
+#include <cstring>
+
+/* Size of the output buffer; it is written to the file when full */
+#define EXPORT_BUFFER_SIZE	(4 << 20)
+
+/* Minimum time between two throughput reports, in ms */
+#define THROUGHPUT_INTERVAL	250
+
+using namespace adiscope;
+
+ExportService::Job::Job(ExportService *service) :
+	service(service),
+	bytes(0),
+	last_report(0),
+	last_progress(-1)
+{
+	timer.start();
+}
+
+bool ExportService::Job::reportProgress(uint64_t done, uint64_t total)
+{
+	const int percent = total ? (int)(done * 100 / total) : 100;
+
+	if (percent != last_progress) {
+		last_progress = percent;
+		Q_EMIT service->progress(percent);
+	}
+
+	const qint64 elapsed = timer.elapsed();
+
+	if (elapsed - last_report >= THROUGHPUT_INTERVAL) {
+		last_report = elapsed;
+		Q_EMIT service->throughput(bytes * 1000.0 / elapsed);
+	}
+
+	return !isCanceled();
+}
+
+void ExportService::Job::addBytes(uint64_t bytes)
+{
+	this->bytes += bytes;
+}
+
+bool ExportService::Job::isCanceled() const
+{
+	return service->canceled;
+}
+
+ExportService::OutputBuffer::OutputBuffer(QFile& file, Job *job) :
+	file(file), job(job), buffer(EXPORT_BUFFER_SIZE), pos(0), error(false)
+{
+}
+
+char *ExportService::OutputBuffer::reserve(size_t n)
+{
+	if (pos + n > buffer.size()) {
+		flush();
+		if (n > buffer.size())
+			buffer.resize(n);
+	}
+
+	return buffer.data() + pos;
+}
+
+void ExportService::OutputBuffer::append(const char *data, size_t n)
+{
+	char *p = reserve(n);
+
+	memcpy(p, data, n);
+	commit(p + n);
+}
+
+void ExportService::OutputBuffer::append(const QString& str)
+{
+	const QByteArray data = str.toUtf8();
+
+	append(data.constData(), data.size());
+}
+
+bool ExportService::OutputBuffer::flush()
+{
+	if (pos && file.write(buffer.data(), pos) != (qint64)pos)
+		error = true;
+	else if (job)
+		job->addBytes(pos);
+
+	pos = 0;
+	return !error;
+}
+
+ExportService::ExportService(QObject *parent) :
+	QObject(parent),
+	canceled(false),
+	task_running(false)
+{
+}
+
+ExportService::~ExportService()
+{
+	cancel();
+	wait();
+}
+
+bool ExportService::start(const Task& task)
+{
+	if (isRunning() || !task)
+		return false;
+
+	canceled = false;
+	task_running = true;
+	future = QtConcurrent::run(this, &ExportService::run, task);
+
+	return true;
+}
+
+void ExportService::cancel()
+{
+	canceled = true;
+}
+
+void ExportService::wait()
+{
+	future.waitForFinished();
+}
+
+bool ExportService::isRunning() const
+{
+	return future.isRunning();
+}
+
+void ExportService::run(Task task)
+{
+	Job job(this);
+	const bool done = task(job);
+
+	if (job.timer.elapsed())
+		Q_EMIT throughput(job.bytes * 1000.0 / job.timer.elapsed());
+
+	task_running = false;
+	Q_EMIT finished(done);
+}
+
+void ExportService::showProgress(QWidget *parent, const QString& filename)
+{
+	const QString label = tr("Exporting ") + QFileInfo(filename).fileName();
+	QProgressDialog *dialog = new QProgressDialog(label, tr("Cancel"),
+						      0, 100, parent);
+
+	dialog->setWindowModality(Qt::NonModal);
+	dialog->setMinimumDuration(500);
+	dialog->setAttribute(Qt::WA_DeleteOnClose);
+
+	connect(this, &ExportService::progress,
+		dialog, &QProgressDialog::setValue);
+	connect(this, &ExportService::throughput, dialog, [=](double rate) {
+		dialog->setLabelText(label + QString(" (%1 MB/s)")
+				     .arg(rate / 1e6, 0, 'f', 1));
+	});
+	connect(this, &ExportService::finished, dialog, &QProgressDialog::close);
+	connect(dialog, &QProgressDialog::canceled,
+		this, &ExportService::cancel);
+
+	/* A short export may be over before the dialog was connected */
+	if (!task_running)
+		dialog->close();
+}
@@ -0,0 +1,139 @@
+/*
+ * Copyright 2019 Analog Devices, Inc.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Radio; see the file LICENSE.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+
+#ifndef EXPORT_SERVICE_HPP
+#define EXPORT_SERVICE_HPP
+
+#include <QElapsedTimer>
+#include <QFuture>
+#include <QObject>
+#include <QString>
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+class QFile;
+class QWidget;
+
+namespace adiscope {
+
+/*
+ * Runs the exports of a tool on a worker thread.
+ *
+ * The tool takes a snapshot of its data on the GUI thread - the QVectors
+ * are implicitly shared, so this costs a reference count - and hands it
+ * to a task which formats and writes the file. The task reports its
+ * progress and the number of bytes written through a Job, which turns
+ * them into the progress() and throughput() signals and tells the task
+ * when the export was canceled. One export runs at a time.
+ */
+class ExportService : public QObject
+{
+	Q_OBJECT
+
+public:
+	class Job
+	{
+	public:
+		/* Returns false if the export was canceled */
+		bool reportProgress(uint64_t done, uint64_t total);
+		void addBytes(uint64_t bytes);
+		bool isCanceled() const;
+
+	private:
+		friend class ExportService;
+
+		explicit Job(ExportService *service);
+
+		ExportService *service;
+		QElapsedTimer timer;
+		uint64_t bytes;
+		qint64 last_report;
+		int last_progress;
+	};
+
+	/*
+	 * Buffers the output of a task, so that the file is written with
+	 * few large writes. The written bytes are reported to the job, if
+	 * there is one.
+	 */
+	class OutputBuffer
+	{
+	public:
+		OutputBuffer(QFile& file, Job *job = nullptr);
+
+		/* Makes room for at least n bytes; returns where to write them */
+		char *reserve(size_t n);
+		void commit(char *end) { pos = end - buffer.data(); }
+
+		void append(const char *data, size_t n);
+		void append(const QString& str);
+
+		bool flush();
+		bool failed() const { return error; }
+
+	private:
+		QFile& file;
+		Job *job;
+		std::vector<char> buffer;
+		size_t pos;
+		bool error;
+	};
+
+	/* Runs on the worker thread; returns false if the export failed
+	 * or was canceled */
+	typedef std::function<bool(Job&)> Task;
+
+	explicit ExportService(QObject *parent = nullptr);
+	~ExportService();
+
+	/* Returns false if an export is already running */
+	bool start(const Task& task);
+	void cancel();
+	void wait();
+	bool isRunning() const;
+
+	/* Shows the progress of the running export in a dialog which can
+	 * cancel it. The dialog deletes itself when the export is over,
+	 * including when it ended before this was called. */
+	void showProgress(QWidget *parent, const QString& filename);
+
+Q_SIGNALS:
+	void progress(int percent);
+
+	/* The average write speed, in bytes per second */
+	void throughput(double rate);
+
+	void finished(bool done);
+
+private:
+	QFuture<void> future;
+	std::atomic<bool> canceled;
+
+	/* Cleared right before finished() is emitted */
+	std::atomic<bool> task_running;
+
+	void run(Task task);
+};
+}
+
+#endif /* EXPORT_SERVICE_HPP */
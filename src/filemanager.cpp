@@ -24,6 +24,8 @@
 #include <QFile>
 #include <QDate>
 
+#include <cstring>
+
 using namespace adiscope;
 
 FileManager::FileManager(QString toolName) :
@@ -48,8 +50,6 @@ void FileManager::open(QString fileName,
         //throws exception if the file is corrupted, has a header but not the scopy one
         //columns with different sizes etc..
 
-        QVector<QVector<QString>> raw_data;
-
         openedFor = filepurpose;
 
         if (fileName.endsWith(".csv")) {
@@ -58,12 +58,15 @@ void FileManager::open(QString fileName,
         } else if (fileName.endsWith(".txt")) {
                 separator = "\t";
                 fileType = TXT;
-                //find sep to read txt files
+        } else {
+                separator = "";
         }
 
         //clear previous data if the manager was used for other exports
-        data.clear();
+        columns.clear();
         columnNames.clear();
+        hasHeader = false;
+        nrOfSamples = 0;
         this->filename = fileName;
 
         if (filepurpose == IMPORT) {
@@ -77,134 +80,367 @@ void FileManager::open(QString fileName,
                         throw FileManagerException("Can't open selected file");
                 }
 
-                QTextStream in(&file);
-
-                for (int i = 0; i < data.size(); ++i)
-                        data[i].clear();
+                format = RAW;
 
-                while (!in.atEnd()) {
-                        QVector<QString> line_data;
-                        QString line = in.readLine();
-                        QStringList list = line.split(separator, QString::SkipEmptyParts);
-                        for (QString list_item : list) {
-                                line_data.push_back(list_item);
-                        }
+                if (file.size() == 0) {
+                        return;
+                }
 
-                        raw_data.push_back(line_data);
+                //the file is parsed in place, without copying it to memory
+                const uchar *map = file.map(0, file.size());
+                if (!map) {
+                        throw FileManagerException("Can't open selected file");
                 }
 
-                //check if it has a header or not
-                /*
-                *  Header format
-                *
-                *       ;Scopy version <separator> abcdefg
-                *       ;Exported on <separator> Wed Apr 4 13:49:01 2018
-                *       ;Device <separator> M2K
-                *       ;Nr of samples <separator> 1234
-                *       ;Sample rate <separator> 1234 or 0 if it does not have samp. rate
-                *       ;Tool: <separator> Oscilloscope/ Spectrum ...
-                *       ;Additional Information
-                */
-
-                hasHeader = ScopyFileHeader::hasValidHeader(raw_data);
                 try {
-                        if (hasHeader) {
+                        parse(reinterpret_cast<const char *>(map),
+                              reinterpret_cast<const char *>(map) + file.size());
+                } catch (FileManagerException &) {
+                        file.unmap(const_cast<uchar *>(map));
+                        columns.clear();
+                        throw;
+                }
 
-                                format = SCOPY;
+                file.unmap(const_cast<uchar *>(map));
+        }
+}
 
-                                //first column in data is the time!!! when retrieving channel data start from data[1]
+void FileManager::setProgressCallback(ProgressCallback callback)
+{
+        progressCallback = callback;
+}
 
-                                sampleRate = std::stod(raw_data[4][1].toStdString());
-                                //should be 0 if read from network/spectrum analyzer exported file
+void FileManager::parse(const char *begin, const char *end)
+{
+        //check if it has a header or not
+        /*
+        *  Header format
+        *
+        *       ;Scopy version <separator> abcdefg
+        *       ;Exported on <separator> Wed Apr 4 13:49:01 2018
+        *       ;Device <separator> M2K
+        *       ;Nr of samples <separator> 1234
+        *       ;Sample rate <separator> 1234 or 0 if it does not have samp. rate
+        *       ;Tool: <separator> Oscilloscope/ Spectrum ...
+        *       ;Additional Information
+        */
+
+        const QStringList header = ScopyFileHeader::getHeader();
+        const char *first_line_end = static_cast<const char *>(
+                                memchr(begin, '\n', end - begin));
+        if (!first_line_end) {
+                first_line_end = end;
+        }
 
-                                for (int j = 1; j < raw_data[7].size(); ++j)
-                                        columnNames.push_back(raw_data[7][j]);
+        const QByteArray first_line(begin, first_line_end - begin);
+        const QByteArray version = header[0].toLatin1();
 
-                                data.resize(raw_data.size() - 8);
-                                for (int i = 0; i < data.size(); ++i) {
-                                        data[i].resize(raw_data[i + 8].size() - 1);
-                                }
+        //the separator follows the first header entry; files without
+        //a header use the first separator found on the first line
+        if (first_line.startsWith(version) &&
+                        first_line.size() > version.size()) {
+                separator = QString(QChar(first_line[version.size()]));
+        } else if (separator.isEmpty()) {
+                separator = ",";
+                for (const char c : {',', '\t', ';', ' '}) {
+                        if (first_line.contains(c)) {
+                                separator = QString(QChar(c));
+                                break;
+                        }
+                }
+        }
 
-                                for (int i = 8; i < raw_data.size(); ++i) {
-                                        for (int j = 1; j < raw_data[i].size(); ++j) {
-                                              data[i - 8][j - 1] = std::stod(raw_data[i][j].toStdString());
-                                        }
-                                }
-                        } else {
+        const char sep = separator.toLatin1().at(0);
+
+        //one pass over the file to preallocate the columns
+        qint64 nr_of_lines = 1;
+        for (const char *p = begin; (p = static_cast<const char *>(
+                        memchr(p, '\n', end - p))); p++) {
+                nr_of_lines++;
+        }
 
-                                format = RAW;
+        std::vector<Field> fields;
+        const char *line = begin;
+        const char *last_progress = begin;
+        int line_nr = 0;
 
-                                data.resize(raw_data.size());
-                                for (int i = 0; i < data.size(); ++i) {
-                                        data[i].resize(raw_data[i].size());
-                                }
+        while (line < end) {
+                const char *line_end = static_cast<const char *>(
+                                        memchr(line, '\n', end - line));
+                if (!line_end) {
+                        line_end = end;
+                }
+
+                splitLine(line, line_end, sep, fields);
+                line = (line_end < end) ? line_end + 1 : end;
+
+                if (fields.empty()) {
+                        continue;
+                }
 
-                                for (int i = 0; i < raw_data.size(); ++i) {
-                                        for (int j = 0; j < raw_data[i].size(); ++j) {
-                                              data[i][j] = std::stod(raw_data[i][j].toStdString());
-                                        }
+                if (line_nr < header.size()) {
+                        //the header has to be complete and in order
+                        const QByteArray name = header[line_nr].toLatin1();
+                        const bool matches = (fields[0].second -
+                                              fields[0].first == name.size()) &&
+                                        !memcmp(fields[0].first, name.constData(),
+                                                name.size());
+
+                        if (matches) {
+                                if (line_nr == 4 && (fields.size() < 2 ||
+                                                !parseDouble(fields[1].first,
+                                                             fields[1].second,
+                                                             sampleRate))) {
+                                        throw FileManagerException("File is corrupted!");
                                 }
+                                line_nr++;
+                                continue;
+                        }
+
+                        if (line_nr) {
+                                throw FileManagerException("File is corrupted!");
+                        }
+                        line_nr = header.size() + 1;
+                }
+
+                if (line_nr == header.size()) {
+                        //column names row
+                        hasHeader = true;
+                        format = SCOPY;
+
+                        for (size_t j = 1; j < fields.size(); ++j) {
+                                columnNames.push_back(QString::fromUtf8(
+                                        fields[j].first,
+                                        fields[j].second - fields[j].first));
+                        }
+                        line_nr++;
+                        continue;
+                }
+
+                //first column in a scopy file is the sample index,
+                //it is not stored
+                const size_t first = hasHeader ? 1 : 0;
+
+                if (columns.isEmpty()) {
+                        if (fields.size() <= first) {
+                                throw FileManagerException("File is corrupted!");
+                        }
+
+                        columns.resize(fields.size() - first);
+                        for (auto &column : columns) {
+                                column.reserve((int)nr_of_lines);
                         }
-                } catch (std::invalid_argument &i) {
-                        // if stod fails to convert a value to double it will throw an invalid argument exception
-                        // in this case it means that the file is corrupted
+                }
+
+                if (fields.size() - first != (size_t)columns.size()) {
                         throw FileManagerException("File is corrupted!");
                 }
 
-                nrOfSamples = data.size();
+                for (size_t j = first; j < fields.size(); ++j) {
+                        double value;
+
+                        if (!parseDouble(fields[j].first, fields[j].second,
+                                         value)) {
+                                throw FileManagerException("File is corrupted!");
+                        }
+                        columns[j - first].push_back(value);
+                }
+
+                if (progressCallback && line - last_progress >= (1 << 20)) {
+                        last_progress = line;
+                        if (!progressCallback((int)((line - begin) * 100 /
+                                                    (end - begin)))) {
+                                throw FileManagerException("Import canceled");
+                        }
+                }
+        }
+
+        if (line_nr && line_nr <= header.size()) {
+                //only part of the header was found
+                throw FileManagerException("File is corrupted!");
+        }
+
+        nrOfSamples = columns.isEmpty() ? 0 : columns[0].size();
+
+        if (progressCallback) {
+                progressCallback(100);
         }
 }
 
-void FileManager::save(QVector<double> data, QString name)
+void FileManager::splitLine(const char *begin, const char *end, char sep,
+                            std::vector<Field> &fields)
 {
-        this->columnNames.push_back(name);
+        fields.clear();
+
+        //empty fields are skipped, as consecutive or trailing separators
+        while (begin < end) {
+                const char *field_end = static_cast<const char *>(
+                                        memchr(begin, sep, end - begin));
+                if (!field_end) {
+                        field_end = end;
+                }
 
-        if (this->data.size() == 0) {
-                this->data.resize(data.size());
-        }
+                const char *first = begin;
+                const char *last = field_end;
 
-        for (int i = 0; i < data.size(); ++i) {
-                this->data[i].push_back(data[i]);
+                while (first < last && (*first == ' ' || *first == '\r')) {
+                        first++;
+                }
+                while (last > first && (last[-1] == ' ' || last[-1] == '\r')) {
+                        last--;
+                }
+
+                if (first < last) {
+                        fields.push_back(Field(first, last));
+                }
+
+                begin = field_end + 1;
         }
 }
 
-void FileManager::save(QVector<QVector<double> > data, QStringList columnNames)
+bool FileManager::parseDouble(const char *begin, const char *end,
+                              double &value)
 {
-        for (auto &column : data) {
-                this->data.push_back(column);
+        //powers of ten which are exactly representable as a double
+        static const double powers[] = {
+                1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10,
+                1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20,
+                1e21, 1e22
+        };
+
+        const char *p = begin;
+        bool negative = false;
+        bool exact = true;
+        bool has_digits = false;
+        uint64_t mantissa = 0;
+        int digits = 0;
+        int exponent = 0;
+
+        if (p < end && (*p == '-' || *p == '+')) {
+                negative = (*p++ == '-');
         }
 
-        for (auto &column_name : columnNames) {
-                this->columnNames.push_back(column_name);
+        for (; p < end && *p >= '0' && *p <= '9'; ++p) {
+                has_digits = true;
+                if (digits < 19) {
+                        mantissa = mantissa * 10 + (*p - '0');
+                        digits += (mantissa != 0);
+                } else {
+                        exponent++;
+                        exact = exact && *p == '0';
+                }
+        }
+
+        if (p < end && *p == '.') {
+                for (++p; p < end && *p >= '0' && *p <= '9'; ++p) {
+                        has_digits = true;
+                        if (digits < 19) {
+                                mantissa = mantissa * 10 + (*p - '0');
+                                digits += (mantissa != 0);
+                                exponent--;
+                        } else {
+                                exact = exact && *p == '0';
+                        }
+                }
+        }
+
+        if (has_digits && p < end && (*p == 'e' || *p == 'E')) {
+                const char *exp_start = ++p;
+                bool exp_negative = false;
+                int exp = 0;
+
+                if (p < end && (*p == '-' || *p == '+')) {
+                        exp_negative = (*p++ == '-');
+                }
+
+                for (; p < end && *p >= '0' && *p <= '9'; ++p) {
+                        if (exp < 10000) {
+                                exp = exp * 10 + (*p - '0');
+                        }
+                }
+
+                if (p == exp_start || !(p[-1] >= '0' && p[-1] <= '9')) {
+                        return false;
+                }
+
+                exponent += exp_negative ? -exp : exp;
+        }
+
+        //the fast path only handles the numbers which are converted
+        //exactly; the rest (long mantissas, large exponents, nan, inf)
+        //go through the slower, also locale-independent, Qt conversion
+        if (!has_digits || p != end || !exact ||
+                        mantissa > (1ULL << 53) ||
+                        exponent < -22 || exponent > 22) {
+                bool ok;
+
+                value = QByteArray::fromRawData(begin, end - begin)
+                        .toDouble(&ok);
+                return ok;
+        }
+
+        value = (exponent < 0) ? mantissa / powers[-exponent]
+                               : mantissa * powers[exponent];
+        if (negative) {
+                value = -value;
         }
+
+        return true;
 }
 
-QVector<double> FileManager::read(int index)
+void FileManager::save(QVector<double> data, QString name)
 {
-        if (index < 0 || index + 1 >= data.size()) {
-                return QVector<double>();
+        //the columns are implicitly shared, so this doesn't copy them
+        if (columns.isEmpty()) {
+                nrOfSamples = data.size();
+        }
+
+        columns.push_back(data);
+        columnNames.push_back(name);
+}
+
+void FileManager::save(QVector<QVector<double> > data, QStringList columnNames)
+{
+        for (int i = 0; i < data.size(); ++i) {
+                save(data[i], i < columnNames.size() ? columnNames[i] : "");
         }
+}
 
+QVector<double> FileManager::read(int index)
+{
         if (hasHeader) {
                 index++;
         }
 
-        QVector<double> channel_data;
-        for (int i = 0; i < nrOfSamples; ++i) {
-                channel_data.push_back(data[i][index]);
+        if (index < 0 || index >= columns.size()) {
+                return QVector<double>();
         }
 
-        return channel_data;
+        return columns[index];
 }
 
 QVector<QVector<double>> FileManager::read()
 {
-        return data;
+        //the data is stored by column
+        QVector<QVector<double>> rows(nrOfSamples);
+        for (int i = 0; i < rows.size(); ++i) {
+                rows[i].resize(columns.size());
+                for (int j = 0; j < columns.size(); ++j) {
+                        rows[i][j] = columns[j][i];
+                }
+        }
+
+        return rows;
+}
+
+QVector<QVector<double>> FileManager::readColumns() const
+{
+        return columns;
 }
 
 void FileManager::setColumnName(int index, QString name)
 {
-        if (index < 0 || index >= data.size()) {
+        if (index < 0 || index >= columnNames.size()) {
                 return;
         }
 
@@ -241,52 +477,88 @@ double FileManager::getNrOfSamples() const
 
 int FileManager::getNrOfChannels() const
 {
+        if (columns.isEmpty()) {
+                return 0;
+        }
+
         if (hasHeader) {
-                return data[0].size() - 1;
+                return columns.size() - 1;
         } else {
-                return data[0].size();
+                return columns.size();
         }
 }
 
-void FileManager::performWrite()
+bool FileManager::performWrite(ExportService::Job *job)
 {
         if (openedFor == IMPORT) {
                 qDebug() << "Can't write when opened for import!";
-                return;
+                return false;
         }
 
         QFile exportFile(filename);
-        exportFile.open(QIODevice::WriteOnly);
-        QTextStream exportStream(&exportFile);
-
+        if (!exportFile.open(QIODevice::WriteOnly | QIODevice::Unbuffered)) {
+                return false;
+        }
 
+        ExportService::OutputBuffer out(exportFile, job);
         QStringList header = ScopyFileHeader::getHeader();
+        const QByteArray sep = separator.toUtf8();
+        const int rows = nrOfSamples;
+        bool done = true;
 
         //prepare header
-        exportStream << header[0] << separator << QString(SCOPY_VERSION_GIT) << "\n";
-        exportStream << header[1] << separator << QDate::currentDate().toString("dddd MMMM dd/MM/yyyy") << "\n";
-        exportStream << header[2] << separator << "M2K" << "\n";
-        exportStream << header[3] << separator << data.size() << "\n";
-        exportStream << header[4] << separator << sampleRate << "\n";
-        exportStream << header[5] << separator << toolName << "\n";
-        exportStream << header[6] << separator << additionalInformation << "\n";
+        out.append(header[0] + separator + QString(SCOPY_VERSION_GIT) + "\n");
+        out.append(header[1] + separator + QDate::currentDate().toString("dddd MMMM dd/MM/yyyy") + "\n");
+        out.append(header[2] + separator + "M2K" + "\n");
+        out.append(header[3] + separator + QString::number(rows) + "\n");
+        out.append(header[4] + separator + QString::number(sampleRate) + "\n");
+        out.append(header[5] + separator + toolName + "\n");
+        out.append(header[6] + separator + additionalInformation + "\n");
 
         //column names row
-        exportStream << "Sample" << separator;
+        out.append("Sample" + separator);
         for (QString columnName : columnNames) {
-                exportStream << columnName << separator;
+                out.append(columnName + separator);
         }
-        exportStream << "\n";
+        out.append("\n");
 
-        for (int i = 0; i < data.size(); ++i) {
-                exportStream << QString::number(i) << separator;
-                for (int j = 0; j < data[i].size(); ++j) {
-                        exportStream << data[i][j] << ((j < data[i].size()-1) ? separator : "");
+        //the rows are formatted straight into the output buffer
+        for (int i = 0; i < rows; ++i) {
+                const QByteArray index = QByteArray::number(i);
+
+                out.append(index.constData(), index.size());
+                out.append(sep.constData(), sep.size());
+
+                for (int j = 0; j < columns.size(); ++j) {
+                        if (j) {
+                                out.append(sep.constData(), sep.size());
+                        }
+
+                        //short columns leave an empty field, so the
+                        //following values stay under their headers
+                        if (i >= columns[j].size()) {
+                                continue;
+                        }
+
+                        const QByteArray value = QByteArray::number(columns[j][i], 'g', 6);
+                        out.append(value.constData(), value.size());
+                }
+                out.append("\n", 1);
+
+                if ((i & 0xffff) == 0xffff && job && !job->reportProgress(i, rows)) {
+                        done = false;
+                        break;
                 }
-                exportStream << "\n";
         }
 
+        done = out.flush() && done;
         exportFile.close();
+
+        if (!done) {
+                exportFile.remove();
+        }
+
+        return done;
 }
 
 QString FileManager::getAdditionalInformation() const
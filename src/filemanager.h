@@ -24,8 +24,13 @@
 #include <QVector>
 #include <QStringList>
 
+#include "export_service.hpp"
+
 #include <exception>
+#include <functional>
 #include <iostream>
+#include <utility>
+#include <vector>
 
 
 namespace adiscope {
@@ -48,17 +53,29 @@ public:
 		TXT
 	};
 
+        /* Receives the progress of an import, in percent. Returning
+         * false cancels the import. It is called from the thread running
+         * open(), which can be a worker thread. */
+        typedef std::function<bool(int)> ProgressCallback;
+
         FileManager(QString toolName);
         ~FileManager();
 
 	void open(QString fileName, FileManager::FilePurpose filepurpose = EXPORT);
+        void setProgressCallback(ProgressCallback callback);
 
+        /* Adds a column to the exported data. The columns are kept as
+         * given, so they can be saved on one thread and written on
+         * another. */
         void save(QVector<double> data, QString name);
         void save(QVector<QVector<double>> data, QStringList column_names);
 
         QVector<double> read(int index);
         QVector<QVector<double>> read();
 
+        /* The imported data, one vector per column */
+        QVector<QVector<double>> readColumns() const;
+
         void setColumnName(int index, QString name);
         QString getColumnName(int index);
 
@@ -68,7 +85,10 @@ public:
         double getNrOfSamples() const;
         int getNrOfChannels() const;
 
-        void performWrite();
+        /* Writes the exported data to the file, reporting the progress
+         * to the job if there is one. The file is removed if the export
+         * fails or is canceled. */
+        bool performWrite(ExportService::Job *job = nullptr);
 
         QString getAdditionalInformation() const;
         void setAdditionalInformation(const QString& value);
@@ -77,8 +97,18 @@ public:
         void setFormat(const FileFormat &value);
 
 private:
+        typedef std::pair<const char *, const char *> Field;
+
+        void parse(const char *begin, const char *end);
+        static void splitLine(const char *begin, const char *end, char sep,
+                              std::vector<Field> &fields);
+
+        /* Locale independent conversion of a number */
+        static bool parseDouble(const char *begin, const char *end,
+                                double &value);
 
-        QVector<QVector<double>> data;
+        QVector<QVector<double>> columns;
+        ProgressCallback progressCallback;
         QStringList columnNames;
         QString filename;
         bool hasHeader;
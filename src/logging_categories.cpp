@@ -14,4 +14,5 @@ Q_LOGGING_CATEGORY(CAT_PATTERN_GENERATOR, "patternGenerator")
 Q_LOGGING_CATEGORY(CAT_CALIBRATION, "calibration")
 Q_LOGGING_CATEGORY(CAT_CALIBRATION_MANUAL, "calibration.manual")
 Q_LOGGING_CATEGORY(CAT_IIO_MANAGER, "iioManager")
+Q_LOGGING_CATEGORY(CAT_TRACE, "trace")
 #endif
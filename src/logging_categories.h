@@ -17,6 +17,7 @@ Q_DECLARE_LOGGING_CATEGORY(CAT_PATTERN_GENERATOR)
 Q_DECLARE_LOGGING_CATEGORY(CAT_CALIBRATION)
 Q_DECLARE_LOGGING_CATEGORY(CAT_CALIBRATION_MANUAL)
 Q_DECLARE_LOGGING_CATEGORY(CAT_IIO_MANAGER)
+Q_DECLARE_LOGGING_CATEGORY(CAT_TRACE)
 #else
 #define CAT_TOOL_LAUNCHER
 #define CAT_OSCILLOSCOPE
@@ -31,6 +32,7 @@ Q_DECLARE_LOGGING_CATEGORY(CAT_IIO_MANAGER)
 #define CAT_CALIBRATION
 #define CAT_CALIBRATION_MANUAL
 #define CAT_IIO_MANAGER
+#define CAT_TRACE
 #endif
 
 #endif // LOGGING_CATEGORIES_H
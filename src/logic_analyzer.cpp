@@ -34,7 +34,6 @@
 #include <QMessageBox>
 #include <QDateTime>
 #include <QButtonGroup>
-#include <QDateTime>
 
 /* Local includes */
 #include "pulseview/pv/mainwindow.hpp"
@@ -59,6 +58,8 @@
 #include "osc_export_settings.h"
 #include "filemanager.h"
 #include "logic_analyzer_api.hpp"
+#include "logic_exporter.hpp"
+#include "logging_categories.h"
 
 /* Sigrok includes */
 #include <libsigrokcxx/libsigrokcxx.hpp>
@@ -132,7 +133,9 @@ LogicAnalyzer::LogicAnalyzer(struct iio_context *ctx,
 	scrolling_offset(0.0),
 	trigger_offset(0.0),
 	wheelEventGuard(nullptr),
-	active_plot_timebase(0.001)
+	active_plot_timebase(0.001),
+	exporter(new LogicExporter(this)),
+	resume_after_export(false)
 
 {
 	ui->setupUi(this);
@@ -284,6 +287,7 @@ LogicAnalyzer::LogicAnalyzer(struct iio_context *ctx,
 	main_win->setSizePolicy(QSizePolicy::Expanding, QSizePolicy::Expanding);
 	ui->centralWidgetLayout->addWidget(static_cast<QWidget * >(main_win));
 	main_win->select_device(logic_analyzer_ptr);
+	logic_analyzer_ptr->set_capture_session(&main_win->session_);
 
 	set_buffersize();
 	main_win->session_.set_timespanLimit(timespanLimitStream);
@@ -446,6 +450,8 @@ LogicAnalyzer::LogicAnalyzer(struct iio_context *ctx,
 	chm.highlightChannel(chm.get_channel_group(0));
 	chm_ui->update_ui();
 	init_export_settings();
+	connect(exporter, &LogicExporter::finished,
+		this, &LogicAnalyzer::exportFinished);
 	installWheelEventGuard();
 	min_detached_width = this->minimumWidth();
 	toolDetached(false);
@@ -561,6 +567,11 @@ LogicAnalyzer::~LogicAnalyzer()
 	}
 	delete api;
 
+	/* Don't resume the capture from a pending export */
+	disconnect(exporter, nullptr, this, nullptr);
+	exporter->cancel();
+	exporter->wait();
+
 	if(running)
 		startStop(false);
 	setDynamicProperty(runButton(), "disabled", false);
@@ -661,6 +672,27 @@ void LogicAnalyzer::updateAreaTimeTrigger()
 	ui->areaTimeTriggerLayout->setContentsMargins(newValue, 0, 0, 0);
 }
 
+/* Scrolls the plot so that a sample of the last capture is at its centre,
+ * the same way as dragging the buffer previewer does */
+void LogicAnalyzer::centerOnSample(uint64_t sample)
+{
+	std::shared_ptr<pv::data::Logic> logic_data = main_win->session_.get_logic_data();
+	if (!logic_data || logic_data->logic_segments().empty())
+		return;
+
+	const std::shared_ptr<pv::data::LogicSegment> segment =
+		logic_data->logic_segments().front();
+	const double samplerate = segment->samplerate() ? segment->samplerate() : 1.0;
+	const double time = segment->start_time().convert_to<double>() +
+		sample / samplerate;
+	const double timePos = time + main_win->view_->start_plot_offset();
+
+	main_win->view_->set_offset(timePos, active_plot_timebase * 10, false);
+	horiz_offset_after_drop = timePos;
+	scrolling_offset = timePos;
+	updateBufferPreviewer();
+}
+
 QString LogicAnalyzer::saveToFile()
 {
 	QString separator = "";
@@ -708,170 +740,60 @@ QString LogicAnalyzer::saveToFile()
 	}
 
 
-	if( separator != "" ) {
-		done = exportTabCsv(separator, filename);
-
-	} else {
-		QFile file(filename);
-		if( !file.open(QIODevice::WriteOnly)) {
-			return "";
-		}
-
-		QTextStream out(&file);
-
-		/* Write the general information */
-		out << startRow << "date " << QDateTime::currentDateTime().toString() << endRow;
-		out << startRow << "version Scopy - " << QString(SCOPY_VERSION_GIT) << endRow;
-		out << startRow << "comment " << QString::number(main_win->session_.get_logic_sample_count()) <<
-		       " samples acquired at " << QString::number(main_win->session_.get_samplerate()) <<
-		       " Hz " << endRow;
-
-
-		file.close();
-
-		done = exportVCD(filename, startRow, endRow);
+	std::shared_ptr<pv::data::Logic> logic_data = main_win->session_.get_logic_data();
+	if( !logic_data || logic_data->logic_segments().empty() ) {
+		if(paused)
+			startStop(true);
+		return "";
 	}
 
-	if(paused)
-		startStop(true);
-
-	return (done ? filename : "");
-}
+	LogicExporter::Settings export_settings;
 
-bool LogicAnalyzer::exportVCD(QString filename, QString startSep, QString endSep)
-{
-	uint64_t current_sample, prev_sample;
-	int current_bit, prev_bit, p;
-	QString timescaleFormat;
-	double timescale;
-	bool timestamp_written = false;
-
-        if( active_sampleRate == 0 ) {
-                return false;
-        }
-
-
-	QFile file(filename);
-	if( !file.open(QIODevice::Append)) {
-		return false;
+	export_settings.filename = filename;
+	for(unsigned int ch = 0; ch < no_channels; ch++) {
+		if( exportConfig[ch] )
+			export_settings.channels.push_back(ch);
 	}
 
-	QTextStream out(&file);
-
-	/* Write the specific header */
-	timescale = 1 / active_sampleRate;
-	if( timescale < 1e-6 ) {
-		timescaleFormat = "ns";
-		timescale *= 1e9;
-	}
-	else if( timescale < 1e-3 ) {
-		timescaleFormat = "us";
-		timescale *= 1e6;
-	}
-	else if( timescale < 1 ) {
-		timescaleFormat = "ms";
-		timescale *= 1e3;
+	if( separator != "" ) {
+		export_settings.format = LogicExporter::DELIMITED;
+		export_settings.separator = separator;
+		export_settings.sample_rate = main_win->session_.get_samplerate();
+	} else {
+		export_settings.format = LogicExporter::VCD;
+		export_settings.start_sep = startRow;
+		export_settings.end_sep = endRow;
+		export_settings.sample_rate = active_sampleRate;
+	}
+
+	/* The capture is resumed once the file is written */
+	done = exporter->start(logic_data->logic_segments().front(),
+		export_settings);
+	if( !done ) {
+		if(paused)
+			startStop(true);
+		return "";
 	}
-	else
-		timescaleFormat = "s";
 
-	out << startSep << "timescale " << QString::number(timescale) << " " << timescaleFormat << endSep;
-	out << startSep << "scope module Scopy" << endSep;
-	int counter = 0;
-	for(unsigned int ch = 0; ch < no_channels; ch++) {
-		if( exportConfig[ch] ) {
-			char c = '!' + counter;
-			out << startSep << "var wire 1 " << c << " DIO" <<
-			       QString::number(ch) << endSep;
-			counter++;
-		}
-	}
-	out << startSep << "upscope" << endSep;
-	out << startSep << "enddefinitions" << endSep;
+	resume_after_export = paused;
+	exportSettings->enableExportButton(false);
 
-	/* Write the values */
-	std::shared_ptr<pv::data::Logic> logic_data = main_win->session_.get_logic_data();
-	if(logic_data) {
-		shared_ptr<pv::data::LogicSegment> segment = logic_data->logic_segments().front();
-		uint64_t sample_count = segment->get_sample_count();
-		for(uint64_t i = 0; i < sample_count; i++) {
-			current_sample = segment->get_sample(i);
-			if( i == 0)
-				prev_sample = current_sample;
-			else
-				prev_sample = segment->get_sample(i-1);
-			timestamp_written = false;
-			p = 0;
-			for(unsigned int ch = 0; ch < no_channels; ch++) {
-
-				current_bit = (current_sample >> ch) & 1;
-				prev_bit = (prev_sample >> ch) & 1;
-
-				if((current_bit == prev_bit) && (i != 0)) {
-					p++;
-					continue;
-				}
-				if( !timestamp_written )
-					out << "#" << QString::number(i);
-				if(exportConfig[ch]) {
-					char c = '0' + current_bit;
-					char c2 = '!' + p;
-					out << ' ' << c << c2;
-					p++;
-					timestamp_written = true;
-				}
-			}
-			if(timestamp_written)
-				out << "\n";
-		}
-	}
-	else {
-		file.close();
-		return false;
-	}
-	file.close();
-	return true;
+	exporter->showProgress(this, filename);
+
+	return filename;
 }
 
-bool LogicAnalyzer::exportTabCsv(QString separator, QString filename)
+void LogicAnalyzer::exportFinished(bool done)
 {
-	FileManager fm("Logic Analyzer");
-	fm.open(filename, FileManager::EXPORT);
-
-	QStringList chNames;
-	for(unsigned int ch = 0; ch < no_channels; ch++) {
-		if( exportConfig[ch] ) {
-			chNames.push_back("Channel " + QString::number(ch));
-		}
-	}
+	if(!done)
+		qDebug(CAT_LOGIC_ANALYZER) << "Export failed or canceled";
 
-	QVector<QVector<double>> data;
+	exportSettings->enableExportButton(true);
 
-	std::shared_ptr<pv::data::Logic> logic_data = main_win->session_.get_logic_data();
-	if (!logic_data) {
-		return false;
-	} else {
-		shared_ptr<pv::data::LogicSegment> segment = logic_data->logic_segments().front();
-		for (unsigned int i = 0; i < segment->get_sample_count(); ++i) {
-			uint64_t sample = segment->get_sample(i);
-			QVector<double> line;
-			for (unsigned int ch = 0; ch < no_channels; ++ch) {
-				int bit = (sample >> ch) & 1;
-				if(exportConfig[ch]) {
-					line.push_back(bit);
-				}
-			}
-			data.push_back(line);
-		}
+	if(resume_after_export) {
+		resume_after_export = false;
+		startStop(true);
 	}
-
-	fm.setSampleRate(main_win->session_.get_samplerate());
-
-	fm.save(data, chNames);
-
-	fm.performWrite();
-
-	return true;
 }
 
 void LogicAnalyzer::btnExportPressed()
@@ -48,6 +48,9 @@ namespace view {
 class Viewport;
 class Ruler;
 }
+namespace data {
+class LogicSegment;
+}
 class Session;
 }
 
@@ -77,6 +80,7 @@ class ScaleSpinButton;
 class PositionSpinButton;
 class StateUpdater;
 class ExportSettings;
+class LogicExporter;
 
 class LogicAnalyzer : public Tool
 {
@@ -122,10 +126,12 @@ public:
 	int getCurrent_acquisition_mode() const;
 	void setCurrent_acquisition_mode(int value);
 	QString saveToFile();
+	void centerOnSample(uint64_t sample);
 	std::vector<std::string> get_iio_trigger_options();
 	bool isRunning() const;
 
 private Q_SLOTS:
+	void exportFinished(bool done);
 	void toggleRightMenu(bool);
 	void rightMenuFinished(bool opened);
 	void toggleLeftMenu(bool val);
@@ -291,8 +297,8 @@ private:
 	ExportSettings *exportSettings;
 	QMap<int, bool> exportConfig;
 	void init_export_settings();
-	bool exportTabCsv(QString separator, QString);
-	bool exportVCD(QString, QString, QString);
+	LogicExporter *exporter;
+	bool resume_after_export;
 	void init_buffer_scrolling();
 	void triggerRightMenuToggle(CustomPushButton *btn, bool checked);
 };
@@ -102,6 +102,16 @@ void LogicAnalyzer_API::setExternalTrigger(bool en)
 	lga->trigger_settings_ui->trigg_extern_en->setChecked(en);
 }
 
+double LogicAnalyzer_API::triggerHoldoff() const
+{
+	return lga->logic_analyzer_ptr->get_holdoff();
+}
+
+void LogicAnalyzer_API::setTriggerHoldoff(double val)
+{
+	lga->logic_analyzer_ptr->set_holdoff(val);
+}
+
 bool LogicAnalyzer_API::cursorsActive() const
 {
 	return lga->ui->boxCursors->isChecked();
@@ -171,6 +181,16 @@ void LogicAnalyzer_API::setExportAll(bool en)
 	lga->exportSettings->getExportAllButton()->setChecked(en);
 }
 
+bool LogicAnalyzer_API::transitionStorage() const
+{
+	return lga->main_win->session_.is_transition_storage();
+}
+
+void LogicAnalyzer_API::setTransitionStorage(bool en)
+{
+	lga->main_win->session_.set_transition_storage(en);
+}
+
 void LogicAnalyzer_API::load(QSettings &s)
 {
 	lga->apiLoading = true;
@@ -370,6 +390,76 @@ void LogicChannel_API::setRole(QString val)
 		getIndex())->setChannel_role(ch);
 }
 
+static pv::data::LogicSegment::SearchPattern
+toSearchPattern(const QVariantMap& pattern)
+{
+	pv::data::LogicSegment::SearchPattern p;
+
+	p.mask = pattern.value("mask", 0).toULongLong();
+	p.value = pattern.value("value", 0).toULongLong();
+	p.rising = pattern.value("rising", 0).toULongLong();
+	p.falling = pattern.value("falling", 0).toULongLong();
+	p.min_width = pattern.value("min_width", 0).toULongLong();
+
+	return p;
+}
+
+std::shared_ptr<pv::data::LogicSegment> LogicAnalyzer_API::lastSegment() const
+{
+	std::shared_ptr<pv::data::Logic> logic_data = lga->main_win->session_.get_logic_data();
+
+	if (!logic_data || logic_data->logic_segments().empty())
+		return nullptr;
+
+	return logic_data->logic_segments().front();
+}
+
+QList<int> LogicAnalyzer_API::findPattern(const QVariantMap& pattern,
+					  int start, int max_matches)
+{
+	QList<int> list;
+	std::vector<uint64_t> matches;
+	std::shared_ptr<pv::data::LogicSegment> segment = lastSegment();
+
+	if (!segment || start < 0)
+		return list;
+
+	segment->find_matches(matches, toSearchPattern(pattern), start,
+		segment->get_sample_count(),
+		max_matches < 0 ? ~0ULL : (uint64_t)max_matches);
+
+	for (uint64_t index : matches)
+		list.append((int)index);
+
+	return list;
+}
+
+int LogicAnalyzer_API::findNext(const QVariantMap& pattern, int from)
+{
+	QList<int> list = findPattern(pattern, from + 1, 1);
+
+	return list.empty() ? -1 : list.front();
+}
+
+int LogicAnalyzer_API::findPrevious(const QVariantMap& pattern, int before)
+{
+	std::shared_ptr<pv::data::LogicSegment> segment = lastSegment();
+	uint64_t index;
+
+	if (!segment || before <= 0 ||
+			!segment->find_previous_match(toSearchPattern(pattern),
+				before, index))
+		return -1;
+
+	return (int)index;
+}
+
+void LogicAnalyzer_API::centerOnSample(int sample)
+{
+	if (sample >= 0)
+		lga->centerOnSample(sample);
+}
+
 QList<int> LogicAnalyzer_API::data() const
 {
 	QList<int> list;
@@ -388,4 +478,20 @@ QList<int> LogicAnalyzer_API::data() const
 	}
 	return list;
 }
+
+QByteArray LogicAnalyzer_API::dataBuffer() const
+{
+	std::shared_ptr<pv::data::LogicSegment> segment = lastSegment();
+
+	if (!segment)
+		return QByteArray();
+
+	const uint64_t count = segment->get_sample_count();
+	uint8_t *samples;
+	QByteArray buffer = arrayBuffer(count * segment->unit_size(), samples);
+
+	segment->get_samples(samples, 0, count);
+
+	return buffer;
+}
 }
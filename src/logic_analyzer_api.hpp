@@ -17,11 +17,15 @@ class LogicAnalyzer_API : public ApiObject
 	Q_PROPERTY(double time_base READ getTimeBase WRITE setTimeBase)
 	Q_PROPERTY(QString run_mode READ runMode WRITE setRunMode)
 	Q_PROPERTY(bool external_trigger READ externalTrigger WRITE setExternalTrigger)
+	Q_PROPERTY(double trigger_holdoff READ triggerHoldoff WRITE setTriggerHoldoff)
 	Q_PROPERTY(bool cursors_active READ cursorsActive WRITE setCursorsActive)
 	Q_PROPERTY(bool cursors_locked READ cursorsLocked WRITE setCursorsLocked)
 	Q_PROPERTY(bool inactive_hidden READ inactiveHidden WRITE setInactiveHidden)
 	Q_PROPERTY(bool export_all READ getExportAll WRITE setExportAll)
+	Q_PROPERTY(bool transition_storage READ transitionStorage
+		WRITE setTransitionStorage)
 	Q_PROPERTY(QList<int> data READ data STORED false)
+	Q_PROPERTY(QByteArray data_buffer READ dataBuffer STORED false)
 
 public:
 	explicit LogicAnalyzer_API(LogicAnalyzer *lga) :
@@ -53,6 +57,9 @@ public:
 	bool externalTrigger() const;
 	void setExternalTrigger(bool val);
 
+	double triggerHoldoff() const;
+	void setTriggerHoldoff(double val);
+
 	bool cursorsActive() const;
 	void setCursorsActive(bool en);
 
@@ -65,13 +72,31 @@ public:
 	bool getExportAll() const;
 	void setExportAll(bool);
 
+	bool transitionStorage() const;
+	void setTransitionStorage(bool en);
+
 	Q_INVOKABLE void show();
 
+	/* A pattern is an object with the optional members mask, value,
+	 * rising, falling (channel bit masks) and min_width (samples) */
+	Q_INVOKABLE QList<int> findPattern(const QVariantMap& pattern,
+					   int start = 0, int max_matches = -1);
+	Q_INVOKABLE int findNext(const QVariantMap& pattern, int from);
+	Q_INVOKABLE int findPrevious(const QVariantMap& pattern, int before);
+	Q_INVOKABLE void centerOnSample(int sample);
+
 	QList<int> data() const;
+
+	/* The raw samples of the last capture, one bit per channel. A
+	 * sample takes 2 bytes on the M2K, read with a Uint16Array. */
+	QByteArray dataBuffer() const;
+
 	void load(QSettings &s);
 
 private:
 	LogicAnalyzer *lga;
+
+	std::shared_ptr<pv::data::LogicSegment> lastSegment() const;
 };
 
 class ChannelGroup_API : public ApiObject
@@ -0,0 +1,307 @@
+/*
+ * Copyright 2019 Analog Devices, Inc.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Radio; see the file LICENSE.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include "logic_exporter.hpp"
+#include "filemanager.h"
+#include "config.h"
+
+#include "pulseview/pv/data/logicsegment.hpp"
+
+#include <QDate>
+#include <QDateTime>
+#include <QFile>
+
+#include <algorithm>
+#include <cstring>
+#include <functional>
+
+/* Number of samples scanned at once for transitions */
+#define EXPORT_CHUNK		(1 << 20)
+
+using namespace adiscope;
+using pv::data::LogicSegment;
+
+namespace {
+
+const char digit_pairs[] =
+	"00010203040506070809"
+	"10111213141516171819"
+	"20212223242526272829"
+	"30313233343536373839"
+	"40414243444546474849"
+	"50515253545556575859"
+	"60616263646566676869"
+	"70717273747576777879"
+	"80818283848586878889"
+	"90919293949596979899";
+
+/* Writes the decimal representation of value, two digits at a time.
+ * Returns the end of the written text. */
+char *format_uint(char *out, uint64_t value)
+{
+	char tmp[20];
+	char *p = tmp + sizeof(tmp);
+
+	while (value >= 100) {
+		const unsigned int r = value % 100;
+
+		value /= 100;
+		p -= 2;
+		memcpy(p, digit_pairs + 2 * r, 2);
+	}
+
+	if (value >= 10) {
+		p -= 2;
+		memcpy(p, digit_pairs + 2 * value, 2);
+	} else {
+		*--p = '0' + value;
+	}
+
+	const size_t len = tmp + sizeof(tmp) - p;
+	memcpy(out, p, len);
+
+	return out + len;
+}
+}
+
+LogicExporter::LogicExporter(QObject *parent) :
+	ExportService(parent)
+{
+}
+
+LogicExporter::~LogicExporter()
+{
+	cancel();
+	wait();
+}
+
+bool LogicExporter::start(std::shared_ptr<LogicSegment> segment,
+		const Settings& settings)
+{
+	if (isRunning() || !segment)
+		return false;
+
+	this->segment = segment;
+	this->settings = settings;
+
+	return ExportService::start(std::bind(&LogicExporter::run, this,
+					      std::placeholders::_1));
+}
+
+bool LogicExporter::run(Job& job)
+{
+	QFile file(settings.filename);
+	bool done = false;
+
+	if (file.open(QIODevice::WriteOnly | QIODevice::Unbuffered)) {
+		OutputBuffer out(file, &job);
+
+		if (settings.format == VCD)
+			done = writeVcd(out, job);
+		else
+			done = writeDelimited(out, job);
+
+		done = out.flush() && done;
+		file.close();
+
+		if (!done)
+			file.remove();
+	}
+
+	segment.reset();
+	return done;
+}
+
+bool LogicExporter::writeVcd(OutputBuffer& out, Job& job)
+{
+	const QString& start = settings.start_sep;
+	const QString& end = settings.end_sep;
+	const uint64_t sample_count = segment->get_sample_count();
+	QString timescaleFormat;
+	double timescale;
+
+	if (settings.sample_rate == 0)
+		return false;
+
+	/* Write the general information */
+	out.append(start + "date " + QDateTime::currentDateTime().toString() + end);
+	out.append(start + "version Scopy - " + QString(SCOPY_VERSION_GIT) + end);
+	out.append(start + "comment " + QString::number(sample_count) +
+		" samples acquired at " + QString::number(settings.sample_rate) +
+		" Hz " + end);
+
+	/* Write the specific header */
+	timescale = 1 / settings.sample_rate;
+	if (timescale < 1e-6) {
+		timescaleFormat = "ns";
+		timescale *= 1e9;
+	} else if (timescale < 1e-3) {
+		timescaleFormat = "us";
+		timescale *= 1e6;
+	} else if (timescale < 1) {
+		timescaleFormat = "ms";
+		timescale *= 1e3;
+	} else {
+		timescaleFormat = "s";
+	}
+
+	out.append(start + "timescale " + QString::number(timescale) + " " +
+		timescaleFormat + end);
+	out.append(start + "scope module Scopy" + end);
+
+	uint64_t mask = 0;
+
+	for (int i = 0; i < settings.channels.size(); i++) {
+		const char id = '!' + i;
+
+		out.append(start + "var wire 1 " + QString(QChar(id)) + " DIO" +
+			QString::number(settings.channels[i]) + end);
+		mask |= 1ULL << settings.channels[i];
+	}
+
+	out.append(start + "upscope" + end);
+	out.append(start + "enddefinitions" + end);
+
+	if (!sample_count)
+		return !out.failed();
+
+	/* The first entry holds the initial values of all the channels */
+	std::vector<LogicSegment::Transition> transitions;
+	uint64_t prev_sample = ~segment->get_sample(0);
+
+	transitions.push_back(LogicSegment::Transition(0, ~prev_sample));
+
+	/* Longest line: the timestamp and a value for each channel */
+	const size_t max_line = 24 + 3 * settings.channels.size();
+
+	/* Consecutive chunks overlap by one sample, as the transitions
+	 * are looked up in (start, end) */
+	for (uint64_t first = 0, last = 0; last < sample_count;
+			first = last - 1) {
+		last = std::min<uint64_t>(first + EXPORT_CHUNK, sample_count);
+		segment->get_transitions(transitions, first, last, mask);
+
+		for (const LogicSegment::Transition &t : transitions) {
+			const uint64_t diff = (t.second ^ prev_sample) & mask;
+			char *p = out.reserve(max_line);
+
+			*p++ = '#';
+			p = format_uint(p, t.first);
+
+			for (int i = 0; i < settings.channels.size(); i++) {
+				const unsigned int ch = settings.channels[i];
+
+				if (!((diff >> ch) & 1))
+					continue;
+
+				*p++ = ' ';
+				*p++ = '0' + ((t.second >> ch) & 1);
+				*p++ = '!' + i;
+			}
+
+			*p++ = '\n';
+			out.commit(p);
+			prev_sample = t.second;
+		}
+
+		transitions.clear();
+
+		if (out.failed() || !job.reportProgress(last, sample_count))
+			return false;
+	}
+
+	return true;
+}
+
+bool LogicExporter::writeDelimited(OutputBuffer& out, Job& job)
+{
+	const QByteArray sep = settings.separator.toUtf8();
+	const QStringList header = ScopyFileHeader::getHeader();
+	const uint64_t sample_count = segment->get_sample_count();
+	const QString s = settings.separator;
+
+	/* Same header as FileManager::performWrite() */
+	out.append(header[0] + s + QString(SCOPY_VERSION_GIT) + "\n");
+	out.append(header[1] + s + QDate::currentDate().toString(
+		"dddd MMMM dd/MM/yyyy") + "\n");
+	out.append(header[2] + s + "M2K" + "\n");
+	out.append(header[3] + s + QString::number(sample_count) + "\n");
+	out.append(header[4] + s + QString::number(settings.sample_rate) + "\n");
+	out.append(header[5] + s + "Logic Analyzer" + "\n");
+	out.append(header[6] + s + "\n");
+
+	out.append("Sample" + s);
+	for (unsigned int ch : settings.channels)
+		out.append("Channel " + QString::number(ch) + s);
+	out.append("\n");
+
+	if (!sample_count)
+		return !out.failed();
+
+	/* The text following the sample number, rebuilt at every change */
+	std::vector<char> row;
+	uint64_t mask = 0;
+
+	for (unsigned int ch : settings.channels)
+		mask |= 1ULL << ch;
+
+	auto build_row = [&](uint64_t sample) {
+		row.clear();
+		row.insert(row.end(), sep.begin(), sep.end());
+		for (int i = 0; i < settings.channels.size(); i++) {
+			if (i)
+				row.insert(row.end(), sep.begin(), sep.end());
+			row.push_back('0' + ((sample >> settings.channels[i]) & 1));
+		}
+		row.push_back('\n');
+	};
+
+	std::vector<LogicSegment::Transition> transitions;
+	uint64_t index = 0;
+
+	build_row(segment->get_sample(0));
+
+	for (uint64_t first = 0, last = 0; last < sample_count;
+			first = last - 1) {
+		last = std::min<uint64_t>(first + EXPORT_CHUNK, sample_count);
+		segment->get_transitions(transitions, first, last, mask);
+		transitions.push_back(LogicSegment::Transition(last, 0));
+
+		for (const LogicSegment::Transition &t : transitions) {
+			/* Rows up to the next change are all the same */
+			for (; index < t.first; index++) {
+				char *p = out.reserve(20 + row.size());
+
+				p = format_uint(p, index);
+				memcpy(p, row.data(), row.size());
+				out.commit(p + row.size());
+			}
+
+			if (t.first < last)
+				build_row(t.second);
+		}
+
+		transitions.clear();
+
+		if (out.failed() || !job.reportProgress(last, sample_count))
+			return false;
+	}
+
+	return true;
+}
@@ -0,0 +1,91 @@
+/*
+ * Copyright 2019 Analog Devices, Inc.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Radio; see the file LICENSE.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef LOGIC_EXPORTER_HPP
+#define LOGIC_EXPORTER_HPP
+
+#include "export_service.hpp"
+
+#include <QString>
+#include <QVector>
+
+#include <memory>
+
+namespace pv {
+namespace data {
+class LogicSegment;
+}
+}
+
+namespace adiscope {
+
+/*
+ * Writes a logic analyzer capture to a file on a worker thread.
+ *
+ * Only the samples where a channel changes are looked at: for VCD files
+ * they are the only ones written, for delimited files the text of a row
+ * is built once per change and copied for the following samples. Numbers
+ * are formatted into a large buffer which is written with few syscalls.
+ */
+class LogicExporter : public ExportService
+{
+	Q_OBJECT
+
+public:
+	enum Format {
+		VCD,
+		DELIMITED,
+	};
+
+	struct Settings {
+		Format format;
+		QString filename;
+
+		/* Sample rate written in the header; the VCD timescale */
+		double sample_rate;
+
+		/* The exported channels, in ascending order */
+		QVector<unsigned int> channels;
+
+		/* VCD: delimiters of the header commands */
+		QString start_sep, end_sep;
+
+		/* Delimited: column separator */
+		QString separator;
+	};
+
+	explicit LogicExporter(QObject *parent = nullptr);
+	~LogicExporter();
+
+	/* The segment is kept alive until the export is over. Returns
+	 * false if an export is already running. */
+	bool start(std::shared_ptr<pv::data::LogicSegment> segment,
+		   const Settings& settings);
+
+private:
+	std::shared_ptr<pv::data::LogicSegment> segment;
+	Settings settings;
+
+	bool run(Job& job);
+	bool writeVcd(OutputBuffer& out, Job& job);
+	bool writeDelimited(OutputBuffer& out, Job& job);
+};
+}
+
+#endif /* LOGIC_EXPORTER_HPP */
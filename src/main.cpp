@@ -28,6 +28,7 @@
 #include "config.h"
 #include "tool_launcher.hpp"
 #include "scopyApplication.hpp"
+#include "trace.hpp"
 
 using namespace adiscope;
 
@@ -88,11 +89,18 @@ int main(int argc, char **argv)
 	parser.addOptions({
 		{ {"s", "script"}, "Run given script.", "script" },
 		{ {"n", "nogui"}, "Run Scopy without GUI" },
-		{ {"d", "nodecoders"}, "Run Scopy without digital decoders"}
+		{ {"d", "nodecoders"}, "Run Scopy without digital decoders"},
+		{ {"t", "trace"}, "Write a Chrome trace of the startup to the given file.", "file" }
 	});
 
 	parser.process(app);
 
+	QString trace = parser.value("trace");
+	if (trace.isEmpty())
+		trace = qgetenv("SCOPY_TRACE");
+	if (!trace.isEmpty())
+		Trace::start(trace);
+
 	ToolLauncher launcher(prevCrashDump);
 
 	bool nogui = parser.isSet("nogui");
@@ -130,5 +138,9 @@ int main(int argc, char **argv)
 	}
 
 
-	return app.exec();
+	int ret = app.exec();
+
+	Trace::finish();
+
+	return ret;
 }
@@ -26,6 +26,7 @@
 #include "hardware_trigger.hpp"
 #include "ui_network_analyzer.h"
 #include "filemanager.h"
+#include "export_service.hpp"
 
 #include <gnuradio/analog/sig_source_c.h>
 #include <gnuradio/analog/sig_source_waveform.h>
@@ -194,6 +195,7 @@ NetworkAnalyzer::NetworkAnalyzer(struct iio_context *ctx, Filter *filt,
 	}
 
 	ui->setupUi(this);
+	exporter = new ExportService(this);
 
 	bufferPreviewer = new NetworkAnalyzerBufferViewer();
 	bufferPreviewer->setVisible(false);
@@ -752,18 +754,29 @@ void NetworkAnalyzer::on_btnExport_clicked()
 				       "Tab-delimited values files (*.txt)"});
 
 	if (export_dialog->exec()) {
-		FileManager fm("Network Analyzer");
-
-		fm.open(export_dialog->selectedFiles().at(0), FileManager::EXPORT);
-
-		fm.setAdditionalInformation(ui->btnRefChn->isChecked() ?
-					    "Reference channel: 1" : "Reference channel: 2");
-
-		fm.save(m_dBgraph.getXAxisData(), "Frequency(Hz)");
-		fm.save(m_dBgraph.getYAxisData(), "Magnitude(dB)");
-		fm.save(m_phaseGraph.getYAxisData(), "Phase(°)");
+		const QString fileName = export_dialog->selectedFiles().at(0);
+		const QString info = ui->btnRefChn->isChecked() ?
+				     "Reference channel: 1" : "Reference channel: 2";
+		const QVector<double> frequency = m_dBgraph.getXAxisData();
+		const QVector<double> magnitude = m_dBgraph.getYAxisData();
+		const QVector<double> phase = m_phaseGraph.getYAxisData();
+
+		bool started = exporter->start([=](ExportService::Job& job) {
+			FileManager fm("Network Analyzer");
+
+			fm.open(fileName, FileManager::EXPORT);
+			fm.setAdditionalInformation(info);
+			fm.save(frequency, "Frequency(Hz)");
+			fm.save(magnitude, "Magnitude(dB)");
+			fm.save(phase, "Phase(°)");
+
+			return fm.performWrite(&job);
+		});
 
-		fm.performWrite();
+		if (started)
+			exporter->showProgress(this, fileName);
+		else
+			qDebug(CAT_NETWORK_ANALYZER) << "An export is already running";
 	}
 }
 
@@ -75,6 +75,7 @@ class NetworkAnalyzer_API;
 class Filter;
 class GenericAdc;
 class GenericDac;
+class ExportService;
 
 class NetworkAnalyzer : public Tool
 {
@@ -114,6 +115,7 @@ private:
 
 	dBgraph m_dBgraph;
 	dBgraph m_phaseGraph;
+	ExportService *exporter;
 	bool wasChecked;
 
 	typedef struct NetworkAnalyzerIteration {
@@ -249,4 +249,19 @@ QList<double> NetworkAnalyzer_API::phase() const
 	return list;
 }
 
+QByteArray NetworkAnalyzer_API::dataBuffer() const
+{
+	return arrayBuffer(net->m_dBgraph.curveData(), true);
+}
+
+QByteArray NetworkAnalyzer_API::freqBuffer() const
+{
+	return arrayBuffer(net->m_dBgraph.curveData());
+}
+
+QByteArray NetworkAnalyzer_API::phaseBuffer() const
+{
+	return arrayBuffer(net->m_phaseGraph.curveData(), true);
+}
+
 }
@@ -40,6 +40,9 @@ class NetworkAnalyzer_API : public ApiObject
 	Q_PROPERTY(QList<double> data READ data STORED false)
 	Q_PROPERTY(QList<double> phase READ phase STORED false)
 	Q_PROPERTY(QList<double> freq READ freq STORED false)
+	Q_PROPERTY(QByteArray data_buffer READ dataBuffer STORED false)
+	Q_PROPERTY(QByteArray phase_buffer READ phaseBuffer STORED false)
+	Q_PROPERTY(QByteArray freq_buffer READ freqBuffer STORED false)
 public:
 	explicit NetworkAnalyzer_API(NetworkAnalyzer *net) :
 		ApiObject(), net(net) {}
@@ -96,6 +99,11 @@ public:
 	QList<double> freq() const;
 	QList<double> phase() const;
 
+	/* Same as data, freq and phase, as Float64Array buffers */
+	QByteArray dataBuffer() const;
+	QByteArray freqBuffer() const;
+	QByteArray phaseBuffer() const;
+
 private:
 	NetworkAnalyzer *net;
 };
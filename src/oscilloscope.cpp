@@ -38,6 +38,12 @@
 #include <QtWidgets/QSpacerItem>
 #include <QSignalBlocker>
 #include <QComboBox>
+#include <QFutureWatcher>
+#include <QtConcurrentRun>
+
+#include <qwt_point_data.h>
+
+#include <atomic>
 
 /* Local includes */
 #include "logging_categories.h"
@@ -56,6 +62,8 @@
 #include "channel_widget.hpp"
 #include "signal_sample.hpp"
 #include "filemanager.h"
+#include "capture_file.hpp"
+#include "export_service.hpp"
 
 #include "oscilloscope_api.hpp"
 
@@ -133,6 +141,7 @@ Oscilloscope::Oscilloscope(struct iio_context *ctx, Filter *filt,
 	gatingEnabled(false)
 {
 	ui->setupUi(this);
+	exporter = new ExportService(this);
 	int triggers_panel = ui->stackedWidget->insertWidget(-1, &trigger_settings);
 
 	if (m2k_adc) {
@@ -969,7 +978,8 @@ void Oscilloscope::add_ref_waveform(unsigned int chIdx)
 
 	double ref_waveform_timebase = refChannelTimeBase->value();
 
-	int nr_of_samples_in_file = import_data.size();
+	int nr_of_samples_in_file = import_data.isEmpty() ? 0 :
+		import_data[0].size();
 
 	double mid_point_on_screen = (timeBase->value() * 8) - ((
 					     timeBase->value() * 8) - timePosition->value());
@@ -984,11 +994,8 @@ void Oscilloscope::add_ref_waveform(unsigned int chIdx)
 
 	if (!refChannelTimeBase->isEnabled()) chIdx++;
 
-	for (int i = 0; i < import_data.size(); ++i) {
-		if (chIdx >= import_data[i].size()) {
-			continue;
-		}
-		yData.push_back(import_data[i][chIdx]);
+	if (chIdx < import_data.size()) {
+		yData = import_data[chIdx];
 	}
 
 	qDebug() << "Added ref waveform with nr of samples: " << yData.size();
@@ -1535,7 +1542,8 @@ void Oscilloscope::btnExport_clicked(){
 	export_dialog->setFileMode( QFileDialog::AnyFile );
 	export_dialog->setAcceptMode( QFileDialog::AcceptSave );
 	export_dialog->setNameFilters({"Comma-separated values files (*.csv)",
-					       "Tab-delimited values files (*.txt)"});
+					       "Tab-delimited values files (*.txt)",
+					       "Scopy capture files (*.npz)"});
 	bool atleastOneChannelEnabled = false;
 	for (auto x : exportConfig.keys())
 		if (exportConfig[x]){
@@ -1546,35 +1554,213 @@ void Oscilloscope::btnExport_clicked(){
 		return;
 	}
 
-	if (export_dialog->exec()){
-		FileManager fm("Oscilloscope");
-		fm.open(export_dialog->selectedFiles().at(0), FileManager::EXPORT);
+	if (export_dialog->exec()) {
+		QString fileName = export_dialog->selectedFiles().at(0);
+		bool started;
+
+		if (export_dialog->selectedNameFilter().contains("*.npz")) {
+			if (!CaptureFileReader::isCaptureFile(fileName))
+				fileName += ".npz";
+
+			started = exportCapture(fileName);
+		} else {
+			started = exportText(fileName);
+		}
+
+		if (started)
+			exporter->showProgress(this, fileName);
+		else
+			qDebug(CAT_OSCILLOSCOPE) << "An export is already running";
+	}
+	pause(false);
+}
+
+QVector<double> Oscilloscope::curveValues(int curve, bool x)
+{
+	const QwtSeriesData<QPointF> *data = plot.Curve(curve)->data();
+	auto raw = dynamic_cast<const QwtCPointerData *>(data);
+
+	/* The curves of the channels point to the buffers of the plot,
+	 * which are copied at once */
+	QVector<double> values(data->size());
+
+	if (raw) {
+		const double *src = x ? raw->xData() : raw->yData();
+
+		std::copy(src, src + values.size(), values.begin());
+		return values;
+	}
+
+	for (int i = 0; i < values.size(); ++i)
+		values[i] = x ? data->sample(i).x() : data->sample(i).y();
+
+	return values;
+}
 
-		int channels_number = nb_channels + nb_math_channels;
-		QVector<double> time_data;
+bool Oscilloscope::exportText(const QString& fileName)
+{
+	const int channels_number = nb_channels + nb_math_channels;
+	QVector<QVector<double>> columns;
+	QStringList names;
+
+	if (exporter->isRunning())
+		return false;
 
-		for (int i = 0; i < plot.Curve(0)->data()->size(); ++i) {
-			time_data.push_back(plot.Curve(0)->sample(i).x());
+	/* Only the snapshot is taken here; the file is written by the
+	 * export service while the acquisition goes on */
+	columns.push_back(curveValues(0, true));
+	names.push_back("Time(S)");
+
+	for (int i = 0; i < channels_number; ++i) {
+		if (exportConfig[i]) {
+			QString chNo = (i > 1) ? QString::number(i - 1) : QString::number(i + 1);
+
+			columns.push_back(curveValues(i));
+			names.push_back(((i > 1) ? "M" : "CH") + chNo + "(V)");
 		}
+	}
 
-		fm.save(time_data, "Time(S)");
+	const double sampleRate = active_sample_rate;
 
-		for (int i = 0; i < channels_number; ++i){
-			if (exportConfig[i]){
-				QVector<double> data;
-				int samples = plot.Curve(i)->data()->size();
-				for (int j = 0; j < samples; ++j)
-					data.push_back(plot.Curve(i)->data()->sample(j).y());
-				QString chNo = (i > 1) ? QString::number(i - 1) : QString::number(i + 1);
+	return exporter->start([=](ExportService::Job& job) {
+		FileManager fm("Oscilloscope");
+
+		fm.open(fileName, FileManager::EXPORT);
+		fm.save(columns, names);
+		fm.setSampleRate(sampleRate);
+
+		return fm.performWrite(&job);
+	});
+}
 
-				fm.save(data, ((i > 1) ? "M" : "CH") + chNo + "(V)");
+bool Oscilloscope::exportCapture(const QString& fileName)
+{
+	auto conv = boost::dynamic_pointer_cast<adc_sample_conv>(
+			adc_samp_conv_block);
+	const int channels_number = nb_channels + nb_math_channels;
+	const QVector<double> time_data = curveValues(0, true);
+	QVector<QVector<double>> columns;
+	CaptureInfo info;
+
+	if (exporter->isRunning())
+		return false;
+
+	info.tool = "Oscilloscope";
+	info.sample_rate = active_sample_rate;
+
+	if (!time_data.isEmpty())
+		info.trigger_index = llround(-time_data[0] * active_sample_rate);
+
+	for (int i = 0; i < channels_number; ++i) {
+		if (!exportConfig[i])
+			continue;
+
+		const QVector<double> values = curveValues(i);
+		QString chNo = (i > 1) ? QString::number(i - 1) : QString::number(i + 1);
+		double gain, offset;
+
+		if (i < (int)nb_channels && conv) {
+			/* The ADC codes the values were computed from */
+			gain = adc_sample_conv::convSampleToVolts(1.0,
+					conv->correctionGain(i),
+					conv->filterCompensation(i), 0.0,
+					conv->hardwareGain(i));
+			offset = conv->offset(i);
+		} else {
+			/* Spread the range of the values over 16 bits */
+			double min = 0.0, max = 0.0;
+
+			if (!values.isEmpty()) {
+				auto range = std::minmax_element(values.begin(),
+								 values.end());
+				min = *range.first;
+				max = *range.second;
 			}
+
+			offset = (max + min) / 2.0;
+			gain = (max > min) ? (max - min) / 65534.0 : 1.0;
 		}
 
-		fm.setSampleRate(active_sample_rate);
-		fm.performWrite();
+		columns.push_back(values);
+		info.channel_names.push_back(((i > 1) ? "M" : "CH") + chNo + "(V)");
+		info.gain.push_back(gain);
+		info.offset.push_back(offset);
 	}
-	pause(false);
+
+	const int samples = time_data.size();
+
+	return exporter->start([=](ExportService::Job& job) -> bool {
+		CaptureFileWriter writer;
+
+		if (!writer.open(fileName, info, CaptureFileWriter::INT16,
+				 samples))
+			return false;
+
+		/* Quantize and interleave the channels one chunk at a time */
+		const int chunk = 65536;
+		std::vector<int16_t> codes(chunk * columns.size());
+
+		for (int first = 0; first < samples; first += chunk) {
+			const int rows = std::min(chunk, samples - first);
+
+			for (int c = 0; c < columns.size(); ++c) {
+				const QVector<double>& values = columns[c];
+
+				for (int j = 0; j < rows; ++j) {
+					const double value = first + j < values.size() ?
+						values[first + j] : 0.0;
+					const long code = lround((value - info.offset[c]) /
+								 info.gain[c]);
+
+					codes[j * columns.size() + c] = (int16_t)
+						std::min(32767L, std::max(-32768L, code));
+				}
+			}
+
+			if (!writer.write(codes.data(), rows))
+				return false;
+
+			job.addBytes(rows * columns.size() * sizeof(int16_t));
+			if (!job.reportProgress(first + rows, samples)) {
+				writer.abort();
+				return false;
+			}
+		}
+
+		return writer.close();
+	});
+}
+
+bool Oscilloscope::importCapture(const QString& fileName)
+{
+	CaptureFileReader reader;
+
+	if (!reader.open(fileName))
+		return false;
+
+	const CaptureInfo& info = reader.info();
+	const double sampRate = info.sample_rate ? info.sample_rate : 1.0;
+	QVector<double> time_data(reader.nbSamples());
+
+	/* Same layout as the Scopy text files: the time, then the channels */
+	for (int i = 0; i < time_data.size(); ++i)
+		time_data[i] = (i - info.trigger_index) / sampRate;
+
+	import_data.push_back(time_data);
+	for (unsigned int i = 0; i < reader.nbChannels(); ++i)
+		import_data.push_back(reader.channel(i));
+
+	refChannelTimeBase->setEnabled(false);
+	refChannelTimeBase->setValue((reader.nbSamples() / 16.0) / sampRate);
+
+	import_error = fileName;
+	Q_EMIT importFileLoaded(true);
+
+	for (unsigned int i = 0; i < reader.nbChannels(); ++i)
+		importSettings->addChannel(i,
+			QString(info.channel_names[i]).remove("(V)"));
+
+	return true;
 }
 
 void Oscilloscope::create_add_channel_panel()
@@ -1730,47 +1916,88 @@ void Oscilloscope::import()
 	QString fileName = QFileDialog::getOpenFileName(this,
 	                   tr("Open import file"), "",
 			   tr({"Comma-separated values files (*.csv);;"
-			       "Tab-delimited values files (*.txt)"}));
+			       "Tab-delimited values files (*.txt);;"
+			       "Scopy capture files (*.npz)"}));
 
 	FileManager fm("Oscilloscope");
 
 	importSettings->clear();
 	import_data.clear();
 
-	try {
-		fm.open(fileName, FileManager::IMPORT);
+	if (CaptureFileReader::isCaptureFile(fileName)) {
+		if (!importCapture(fileName)) {
+			import_error = tr("File is corrupted!");
+			Q_EMIT importFileLoaded(false);
+		}
+		return;
+	}
 
-		double nrOfSamples = fm.getNrOfSamples();
-		double sampRate = fm.getSampleRate();
-		double timeBase = (nrOfSamples / 16.0) / sampRate;
+	/* The file is parsed on a worker thread, while the progress
+	 * dialog keeps the GUI responsive */
+	QProgressDialog progress(tr("Importing ") +
+				 QFileInfo(fileName).fileName(),
+				 tr("Cancel"), 0, 100, this);
+	std::atomic<bool> canceled(false);
 
-		if (fm.getFormat() == FileManager::RAW) {
-			refChannelTimeBase->setEnabled(true);
-		} else {
-			refChannelTimeBase->setEnabled(false);
-			refChannelTimeBase->setValue(timeBase);
-		}
+	progress.setWindowModality(Qt::WindowModal);
+	progress.setMinimumDuration(0);
+	connect(&progress, &QProgressDialog::canceled, [&]() {
+		canceled = true;
+	});
 
-		QVector<QVector<double>> data = fm.read();
-		for (int i = 0; i < data.size(); ++i) {
-			import_data.push_back(data[i]);
-		}
+	fm.setProgressCallback([&](int percent) {
+		QMetaObject::invokeMethod(&progress, "setValue",
+					  Qt::QueuedConnection,
+					  Q_ARG(int, percent));
+		return !canceled;
+	});
 
-		import_error = fileName;
-		Q_EMIT importFileLoaded(true);
+	QEventLoop loop;
+	QFutureWatcher<QString> watcher;
 
-		for (int i = 0; i < fm.getNrOfChannels(); ++i) {
-			importSettings->addChannel(i, fm.getColumnName(i).remove("(V)"));
+	connect(&watcher, &QFutureWatcher<QString>::finished,
+		&loop, &QEventLoop::quit);
+	watcher.setFuture(QtConcurrent::run([&]() -> QString {
+		try {
+			fm.open(fileName, FileManager::IMPORT);
+		} catch (FileManagerException &ex) {
+			return QString(ex.what());
 		}
 
-		if (refChannelTimeBase->isEnabled()) {
-			plot.addPreview(import_data, refChannelTimeBase->value(),
-					this->timeBase->value(), timePosition->value());
-		}
+		return QString();
+	}));
+	loop.exec();
+	progress.close();
 
-	} catch (FileManagerException &ex) {
-		import_error = QString(ex.what());
+	if (!watcher.result().isEmpty()) {
+		import_error = watcher.result();
 		Q_EMIT importFileLoaded(false);
+		return;
+	}
+
+	double nrOfSamples = fm.getNrOfSamples();
+	double sampRate = fm.getSampleRate();
+	double timeBase = (nrOfSamples / 16.0) / sampRate;
+
+	if (fm.getFormat() == FileManager::RAW) {
+		refChannelTimeBase->setEnabled(true);
+	} else {
+		refChannelTimeBase->setEnabled(false);
+		refChannelTimeBase->setValue(timeBase);
+	}
+
+	import_data = fm.readColumns();
+
+	import_error = fileName;
+	Q_EMIT importFileLoaded(true);
+
+	for (int i = 0; i < fm.getNrOfChannels(); ++i) {
+		importSettings->addChannel(i, fm.getColumnName(i).remove("(V)"));
+	}
+
+	if (refChannelTimeBase->isEnabled()) {
+		plot.addPreview(import_data, refChannelTimeBase->value(),
+				this->timeBase->value(), timePosition->value());
 	}
 }
 
@@ -93,6 +93,7 @@ namespace adiscope {
 	class AnalogBufferPreviewer;
 	class ChannelWidget;
 	class signal_sample;
+	class ExportService;
 
 	class Oscilloscope : public Tool
 	{
@@ -295,6 +296,7 @@ namespace adiscope {
 		bool lastFunctionValid;
 
 		QMap<int, bool> exportConfig;
+		ExportService *exporter;
 
 		std::shared_ptr<SymmetricBufferMode> symmBufferMode;
 
@@ -435,6 +437,10 @@ namespace adiscope {
 		void deactivateAcCouplingTrigger();
 		void clearMathChannels();
 		void add_ref_waveform(unsigned int chIdx);
+		QVector<double> curveValues(int curve, bool x = false);
+		bool exportText(const QString& fileName);
+		bool exportCapture(const QString& fileName);
+		bool importCapture(const QString& fileName);
 		void init_selected_measurements(int, std::vector<int>);
 		void init_buffer_scrolling();
 		bool gainUpdateNeeded();
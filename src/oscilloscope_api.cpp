@@ -774,6 +774,41 @@ QList<double> Channel_API::data() const
 	return list;
 }
 
+QByteArray Channel_API::dataBuffer() const
+{
+	int index = osc->channels_api.indexOf(const_cast<Channel_API*>(this));
+	if(index < 0)
+		return QByteArray();
+
+	return arrayBuffer(osc->plot.Curve(index)->data());
+}
+
+#define CHANNEL_MEASUREMENTS(X) \
+	X(period, PERIOD) \
+	X(frequency, FREQUENCY) \
+	X(min, MIN) \
+	X(max, MAX) \
+	X(peak_to_peak, PEAK_PEAK) \
+	X(mean, MEAN) \
+	X(cycle_mean, CYCLE_MEAN) \
+	X(rms, RMS) \
+	X(cycle_rms, CYCLE_RMS) \
+	X(ac_rms, AC_RMS) \
+	X(area, AREA) \
+	X(cycle_area, CYCLE_AREA) \
+	X(low, LOW) \
+	X(high, HIGH) \
+	X(amplitude, AMPLITUDE) \
+	X(middle, MIDDLE) \
+	X(pos_overshoot, P_OVER) \
+	X(neg_overshoot, N_OVER) \
+	X(rise, RISE) \
+	X(fall, FALL) \
+	X(pos_width, P_WIDTH) \
+	X(neg_width, N_WIDTH) \
+	X(pos_duty, P_DUTY) \
+	X(neg_duty, N_DUTY)
+
 #define DECLARE_MEASURE(m, t) \
 	double Channel_API::measured_ ## m () const\
 	{\
@@ -781,28 +816,23 @@ QList<double> Channel_API::data() const
 		auto measData = osc->plot.measurement(Measure::t, index);\
 		return measData->value();\
 	}
-DECLARE_MEASURE(period, PERIOD)
-DECLARE_MEASURE(frequency, FREQUENCY)
-DECLARE_MEASURE(min, MIN)
-DECLARE_MEASURE(max, MAX)
-DECLARE_MEASURE(peak_to_peak, PEAK_PEAK)
-DECLARE_MEASURE(mean, MEAN)
-DECLARE_MEASURE(cycle_mean, CYCLE_MEAN)
-DECLARE_MEASURE(rms, RMS)
-DECLARE_MEASURE(cycle_rms, CYCLE_RMS)
-DECLARE_MEASURE(ac_rms, AC_RMS)
-DECLARE_MEASURE(area, AREA)
-DECLARE_MEASURE(cycle_area, CYCLE_AREA)
-DECLARE_MEASURE(low, LOW)
-DECLARE_MEASURE(high, HIGH)
-DECLARE_MEASURE(amplitude, AMPLITUDE)
-DECLARE_MEASURE(middle, MIDDLE)
-DECLARE_MEASURE(pos_overshoot, P_OVER)
-DECLARE_MEASURE(neg_overshoot, N_OVER)
-DECLARE_MEASURE(rise, RISE)
-DECLARE_MEASURE(fall, FALL)
-DECLARE_MEASURE(pos_width, P_WIDTH)
-DECLARE_MEASURE(neg_width, N_WIDTH)
-DECLARE_MEASURE(pos_duty, P_DUTY)
-DECLARE_MEASURE(neg_duty, N_DUTY)
+CHANNEL_MEASUREMENTS(DECLARE_MEASURE)
+
+QVariantMap Channel_API::measurements() const
+{
+	QVariantMap map;
+	int index = osc->channels_api.indexOf(const_cast<Channel_API*>(this));
+	if(index < 0)
+		return map;
+
+	auto measurements = osc->plot.measurements(index);
+
+#define INSERT_MEASURE(m, t) \
+	if (Measure::t < measurements.size()) \
+		map.insert(#m, measurements[Measure::t]->value());
+	CHANNEL_MEASUREMENTS(INSERT_MEASURE)
+#undef INSERT_MEASURE
+
+	return map;
+}
 }
@@ -268,6 +268,8 @@ public:
 	Q_PROPERTY(double pos_duty READ measured_pos_duty)
 	Q_PROPERTY(double neg_duty READ measured_neg_duty)
 	Q_PROPERTY(QList<double> data READ data STORED false)
+	Q_PROPERTY(QByteArray data_buffer READ dataBuffer STORED false)
+	Q_PROPERTY(QVariantMap measurements READ measurements STORED false)
 public:
 	explicit Channel_API(Oscilloscope *osc) :
 		ApiObject(), osc(osc) {}
@@ -317,6 +319,12 @@ public:
 	double measured_neg_duty() const;
 	QList<double> data() const;
 
+	/* The samples of the last capture, as a Float64Array buffer */
+	QByteArray dataBuffer() const;
+
+	/* All the measured_ values at once, keyed by their names */
+	QVariantMap measurements() const;
+
 	Q_INVOKABLE void setColor(int, int, int, int a = 255);
 
 private:
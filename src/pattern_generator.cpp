@@ -128,11 +128,11 @@ PatternGenerator::runState PatternGenerator::pgStatus()
 void PatternGenerator::enableBufferUpdates(bool enabled)
 {
 	if (enabled) {
-		connect(getCurrentPatternUI(),SIGNAL(patternParamsChanged()),bufui,
-		        SLOT(updateUi()));
+		connect(getCurrentPatternUI(),SIGNAL(patternParamsChanged()),this,
+		        SLOT(patternParamsChanged()));
 	} else {
-		disconnect(getCurrentPatternUI(),SIGNAL(patternParamsChanged()),bufui,
-		           SLOT(updateUi()));
+		disconnect(getCurrentPatternUI(),SIGNAL(patternParamsChanged()),this,
+		           SLOT(patternParamsChanged()));
 	}
 }
 
@@ -616,6 +616,7 @@ void PatternGenerator::patternChanged(int index)
 	chg->pattern->deinit();
 	delete chg->pattern;
 	chg->pattern = PatternFactory::create(index);
+	chg->setDirty();
 
 	deleteSettingsWidget();
 	createSettingsWidget();
@@ -623,6 +624,18 @@ void PatternGenerator::patternChanged(int index)
 	bufui->updateUi();
 }
 
+void PatternGenerator::patternParamsChanged()
+{
+	/* The settings widget always edits the highlighted group */
+	auto chg = chm.getHighlightedChannelGroup();
+
+	if (chg) {
+		chg->setDirty();
+	}
+
+	bufui->updateUi();
+}
+
 void PatternGenerator::deleteSettingsWidget()
 {
 	if (currentUI!=nullptr) {
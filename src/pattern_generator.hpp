@@ -200,6 +200,7 @@ private Q_SLOTS:
 	void reloadBufferInDevice();
 	void outputModeChanged(int index);
 	void patternChanged(int index);
+	void patternParamsChanged();
 	void configureAutoSet();
 	void changeName(QString name);
 	void changeChannelThickness(QString);
@@ -115,6 +115,7 @@ void PatternGeneratorChannelGroup_API::setPattern(QString str)
 	chg->pattern->deinit();
 	delete chg->pattern;
 	chg->pattern = Pattern_API::fromString(str);
+	chg->setDirty();
 }
 
 QVariantList PatternGenerator_API::getChannelGroups()
@@ -1,6 +1,8 @@
 #include "pg_buffer_manager.hpp"
 #include "pattern_generator.hpp"
 
+#include <algorithm>
+
 namespace adiscope {
 
 PatternGeneratorBufferManager::PatternGeneratorBufferManager(
@@ -23,8 +25,50 @@ PatternGeneratorBufferManager::~PatternGeneratorBufferManager()
 void PatternGeneratorBufferManager::update(PatternGeneratorChannelGroup *chg)
 {
 	bool sampleRateChanged = false;
+	std::map<PatternGeneratorChannelGroup *, committed_group> current;
+	std::vector<PatternGeneratorChannelGroup *> changed;
+	uint16_t staleMask = 0;
+
+	if (chg) {
+		chg->setDirty();
+	}
+
+	/* A group is generated again if its pattern was edited, replaced,
+	 * or if its channels were moved around */
+	for (auto&& each : *chm->get_channel_groups()) {
+		auto pgchg = static_cast<PatternGeneratorChannelGroup *>(each);
+
+		if (!pgchg->is_enabled()) {
+			continue;
+		}
+
+		committed_group state;
+		state.pattern = pgchg->pattern;
+		state.mask = pgchg->get_mask();
+		state.ids = pgchg->get_ids();
+		current[pgchg] = state;
+
+		auto it = committed.find(pgchg);
+
+		if (pgchg->isDirty() || it == committed.end() ||
+		    it->second.pattern != state.pattern ||
+		    it->second.ids != state.ids) {
+			changed.push_back(pgchg);
+		}
+	}
+
+	/* Bits written by groups that changed or are gone must be cleared */
+	for (auto&& each : committed) {
+		auto it = current.find(each.first);
+
+		if (it == current.end() ||
+		    std::find(changed.begin(), changed.end(), each.first) !=
+		    changed.end()) {
+			staleMask |= each.second.mask;
+		}
+	}
 
-	chm->preGenerate();
+	chm->preGenerate(changed);
 	uint32_t suggestedSampleRate = (autoSet) ? chm->computeSuggestedSampleRate() :
 	                               sampleRate;
 	uint32_t adjustedSampleRate = adjustSampleRate(suggestedSampleRate);
@@ -44,24 +88,38 @@ void PatternGeneratorBufferManager::update(PatternGeneratorChannelGroup *chg)
 		bufferSizeChanged = true;
 	}
 
-	if (sampleRateChanged) {
-		// recreate sigrok buffer
-	}
-
 	if (bufferSizeChanged) {
 		// recreate local buffer
 		delete[] buffer;
 		buffer = new short[bufferSize];
 	}
 
-	memset(buffer, 0x0000, (bufferSize)*sizeof(short));
-	chm->generatePatterns(buffer, sampleRate, bufferSize);
-
-	if (sampleRateChanged || bufferSizeChanged) {
+	if (sampleRateChanged || bufferSizeChanged || !buffer_created) {
 		// regenerate all
-	} else {
-		// only generate current ?
+		changed.clear();
+
+		for (auto&& each : current) {
+			changed.push_back(each.first);
+		}
+
+		memset(buffer, 0x0000, (bufferSize)*sizeof(short));
+		buffer_created = true;
+	} else if (staleMask) {
+		// only generate the groups that changed
+		const short keepMask = ~staleMask;
+
+		for (uint32_t i = 0; i < bufferSize; i++) {
+			buffer[i] &= keepMask;
+		}
 	}
+
+	chm->generatePatterns(buffer, sampleRate, bufferSize, changed);
+
+	for (auto each : changed) {
+		each->setDirty(false);
+	}
+
+	committed.swap(current);
 }
 
 void PatternGeneratorBufferManager::enableAutoSet(bool val)
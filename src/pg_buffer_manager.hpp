@@ -5,6 +5,7 @@
 #include <stdlib.h>
 #include <fcntl.h>
 #include <vector>
+#include <map>
 #include <string.h>
 
 #include <iio.h>
@@ -51,6 +52,14 @@ class PatternGeneratorBufferManager
 	uint32_t sampleRate;
 	PatternGeneratorChannelManager *chm;
 
+	/* What each enabled group last wrote into the buffer */
+	struct committed_group {
+		Pattern *pattern;
+		uint16_t mask;
+		std::vector<uint16_t> ids;
+	};
+	std::map<PatternGeneratorChannelGroup *, committed_group> committed;
+
 public:
 	PatternGeneratorBufferManager(PatternGeneratorChannelManager *chman);
 	~PatternGeneratorBufferManager();
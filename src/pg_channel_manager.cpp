@@ -11,6 +11,7 @@
 #include "pattern_generator.hpp"
 #include "dynamicWidget.hpp"
 #include <glib.h>
+#include <QtConcurrent>
 #include "boost/math/common_factor.hpp"
 #include "libsigrokdecode/libsigrokdecode.h"
 #include <utils.h>
@@ -426,6 +427,17 @@ PatternGeneratorChannelGroup::PatternGeneratorChannelGroup(
 	enabled = false;
 	pattern=PatternFactory::create(0);
 	ch_thickness = 1.0;
+	dirty = true;
+}
+
+void PatternGeneratorChannelGroup::setDirty(bool val)
+{
+	dirty = val;
+}
+
+bool PatternGeneratorChannelGroup::isDirty() const
+{
+	return dirty;
 }
 
 PatternGeneratorChannelGroup::~PatternGeneratorChannelGroup()
@@ -1368,59 +1380,173 @@ void PatternGeneratorChannelManager::preGenerate()
 	}
 }
 
+void PatternGeneratorChannelManager::preGenerate(
+        const std::vector<PatternGeneratorChannelGroup *>& groups)
+{
+	for (auto chg : groups) {
+		chg->pattern->pre_generate();
+	}
+}
+
 void PatternGeneratorChannelManager::generatePatterns(short *mainBuffer,
                 uint32_t sampleRate, uint32_t bufferSize)
 {
+	std::vector<PatternGeneratorChannelGroup *> enabled;
+
 	for (auto&& chg : channel_group) {
 		PatternGeneratorChannelGroup *pgchg =
 		        static_cast<PatternGeneratorChannelGroup *>(chg);
 
 		if (pgchg->is_enabled()) {
-			pgchg->pattern->generate_pattern(sampleRate,bufferSize,
+			enabled.push_back(pgchg);
+		}
+	}
+
+	generatePatterns(mainBuffer, sampleRate, bufferSize, enabled);
+}
+
+void PatternGeneratorChannelManager::generatePatterns(short *mainBuffer,
+                uint32_t sampleRate, uint32_t bufferSize,
+                const std::vector<PatternGeneratorChannelGroup *>& enabled)
+{
+	QList<QFuture<void>> futures;
+
+	/* Generate the groups concurrently. Script patterns own a QJSEngine
+	 * that lives in the GUI thread, so they are generated here. */
+	for (auto pgchg : enabled) {
+		if (dynamic_cast<JSPattern *>(pgchg->pattern)) {
+			continue;
+		}
+
+		futures.append(QtConcurrent::run([=]() {
+			pgchg->pattern->generate_pattern(sampleRate, bufferSize,
 			                                 pgchg->get_channel_count());
-			commitBuffer(pgchg, mainBuffer, bufferSize);
-			pgchg->pattern->delete_buffer();
+		}));
+	}
+
+	for (auto pgchg : enabled) {
+		if (dynamic_cast<JSPattern *>(pgchg->pattern)) {
+			pgchg->pattern->generate_pattern(sampleRate, bufferSize,
+			                                 pgchg->get_channel_count());
+		}
+	}
+
+	for (auto&& future : futures) {
+		future.waitForFinished();
+	}
+
+	/* All the groups write to the same words, so the merge is split
+	 * on buffer ranges rather than on groups */
+	QVector<uint32_t> chunks;
+
+	for (uint32_t i = 0; i < bufferSize; i += commitChunkSize) {
+		chunks.push_back(i);
+	}
+
+	std::vector<BitScatterTable> tables;
+
+	for (auto pgchg : enabled) {
+		tables.push_back(BitScatterTable(pgchg));
+	}
+
+	QtConcurrent::blockingMap(chunks, [&](uint32_t start) {
+		uint32_t end = std::min(start + commitChunkSize, bufferSize);
+
+		for (size_t i = 0; i < enabled.size(); i++) {
+			commitBuffer(enabled[i], tables[i], mainBuffer,
+			             start, end);
 		}
+	});
+
+	for (auto pgchg : enabled) {
+		pgchg->pattern->delete_buffer();
 	}
 }
 
+const uint32_t PatternGeneratorChannelManager::commitChunkSize;
 
+BitScatterTable::BitScatterTable(const uint8_t *mapping, int nb_bits)
+{
+	init(mapping, nb_bits);
+}
 
-short PatternGeneratorChannelManager::remap_buffer(uint8_t *mapping,
-                uint32_t val)
+BitScatterTable::BitScatterTable(PatternGeneratorChannelGroup *chg)
 {
-	short ret=0;
-	int i=0;
+	uint8_t channel_mapping[16];
+	memset(channel_mapping,0x00,16*sizeof(uint8_t));
+
+	for (int i=0; i<chg->get_channel_count() && i<16; i++) {
+		channel_mapping[i] = chg->get_channel(i)->get_id();
+	}
+
+	init(channel_mapping, chg->get_channel_count());
+}
+
+void BitScatterTable::init(const uint8_t *mapping, int nb_bits)
+{
+	mask = 0;
+	ascending_order = true;
+
+	uint16_t bit_lo[8] = { 0 };
+	uint16_t bit_hi[8] = { 0 };
+
+	for (int i = 0; i < nb_bits && i < 16; i++) {
+		if (i < 8) {
+			bit_lo[i] = 1 << mapping[i];
+		} else {
+			bit_hi[i - 8] = 1 << mapping[i];
+		}
 
-	while (val) {
-		if (val&0x01) {
-			ret = ret | (1<<mapping[i]);
+		if (i > 0 && mapping[i] <= mapping[i - 1]) {
+			ascending_order = false;
 		}
 
-		i++;
-		val>>=1;
+		mask |= 1 << mapping[i];
 	}
 
-	return ret;
+	/* Each entry is built from the one without its highest bit set */
+	lo[0] = hi[0] = 0;
+
+	for (int i = 1; i < 256; i++) {
+		int top = 31 - __builtin_clz(i);
+
+		lo[i] = lo[i & ~(1 << top)] | bit_lo[top];
+		hi[i] = hi[i & ~(1 << top)] | bit_hi[top];
+	}
 }
 
 void PatternGeneratorChannelManager::commitBuffer(PatternGeneratorChannelGroup
                 *chg, short *buffer, uint32_t bufferSize)
 {
-	uint8_t channel_mapping[16];
-	memset(channel_mapping,0x00,16*sizeof(uint8_t));
-	short *bufferPtr = chg->pattern->get_buffer();
-	int i=0;
-	auto buffer_channel_mask = (1<<chg->get_channel_count())-1;
+	commitBuffer(chg, BitScatterTable(chg), buffer, 0, bufferSize);
+}
 
-	for (i=0; i<chg->get_channel_count(); i++) {
-		channel_mapping[i] = chg->get_channel(i)->get_id();
+void PatternGeneratorChannelManager::commitBuffer(PatternGeneratorChannelGroup
+                *chg, const BitScatterTable& scatter, short *buffer,
+                uint32_t start, uint32_t end)
+{
+	const short *bufferPtr = chg->pattern->get_buffer();
+	const uint16_t buffer_channel_mask = (1<<chg->get_channel_count())-1;
+	const uint16_t keep_mask = ~(chg->get_mask());
+	uint16_t scattered[commitChunkSize];
+
+	if (!bufferPtr) {
+		return;
 	}
 
-	for (auto i=0; i< bufferSize; i++) {
-		auto val = (bufferPtr[i] & buffer_channel_mask);
-		buffer[i] = (buffer[i] & ~(chg->get_mask())) | remap_buffer(channel_mapping,
-		                val);
+	for (uint32_t pos = start; pos < end; pos += commitChunkSize) {
+		const uint32_t len = std::min(end - pos, commitChunkSize);
+
+		for (uint32_t i = 0; i < len; i++) {
+			scattered[i] = scatter(bufferPtr[pos + i] &
+			                       buffer_channel_mask);
+		}
+
+		/* Branch free, vectorized by the compiler */
+		for (uint32_t i = 0; i < len; i++) {
+			buffer[pos + i] = (buffer[pos + i] & keep_mask) |
+			                  scattered[i];
+		}
 	}
 }
 
@@ -10,6 +10,10 @@
 #include <QDrag>
 #include <QBitmap>
 
+#ifdef __BMI2__
+#include <immintrin.h>
+#endif
+
 #include "libsigrokdecode/libsigrokdecode.h"
 #include "pg_patterns.hpp"
 #include "digitalchannel_manager.hpp"
@@ -123,8 +127,13 @@ public:
 	qreal getCh_thickness() const;
 	void setCh_thickness(const qreal value, bool setChannels=true);
 
+	/* The pattern must be generated again at the next buffer update */
+	void setDirty(bool val = true);
+	bool isDirty() const;
+
 private:
 	qreal ch_thickness;
+	bool dirty;
 };
 
 class PatternGeneratorChannelGroupUI : public ChannelGroupUI
@@ -205,11 +214,42 @@ private:
 };
 
 
+/*
+ * Scatters the bits of a channel group value onto the DIO indices of its
+ * channels, with two 256 entry lookup tables instead of a loop over the
+ * bits of every sample.
+ */
+class BitScatterTable
+{
+public:
+	BitScatterTable(const uint8_t *mapping, int nb_bits);
+	explicit BitScatterTable(PatternGeneratorChannelGroup *chg);
+
+	inline uint16_t operator()(uint16_t val) const
+	{
+#ifdef __BMI2__
+		if (ascending_order) {
+			return _pdep_u32(val, mask);
+		}
+#endif
+		return lo[val & 0xff] | hi[val >> 8];
+	}
+
+private:
+	uint16_t lo[256];
+	uint16_t hi[256];
+	uint16_t mask;
+	bool ascending_order; // DIO indices increase with the bit index
+
+	void init(const uint8_t *mapping, int nb_bits);
+};
+
 class PatternGeneratorChannelManager : public ChannelManager
 {
 	PatternGeneratorChannelGroup *highlightedChannelGroup;
 	PatternGeneratorChannel *highlightedChannel;
 	const uint32_t maxBufferSize = 1000000;
+	static const uint32_t commitChunkSize = 4096;
 
 public:
 	void highlightChannel(PatternGeneratorChannelGroup *chg,
@@ -227,11 +267,17 @@ public:
 	void moveChannel(int fromChgIndex, int from, int to, bool after=true);
 	void splitChannel(int chgIndex, int chIndex);
 	void preGenerate();
+	void preGenerate(const std::vector<PatternGeneratorChannelGroup *>& groups);
 	void generatePatterns(short *mainbuffer, uint32_t sampleRate,
 	                      uint32_t bufferSize);
+	void generatePatterns(short *mainbuffer, uint32_t sampleRate,
+	                      uint32_t bufferSize,
+	                      const std::vector<PatternGeneratorChannelGroup *>& groups);
 	void commitBuffer(PatternGeneratorChannelGroup *chg, short *mainBuffer,
 	                  uint32_t bufferSize);
-	short remap_buffer(uint8_t *mapping, uint32_t val);
+	void commitBuffer(PatternGeneratorChannelGroup *chg,
+	                  const BitScatterTable& scatter, short *mainBuffer,
+	                  uint32_t start, uint32_t end);
 
 	uint32_t computeSuggestedSampleRate();
 	uint32_t computeSuggestedBufferSize(uint32_t sample_rate);
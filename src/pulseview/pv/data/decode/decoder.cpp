@@ -18,6 +18,7 @@
  * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301 USA
  */
 
+#include <algorithm>
 #include <cassert>
 
 #include <libsigrokcxx/libsigrokcxx.hpp>
@@ -31,6 +32,7 @@ using std::set;
 using std::map;
 using std::shared_ptr;
 using std::string;
+using std::vector;
 
 namespace pv {
 namespace data {
@@ -111,7 +113,8 @@ set< shared_ptr<pv::data::Logic> > Decoder::get_data()
 	return data;
 }
 
-srd_decoder_inst* Decoder::create_decoder_inst(srd_session *session) const
+srd_decoder_inst* Decoder::create_decoder_inst(srd_session *session,
+	const vector<unsigned int> &channels) const
 {
 	GHashTable *const opt_hash = g_hash_table_new_full(g_str_hash,
 		g_str_equal, g_free, (GDestroyNotify)g_variant_unref);
@@ -131,18 +134,22 @@ srd_decoder_inst* Decoder::create_decoder_inst(srd_session *session) const
 		return nullptr;
 
 	// Setup the channels
-	GHashTable *const channels = g_hash_table_new_full(g_str_hash,
+	GHashTable *const channel_hash = g_hash_table_new_full(g_str_hash,
 		g_str_equal, g_free, (GDestroyNotify)g_variant_unref);
 
 	for (const auto& channel : channels_) {
 		shared_ptr<view::LogicSignal> signal(channel.second);
+		const auto pos = std::find(channels.begin(), channels.end(),
+			(unsigned int)signal->channel()->index());
+		assert(pos != channels.end());
+
 		GVariant *const gvar = g_variant_new_int32(
-			signal->channel()->index());
+			pos - channels.begin());
 		g_variant_ref_sink(gvar);
-		g_hash_table_insert(channels, channel.first->id, gvar);
+		g_hash_table_insert(channel_hash, channel.first->id, gvar);
 	}
 
-	srd_inst_channel_set_all(decoder_inst, channels);
+	srd_inst_channel_set_all(decoder_inst, channel_hash);
 
 	return decoder_inst;
 }
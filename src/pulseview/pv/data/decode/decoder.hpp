@@ -24,6 +24,7 @@
 #include <map>
 #include <memory>
 #include <set>
+#include <vector>
 
 #include <glib.h>
 
@@ -67,8 +68,13 @@ public:
 
 	bool have_required_channels() const;
 
-	srd_decoder_inst* create_decoder_inst(
-		srd_session *session) const;
+	/**
+	 * @param channels The logic channels of the samples sent to the
+	 * session, in order. The decoder channels are numbered after their
+	 * position in this list.
+	 */
+	srd_decoder_inst* create_decoder_inst(srd_session *session,
+		const std::vector<unsigned int> &channels) const;
 
 	std::set< std::shared_ptr<pv::data::Logic> > get_data();
 
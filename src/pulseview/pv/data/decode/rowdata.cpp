@@ -20,36 +20,193 @@
 
 #include "rowdata.hpp"
 
+#include <algorithm>
+#include <climits>
+
+using std::max;
+using std::min;
 using std::vector;
 
 namespace pv {
 namespace data {
 namespace decode {
 
-RowData::RowData()
+const size_t RowData::LeafSize = 32;
+const int RowData::EmptyFormat = INT_MIN;
+const int RowData::MixedFormat = -1;
+
+RowData::RowData() :
+	leaf_count_(0),
+	unsorted_(false),
+	max_end_(0)
 {
 }
 
+int RowData::merge_format(int a, int b)
+{
+	if (a == EmptyFormat)
+		return b;
+	if (b == EmptyFormat || a == b)
+		return a;
+	return MixedFormat;
+}
+
 uint64_t RowData::get_max_sample() const
 {
-	if (annotations_.empty())
-		return 0;
-	return annotations_.back().end_sample();
+	return max_end_;
+}
+
+template <typename Func, typename BlockFunc>
+void RowData::visit(size_t node, size_t first_leaf, size_t leaves,
+	size_t last, uint64_t start_sample, uint64_t min_length,
+	Func func, BlockFunc block_func) const
+{
+	const size_t first = first_leaf * LeafSize;
+
+	if (first >= last || index_[node].max_end <= start_sample)
+		return;
+
+	if (min_length && index_[node].max_end -
+		annotations_[first].start_sample() < min_length) {
+		block_func(node, first);
+		return;
+	}
+
+	if (leaves == 1) {
+		const size_t end = min(last, first + LeafSize);
+
+		for (size_t i = first; i < end; i++)
+			if (annotations_[i].end_sample() > start_sample)
+				func(i);
+		return;
+	}
+
+	visit(2 * node, first_leaf, leaves / 2, last, start_sample,
+		min_length, func, block_func);
+	visit(2 * node + 1, first_leaf + leaves / 2, leaves / 2, last,
+		start_sample, min_length, func, block_func);
 }
 
 void RowData::get_annotation_subset(
 	vector<pv::data::decode::Annotation> &dest,
 	uint64_t start_sample, uint64_t end_sample) const
 {
-	for (const auto& annotation : annotations_)
-		if (annotation.end_sample() > start_sample &&
-			annotation.start_sample() <= end_sample)
-			dest.push_back(annotation);
+	vector<Block> blocks;
+
+	get_annotation_subset(dest, blocks, start_sample, end_sample, 0);
+}
+
+void RowData::get_annotation_subset(
+	vector<pv::data::decode::Annotation> &dest,
+	vector<Block> &blocks,
+	uint64_t start_sample, uint64_t end_sample,
+	uint64_t min_length) const
+{
+	if (annotations_.empty())
+		return;
+
+	sort_annotations();
+
+	// The annotations are sorted by start sample: the ones starting
+	// after the period are never looked at
+	const size_t last = std::upper_bound(annotations_.begin(),
+		annotations_.end(), end_sample,
+		[](uint64_t s, const Annotation &a) {
+			return s < a.start_sample(); }) - annotations_.begin();
+
+	visit(1, 0, leaf_count_, last, start_sample, min_length,
+		[&](size_t i) { dest.push_back(annotations_[i]); },
+		[&](size_t node, size_t first) {
+			const uint64_t start = annotations_[first].start_sample();
+			const uint64_t end = index_[node].max_end;
+
+			// Merge the blocks separated by less than min_length
+			if (!blocks.empty() &&
+				start < blocks.back().end_sample + min_length) {
+				Block &b = blocks.back();
+
+				b.end_sample = max(b.end_sample, end);
+				b.format = merge_format(b.format,
+					index_[node].format);
+			} else {
+				const Block b = { start, end, index_[node].format };
+
+				blocks.push_back(b);
+			}
+		});
+}
+
+void RowData::sort_annotations() const
+{
+	if (!unsorted_)
+		return;
+
+	// Stable, so that annotations starting on the same sample stay in
+	// the order they were pushed
+	std::stable_sort(annotations_.begin(), annotations_.end(),
+		[](const Annotation &a, const Annotation &b) {
+			return a.start_sample() < b.start_sample(); });
+
+	unsorted_ = false;
+	rebuild_index();
+}
+
+void RowData::rebuild_index() const
+{
+	const Node empty = { 0, EmptyFormat };
+	const size_t leaves = (annotations_.size() + LeafSize - 1) / LeafSize;
+
+	leaf_count_ = max<size_t>(leaf_count_, 1);
+	while (leaf_count_ < leaves)
+		leaf_count_ *= 2;
+
+	index_.assign(2 * leaf_count_, empty);
+
+	for (size_t leaf = 0; leaf < leaves; leaf++)
+		update_leaf(leaf);
+}
+
+void RowData::update_leaf(size_t leaf) const
+{
+	const size_t first = leaf * LeafSize;
+	const size_t end = min(annotations_.size(), first + LeafSize);
+	Node n = { 0, EmptyFormat };
+
+	for (size_t i = first; i < end; i++) {
+		n.max_end = max(n.max_end, annotations_[i].end_sample());
+		n.format = merge_format(n.format, annotations_[i].format());
+	}
+
+	size_t node = leaf_count_ + leaf;
+
+	index_[node] = n;
+	for (node /= 2; node; node /= 2) {
+		const Node &l = index_[2 * node], &r = index_[2 * node + 1];
+
+		index_[node].max_end = max(l.max_end, r.max_end);
+		index_[node].format = merge_format(l.format, r.format);
+	}
 }
 
 void RowData::push_annotation(const Annotation &a)
 {
+	max_end_ = max(max_end_, a.end_sample());
+
+	// Annotations pushed out of order are appended as well, and sorted
+	// all at once by the next query
+	if (!unsorted_ && !annotations_.empty() &&
+		a.start_sample() < annotations_.back().start_sample())
+		unsorted_ = true;
+
 	annotations_.push_back(a);
+
+	if (unsorted_)
+		return;
+
+	if (annotations_.size() > leaf_count_ * LeafSize)
+		rebuild_index();
+	else
+		update_leaf((annotations_.size() - 1) / LeafSize);
 }
 
 } // decode
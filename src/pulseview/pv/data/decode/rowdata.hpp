@@ -21,6 +21,7 @@
 #ifndef PULSEVIEW_PV_DATA_DECODE_ROWDATA_HPP
 #define PULSEVIEW_PV_DATA_DECODE_ROWDATA_HPP
 
+#include <cstddef>
 #include <vector>
 
 #include "annotation.hpp"
@@ -31,6 +32,18 @@ namespace decode {
 
 class RowData
 {
+public:
+	/**
+	 * A group of annotations too close to each other to be told apart
+	 * at the current zoom level.
+	 */
+	struct Block
+	{
+		uint64_t start_sample;
+		uint64_t end_sample;
+		int format;	///< -1 if the annotations have different formats
+	};
+
 public:
 	RowData();
 
@@ -44,10 +57,64 @@ public:
 		std::vector<pv::data::decode::Annotation> &dest,
 		uint64_t start_sample, uint64_t end_sample) const;
 
+	/**
+	 * Same as above, except that groups of annotations spanning less
+	 * than min_length samples are returned as blocks. The time taken
+	 * depends on the number of items returned, not on the number of
+	 * annotations in the period.
+	 */
+	void get_annotation_subset(
+		std::vector<pv::data::decode::Annotation> &dest,
+		std::vector<Block> &blocks,
+		uint64_t start_sample, uint64_t end_sample,
+		uint64_t min_length) const;
+
 	void push_annotation(const Annotation &a);
 
 private:
-	std::vector<Annotation> annotations_;
+	/**
+	 * Summary of a range of annotations, stored in the nodes of a
+	 * max-end segment tree built over the annotations sorted by start
+	 * sample. Each leaf covers LeafSize annotations.
+	 */
+	struct Node
+	{
+		uint64_t max_end;
+		int format;
+	};
+
+	static const size_t LeafSize;
+	static const int EmptyFormat;
+	static const int MixedFormat;
+
+	static int merge_format(int a, int b);
+
+	/**
+	 * Sorts the annotations pushed out of order and rebuilds the index.
+	 * Called by the queries, which run under the same lock as the
+	 * pushes.
+	 */
+	void sort_annotations() const;
+	void rebuild_index() const;
+	void update_leaf(size_t leaf) const;
+
+	/**
+	 * Calls func(index) for the annotations of the subtree of node
+	 * which start before @c last and end after @c start_sample. When
+	 * min_length is non zero, subtrees spanning less than min_length
+	 * samples are passed to block_func(node, first) instead.
+	 */
+	template <typename Func, typename BlockFunc>
+	void visit(size_t node, size_t first_leaf, size_t leaves,
+		size_t last, uint64_t start_sample, uint64_t min_length,
+		Func func, BlockFunc block_func) const;
+
+private:
+	mutable std::vector<Annotation> annotations_;
+	mutable std::vector<Node> index_;
+	mutable size_t leaf_count_;
+	mutable bool unsorted_;
+	uint64_t max_end_;
 };
 
 }
@@ -20,10 +20,14 @@
 
 #include <libsigrokdecode/libsigrokdecode.h>
 
+#include <algorithm>
+#include <cstring>
 #include <stdexcept>
 
 #include <QDebug>
 
+#include <libsigrokcxx/libsigrokcxx.hpp>
+
 #include "decoderstack.hpp"
 
 #include "../data/logic.hpp"
@@ -54,7 +58,8 @@ namespace data {
 
 const double DecoderStack::DecodeMargin = 1.0;
 const double DecoderStack::DecodeThreshold = 0.2;
-const int64_t DecoderStack::DecodeChunkLength = 1024 * 16;
+// Sized to stay in the L2 cache while libsigrokdecode goes through it
+const int64_t DecoderStack::DecodeChunkLength = 1024 * 256;
 const unsigned int DecoderStack::DecodeNotifyPeriod = 1024;
 
 mutex DecoderStack::global_srd_mutex_;
@@ -66,8 +71,10 @@ DecoderStack::DecoderStack(pv::Session &session,
 	samplerate_(0),
 	sample_count_(0),
 	frame_complete_(false),
+	decode_mask_(0),
+	decode_unit_size_(1),
 	samples_decoded_(0),
-	active_decode_index_(0)
+	decoded_index_(0)
 {
 	connect(&session_, SIGNAL(frame_began()),
 		this, SLOT(on_new_frame()));
@@ -201,6 +208,20 @@ void DecoderStack::get_annotation_subset(
 			start_sample, end_sample);
 }
 
+void DecoderStack::get_annotation_subset(
+	std::vector<pv::data::decode::Annotation> &dest,
+	std::vector<decode::RowData::Block> &blocks,
+	const Row &row, uint64_t start_sample,
+	uint64_t end_sample, uint64_t min_length) const
+{
+	lock_guard<mutex> lock(output_mutex_);
+
+	const auto iter = rows_.find(row);
+	if (iter != rows_.end())
+		(*iter).second.get_annotation_subset(dest, blocks,
+			start_sample, end_sample, min_length);
+}
+
 QString DecoderStack::error_message()
 {
 	lock_guard<mutex> lock(output_mutex_);
@@ -212,6 +233,7 @@ void DecoderStack::clear()
 	sample_count_ = 0;
 	frame_complete_ = false;
 	samples_decoded_ = 0;
+	decoded_index_ = 0;
 	error_message_ = QString();
 	rows_.clear();
 	class_rows_.clear();
@@ -240,7 +262,6 @@ void DecoderStack::begin_decode()
 	}
 
 	clear();
-	active_decode_index_ = 0;
 
 	// Check that all decoders have the required channels
 	for (const shared_ptr<decode::Decoder> &dec : stack_)
@@ -343,51 +364,68 @@ optional<int64_t> DecoderStack::wait_for_data() const
 		sample_count_);
 }
 
-void DecoderStack::decode_data(
-	const int64_t sample_count, const unsigned int unit_size,
-	srd_session *const session)
+void DecoderStack::setup_channels()
 {
-	uint8_t chunk[DecodeChunkLength];
+	decode_channels_.clear();
+	decode_mask_ = 0;
 
-	const unsigned int chunk_sample_count =
-		DecodeChunkLength / segment_->unit_size();
+	for (const shared_ptr<decode::Decoder> &dec : stack_)
+		for (const auto& channel : dec->channels()) {
+			const unsigned int index =
+				channel.second->channel()->index();
 
-	for (int64_t i = active_decode_index_; !interrupt_ && i < sample_count;
-			i += chunk_sample_count) {
+			if (!(decode_mask_ & (1ULL << index)))
+				decode_channels_.push_back(index);
+			decode_mask_ |= 1ULL << index;
+		}
 
-		const int64_t chunk_end = min(
-			i + chunk_sample_count, sample_count);
-		segment_->get_samples(chunk, i, chunk_end);
+	std::sort(decode_channels_.begin(), decode_channels_.end());
 
-		if (srd_session_send(session, i, chunk_end, chunk,
-				(chunk_end - i) * unit_size, unit_size) != SRD_OK) {
-			error_message_ = tr("Decoder reported an error");
-			break;
-		}
+	decode_unit_size_ = max<unsigned int>(
+		(decode_channels_.size() + 7) / 8, 1);
+}
 
-		{
-			lock_guard<mutex> lock(output_mutex_);
-			samples_decoded_ = chunk_end;
+void DecoderStack::get_decode_samples(uint8_t *dest, int64_t start,
+	int64_t end, vector<LogicSegment::Transition> &transitions) const
+{
+	const auto pack = [&](uint64_t sample) {
+		uint64_t value = 0;
+		for (size_t i = 0; i < decode_channels_.size(); i++)
+			value |= ((sample >> decode_channels_[i]) & 1) << i;
+		return value;
+	};
+
+	// Only the samples where a decoded channel changes are looked at,
+	// the runs in between are filled
+	transitions.clear();
+	segment_->get_transitions(transitions, start, end, decode_mask_);
+	transitions.push_back(LogicSegment::Transition(end, 0));
+
+	uint64_t value = pack(segment_->get_sample(start));
+	int64_t index = start;
+
+	for (const LogicSegment::Transition &t : transitions) {
+		const int64_t count = t.first - index;
+
+		if (decode_unit_size_ == 1) {
+			memset(dest, (uint8_t)value, count);
+			dest += count;
+		} else {
+			for (int64_t i = 0; i < count; i++)
+				for (unsigned int b = 0; b < decode_unit_size_; b++)
+					*dest++ = value >> (8 * b);
 		}
 
-		if (i % DecodeNotifyPeriod == 0)
-			new_decode_data();
-
-		active_decode_index_ = chunk_end;
+		index = t.first;
+		value = pack(t.second);
 	}
-
-	new_decode_data();
 }
 
-void DecoderStack::decode_proc()
+srd_session* DecoderStack::create_session()
 {
-	optional<int64_t> sample_count;
 	srd_session *session;
 	srd_decoder_inst *prev_di = nullptr;
 
-	assert(segment_);
-
-	// Prevent any other decode threads from accessing libsigrokdecode
 	lock_guard<mutex> srd_lock(global_srd_mutex_);
 
 	// Create the session
@@ -395,15 +433,15 @@ void DecoderStack::decode_proc()
 	assert(session);
 
 	// Create the decoders
-	const unsigned int unit_size = segment_->unit_size();
-
 	for (const shared_ptr<decode::Decoder> &dec : stack_) {
-		srd_decoder_inst *const di = dec->create_decoder_inst(session);
+		srd_decoder_inst *const di = dec->create_decoder_inst(session,
+			decode_channels_);
 
 		if (!di) {
+			lock_guard<mutex> lock(output_mutex_);
 			error_message_ = tr("Failed to create decoder instance");
 			srd_session_destroy(session);
-			return;
+			return nullptr;
 		}
 
 		if (prev_di)
@@ -412,12 +450,6 @@ void DecoderStack::decode_proc()
 		prev_di = di;
 	}
 
-	// Get the intial sample count
-	{
-		unique_lock<mutex> input_lock(input_mutex_);
-		sample_count = sample_count_ = segment_->get_sample_count();
-	}
-
 	// Start the session
 	srd_session_metadata_set(session, SRD_CONF_SAMPLERATE,
 		g_variant_new_uint64((uint64_t)samplerate_));
@@ -427,14 +459,86 @@ void DecoderStack::decode_proc()
 
 	srd_session_start(session);
 
-	do {
-		decode_data(*sample_count, unit_size, session);
-	} while (error_message_.isEmpty() && (sample_count = wait_for_data()));
+	return session;
+}
 
-	// Destroy the session
+void DecoderStack::destroy_session(srd_session *session)
+{
+	lock_guard<mutex> srd_lock(global_srd_mutex_);
 	srd_session_destroy(session);
 }
 
+void DecoderStack::decode_data(srd_session *const session,
+	const int64_t sample_count)
+{
+	vector<uint8_t> chunk(DecodeChunkLength);
+	vector<LogicSegment::Transition> transitions;
+
+	const unsigned int unit_size = decode_unit_size_;
+	const unsigned int chunk_sample_count =
+		DecodeChunkLength / unit_size;
+
+	for (int64_t i = decoded_index_; !interrupt_ && i < sample_count;
+			i += chunk_sample_count) {
+
+		const int64_t chunk_end = min(
+			i + chunk_sample_count, sample_count);
+		get_decode_samples(chunk.data(), i, chunk_end, transitions);
+
+		int ret;
+		{
+			lock_guard<mutex> srd_lock(global_srd_mutex_);
+			ret = srd_session_send(session, i, chunk_end,
+				chunk.data(), (chunk_end - i) * unit_size,
+				unit_size);
+		}
+
+		if (ret != SRD_OK) {
+			lock_guard<mutex> lock(output_mutex_);
+			error_message_ = tr("Decoder reported an error");
+			break;
+		}
+
+		{
+			lock_guard<mutex> lock(output_mutex_);
+			samples_decoded_ = chunk_end;
+		}
+
+		if (i % DecodeNotifyPeriod == 0)
+			new_decode_data();
+
+		decoded_index_ = chunk_end;
+	}
+
+	new_decode_data();
+}
+
+void DecoderStack::decode_proc()
+{
+	optional<int64_t> sample_count;
+
+	assert(segment_);
+
+	// Get the intial sample count
+	{
+		unique_lock<mutex> input_lock(input_mutex_);
+		sample_count = sample_count_ = segment_->get_sample_count();
+	}
+
+	setup_channels();
+
+	srd_session *const session = create_session();
+	if (!session)
+		return;
+
+	do {
+		decode_data(session, *sample_count);
+	} while (error_message().isEmpty() &&
+		(sample_count = wait_for_data()));
+
+	destroy_session(session);
+}
+
 void DecoderStack::annotation_callback(srd_proto_data *pdata, void *decoder)
 {
 	assert(pdata);
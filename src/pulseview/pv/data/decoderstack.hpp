@@ -29,6 +29,7 @@
 #include <map>
 #include <memory>
 #include <thread>
+#include <vector>
 
 #include <boost/optional.hpp>
 
@@ -106,6 +107,16 @@ public:
 		const decode::Row &row, uint64_t start_sample,
 		uint64_t end_sample) const;
 
+	/**
+	 * Extracts the annotations between two period, grouping those
+	 * spanning less than min_length samples into blocks.
+	 */
+	void get_annotation_subset(
+		std::vector<pv::data::decode::Annotation> &dest,
+		std::vector<decode::RowData::Block> &blocks,
+		const decode::Row &row, uint64_t start_sample,
+		uint64_t end_sample, uint64_t min_length) const;
+
 	QString error_message();
 
 	void clear();
@@ -120,8 +131,25 @@ public:
 private:
 	boost::optional<int64_t> wait_for_data() const;
 
-	void decode_data(const int64_t sample_count,
-		const unsigned int unit_size, srd_session *const session);
+	/**
+	 * Lists the logic channels used by the decoders, which are the only
+	 * ones sent to libsigrokdecode.
+	 */
+	void setup_channels();
+
+	/**
+	 * Gets the samples [start, end) of the decoded channels, packed in
+	 * decode_unit_size_ bytes.
+	 */
+	void get_decode_samples(uint8_t *dest, int64_t start, int64_t end,
+		std::vector< std::pair<uint64_t, uint64_t> > &transitions) const;
+
+	srd_session* create_session();
+
+	void destroy_session(srd_session *session);
+
+	void decode_data(srd_session *const session,
+		const int64_t sample_count);
 
 	void decode_proc();
 
@@ -146,9 +174,9 @@ private:
 
 	/**
 	 * This mutex prevents more than one thread from accessing
-	 * libsigrokdecode concurrently.
-	 * @todo A proper solution should be implemented to allow multiple
-	 * decode operations in parallel.
+	 * libsigrokdecode concurrently. It is only held during the calls
+	 * into the library, so the decode threads of several stacks are
+	 * interleaved rather than run one after the other.
 	 */
 	static std::mutex global_srd_mutex_;
 
@@ -156,6 +184,10 @@ private:
 
 	std::shared_ptr<pv::data::LogicSegment> segment_;
 
+	std::vector<unsigned int> decode_channels_;
+	uint64_t decode_mask_;
+	unsigned int decode_unit_size_;
+
 	mutable std::mutex input_mutex_;
 	mutable std::condition_variable input_cond_;
 	int64_t sample_count_;
@@ -163,7 +195,7 @@ private:
 
 	mutable std::mutex output_mutex_;
 	int64_t	samples_decoded_;
-	int64_t active_decode_index_;
+	int64_t decoded_index_;
 
 	std::map<const decode::Row, decode::RowData> rows_;
 
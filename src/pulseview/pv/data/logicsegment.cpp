@@ -24,8 +24,10 @@
 #include <string.h>
 #include <stdlib.h>
 #include <cmath>
+#include <thread>
 
 #include "logicsegment.hpp"
+#include "transitionlist.hpp"
 
 #include <libsigrokcxx/libsigrokcxx.hpp>
 
@@ -35,6 +37,7 @@ using std::max;
 using std::min;
 using std::pair;
 using std::shared_ptr;
+using std::vector;
 
 using sigrok::Logic;
 
@@ -45,6 +48,8 @@ const int LogicSegment::MipMapScalePower = 4;
 const int LogicSegment::MipMapScaleFactor = 1 << MipMapScalePower;
 const float LogicSegment::LogMipMapScaleFactor = logf(MipMapScaleFactor);
 const uint64_t LogicSegment::MipMapDataUnit = 64*1024;	// bytes
+const uint64_t LogicSegment::MipMapParallelBlocks = 64*1024;
+const uint64_t LogicSegment::SearchWindow = 1024*1024;
 
 LogicSegment::LogicSegment(shared_ptr<Logic> logic, uint64_t samplerate,
 				const uint64_t expected_num_samples) :
@@ -58,6 +63,22 @@ LogicSegment::LogicSegment(shared_ptr<Logic> logic, uint64_t samplerate,
 	memset(mip_map_, 0, sizeof(mip_map_));
 }
 
+LogicSegment::LogicSegment(unsigned int unit_size, uint64_t samplerate,
+				const uint64_t expected_num_samples,
+				bool transition_mode) :
+	Segment(samplerate, unit_size),
+	last_append_sample_(0),
+	replace_mode(false)
+{
+	if (transition_mode)
+		transitions_.reset(new TransitionList(unit_size));
+	else
+		set_capacity(expected_num_samples);
+
+	lock_guard<recursive_mutex> lock(mutex_);
+	memset(mip_map_, 0, sizeof(mip_map_));
+}
+
 LogicSegment::~LogicSegment()
 {
 	lock_guard<recursive_mutex> lock(mutex_);
@@ -144,12 +165,32 @@ void LogicSegment::append_payload(shared_ptr<Logic> logic)
 	assert(unit_size_ == logic->unit_size());
 	assert((logic->data_length() % unit_size_) == 0);
 
-	lock_guard<recursive_mutex> lock(mutex_);
-
-	append_data(logic->data_pointer(),
+	append_payload(logic->data_pointer(),
 		logic->data_length() / unit_size_);
-	replace_mode = false;
-	// Generate the first mip-map from the data
+}
+
+void LogicSegment::append_payload(const void *data, uint64_t samples)
+{
+	if (transitions_) {
+		lock_guard<recursive_mutex> lock(mutex_);
+
+		transitions_->append(data, samples);
+		sample_count_ += samples;
+		total_sample_count_ += samples;
+		active_sample_index_ = total_sample_count_;
+		return;
+	}
+
+	{
+		lock_guard<recursive_mutex> lock(mutex_);
+
+		append_data(data, samples);
+		replace_mode = false;
+	}
+
+	// Generate the mip-map from the data. The levels are built without
+	// holding the lock, so the view can use the levels that are already
+	// complete while the deeper ones are being computed.
 	append_payload_to_mipmap();
 }
 
@@ -157,9 +198,21 @@ void LogicSegment::replace_payload(shared_ptr<Logic> logic)
 {
 	assert(unit_size_ ==  logic->unit_size());
 	assert((logic->data_length() % unit_size_) == 0);
+	replace_payload(logic->data_pointer(),
+		logic->data_length() / unit_size_);
+}
+
+void LogicSegment::replace_payload(const void *data, uint64_t samples)
+{
+	// The transition list can only grow
+	if (transitions_) {
+		append_payload(data, samples);
+		return;
+	}
+
 	lock_guard<recursive_mutex> lock(mutex_);
 	uint64_t previous_active_index = get_active_sample_index();
-	replace_data(logic->data_pointer(), logic->data_length() / unit_size_);
+	replace_data(data, samples);
 
 	replace_mode = true;
 	append_payload_to_mipmap(previous_active_index);
@@ -177,13 +230,18 @@ void LogicSegment::get_samples(uint8_t *const data,
 
 	lock_guard<recursive_mutex> lock(mutex_);
 
+	if (transitions_) {
+		transitions_->get_samples(data, start_sample, end_sample);
+		return;
+	}
+
 	const size_t size = (end_sample - start_sample) * unit_size_;
 	memcpy(data, (const uint8_t*)data_.data() + start_sample * unit_size_, size);
 }
 
-void LogicSegment::reallocate_mipmap_level(MipMapLevel &m)
+void LogicSegment::reallocate_mipmap_level(MipMapLevel &m, uint64_t length)
 {
-	const uint64_t new_data_length = ((m.length + MipMapDataUnit - 1) /
+	const uint64_t new_data_length = ((length + MipMapDataUnit - 1) /
 		MipMapDataUnit) * MipMapDataUnit;
 	if (new_data_length > m.data_length) {
 		m.data_length = new_data_length;
@@ -194,95 +252,213 @@ void LogicSegment::reallocate_mipmap_level(MipMapLevel &m)
 	}
 }
 
-void LogicSegment::append_payload_to_mipmap(uint64_t prev_active)
+namespace {
+
+// Level 0: accumulate the transitions which occurred in each block of
+// F samples. 'last' is the sample preceding src[0].
+template <typename T, unsigned int F>
+void mipmap_transitions(const T *src, T *dst, uint64_t count, T last)
 {
-	MipMapLevel &m0 = mip_map_[0];
-	uint64_t prev_index;
-	uint64_t end_index;
-	const uint8_t *src_ptr;
-	uint8_t *dest_ptr;
-	uint64_t accumulator;
-	unsigned int diff_counter;
+	for (uint64_t b = 0; b < count; b++) {
+		const T *s = src + b * F;
+		T acc = s[0] ^ (b ? s[-1] : last);
 
-	if(replace_mode)
-	{
-		prev_index = (prev_active > active_sample_index_) ? 0 : prev_active / MipMapScaleFactor;
-		end_index = active_sample_index_ / MipMapScaleFactor;
+		// Fixed trip count and no dependencies between the lanes:
+		// the compiler turns this into SIMD XOR/OR reductions.
+		for (unsigned int i = 1; i < F; i++)
+			acc |= s[i] ^ s[i - 1];
+
+		dst[b] = acc;
 	}
-	else {
-		// Expand the data buffer to fit the new samples
-		prev_index = m0.length;
-		m0.length = sample_count_ / MipMapScaleFactor;
-		end_index = m0.length;
+}
+
+// Higher levels: OR-reduce blocks of F entries of the level below
+template <typename T, unsigned int F>
+void mipmap_reduce(const T *src, T *dst, uint64_t count)
+{
+	for (uint64_t b = 0; b < count; b++) {
+		const T *s = src + b * F;
+		T acc = 0;
+
+		for (unsigned int i = 0; i < F; i++)
+			acc |= s[i];
+
+		dst[b] = acc;
 	}
+}
+
+// Splits [0, count) among worker threads when there is enough work to
+// pay for starting them. func(begin, end) is called once per part.
+template <typename Func>
+void parallel_for(uint64_t count, uint64_t min_count, Func func)
+{
+	const unsigned int max_threads = 8;
+	unsigned int nb_threads = min(max_threads,
+		std::thread::hardware_concurrency());
 
-	// Break off if there are no new samples to compute
-	if (m0.length == prev_index)
+	if (count < min_count || nb_threads < 2) {
+		func(0, count);
 		return;
+	}
+
+	nb_threads = min<uint64_t>(nb_threads, count / (min_count / 2));
+
+	const uint64_t part = (count + nb_threads - 1) / nb_threads;
+	vector<std::thread> workers;
+
+	for (unsigned int i = 1; i < nb_threads; i++) {
+		const uint64_t begin = min(count, part * i);
+		const uint64_t end = min(count, part * (i + 1));
+
+		workers.push_back(std::thread(func, begin, end));
+	}
+
+	func(0, min(count, part));
+
+	for (std::thread &t : workers)
+		t.join();
+}
+
+}
+
+template <typename T>
+void LogicSegment::build_mipmap_level(unsigned int level,
+	uint64_t prev_index, uint64_t end_index, uint64_t last)
+{
+	const unsigned int F = 1 << MipMapScalePower;
+	const T *const src = level ? (const T*)mip_map_[level - 1].data :
+		(const T*)data_.data();
+	T *const dst = (T*)mip_map_[level].data;
+
+	parallel_for(end_index - prev_index, MipMapParallelBlocks,
+		[=](uint64_t begin, uint64_t end) {
+			const uint64_t first = prev_index + begin;
+
+			if (level == 0)
+				mipmap_transitions<T, F>(src + first * F,
+					dst + first, end - begin,
+					begin ? src[first * F - 1] : (T)last);
+			else
+				mipmap_reduce<T, F>(src + first * F,
+					dst + first, end - begin);
+		});
+}
 
-	reallocate_mipmap_level(m0);
+void LogicSegment::build_mipmap_level_generic(unsigned int level,
+	uint64_t prev_index, uint64_t end_index, uint64_t last)
+{
+	const MipMapLevel &m = mip_map_[level];
+	const uint8_t *src_ptr = level ?
+		(const uint8_t*)mip_map_[level - 1].data :
+		(const uint8_t*)data_.data();
+	uint8_t *dest_ptr = (uint8_t*)m.data + prev_index * unit_size_;
+	const uint8_t *const end_dest_ptr =
+		(uint8_t*)m.data + end_index * unit_size_;
+
+	src_ptr += prev_index * unit_size_ * MipMapScaleFactor;
 
-	dest_ptr = (uint8_t*)m0.data + prev_index * unit_size_;
+	for (; dest_ptr < end_dest_ptr; dest_ptr += unit_size_) {
+		uint64_t accumulator = 0;
+		unsigned int diff_counter = MipMapScaleFactor;
 
-	// Iterate through the samples to populate the first level mipmap
-	const uint8_t *const end_src_ptr = (uint8_t*)data_.data() +
-		end_index * unit_size_ * MipMapScaleFactor;
-	for (src_ptr = (uint8_t*)data_.data() +
-			prev_index * unit_size_ * MipMapScaleFactor;
-			src_ptr < end_src_ptr;) {
-		// Accumulate transitions which have occurred in this sample
-		accumulator = 0;
-		diff_counter = MipMapScaleFactor;
 		while (diff_counter-- > 0) {
 			const uint64_t sample = unpack_sample(src_ptr);
-			accumulator |= last_append_sample_ ^ sample;
-			last_append_sample_ = sample;
+
+			// Level 0 accumulates transitions, the higher
+			// levels accumulate the level below
+			if (level == 0) {
+				accumulator |= last ^ sample;
+				last = sample;
+			} else {
+				accumulator |= sample;
+			}
 			src_ptr += unit_size_;
 		}
 
 		pack_sample(dest_ptr, accumulator);
-		dest_ptr += unit_size_;
 	}
+}
 
-	// Compute higher level mipmaps
-	for (unsigned int level = 1; level < ScaleStepCount; level++) {
-		MipMapLevel &m = mip_map_[level];
-		const MipMapLevel &ml = mip_map_[level-1];
+void LogicSegment::append_payload_to_mipmap(uint64_t prev_active)
+{
+	uint64_t prev_index[ScaleStepCount];
+	uint64_t end_index[ScaleStepCount];
+	unsigned int levels = 0;
+	uint64_t last;
 
-		if(replace_mode) {
-			end_index = end_index / MipMapScaleFactor;
-			prev_index =  prev_index / MipMapScaleFactor;
-		}
-		else {
-			// Expand the data buffer to fit the new samples
-			prev_index = m.length;
-			m.length = ml.length / MipMapScaleFactor;
-			end_index = m.length;
+	{
+		lock_guard<recursive_mutex> lock(mutex_);
+		uint64_t prev, end;
+
+		if (replace_mode) {
+			prev = (prev_active > active_sample_index_) ? 0 :
+				prev_active / MipMapScaleFactor;
+			end = active_sample_index_ / MipMapScaleFactor;
+		} else {
+			prev = mip_map_[0].length;
+			end = sample_count_ / MipMapScaleFactor;
 		}
 
-		// Break off if there are no more samples to computed
-		if (m.length == prev_index)
-			break;
+		// The sample preceding the first block to compute
+		last = prev ? get_sample(prev * MipMapScaleFactor - 1) :
+			last_append_sample_;
+
+		// Work out the blocks to compute at each level, and make
+		// room for them. The new lengths are published once each
+		// level is complete.
+		for (; levels < ScaleStepCount; levels++) {
+			MipMapLevel &m = mip_map_[levels];
 
-		reallocate_mipmap_level(m);
-
-		// Subsample the level lower level
-		src_ptr = (uint8_t*)ml.data +
-			unit_size_ * prev_index * MipMapScaleFactor;
-		const uint8_t *const end_dest_ptr =
-			(uint8_t*)m.data + unit_size_ * end_index;
-		for (dest_ptr = (uint8_t*)m.data +
-				unit_size_ * prev_index;
-				dest_ptr < end_dest_ptr;
-				dest_ptr += unit_size_) {
-			accumulator = 0;
-			diff_counter = MipMapScaleFactor;
-			while (diff_counter-- > 0) {
-				accumulator |= unpack_sample(src_ptr);
-				src_ptr += unit_size_;
+			if (levels > 0) {
+				prev = replace_mode ? prev / MipMapScaleFactor :
+					m.length;
+				end = end / MipMapScaleFactor;
 			}
 
-			pack_sample(dest_ptr, accumulator);
+			// Break off if there are no more samples to compute
+			if (end <= prev)
+				break;
+
+			reallocate_mipmap_level(m, replace_mode ?
+				max(m.length, end) : end);
+			prev_index[levels] = prev;
+			end_index[levels] = end;
+		}
+
+		if (levels == 0)
+			return;
+
+		last_append_sample_ = get_sample(
+			end_index[0] * MipMapScaleFactor - 1);
+	}
+
+	for (unsigned int level = 0; level < levels; level++) {
+		switch (unit_size_) {
+		case 1:
+			build_mipmap_level<uint8_t>(level, prev_index[level],
+				end_index[level], last);
+			break;
+		case 2:
+			build_mipmap_level<uint16_t>(level, prev_index[level],
+				end_index[level], last);
+			break;
+		case 4:
+			build_mipmap_level<uint32_t>(level, prev_index[level],
+				end_index[level], last);
+			break;
+		case 8:
+			build_mipmap_level<uint64_t>(level, prev_index[level],
+				end_index[level], last);
+			break;
+		default:
+			build_mipmap_level_generic(level, prev_index[level],
+				end_index[level], last);
+			break;
+		}
+
+		if (!replace_mode) {
+			lock_guard<recursive_mutex> lock(mutex_);
+			mip_map_[level].length = end_index[level];
 		}
 	}
 }
@@ -291,10 +467,365 @@ uint64_t LogicSegment::get_sample(uint64_t index) const
 {
 //	assert(index < sample_count_);
 
+	if (transitions_) {
+		lock_guard<recursive_mutex> lock(mutex_);
+		return transitions_->sample(index);
+	}
+
 	return unpack_sample((uint8_t*)data_.data() + index * unit_size_);
 }
 
-void LogicSegment::get_subsampled_edges(
+bool LogicSegment::transition_mode() const
+{
+	return transitions_ != nullptr;
+}
+
+namespace {
+
+template <typename T>
+void scan_transitions(const T *data, uint64_t start, uint64_t end,
+	uint64_t mask, vector<LogicSegment::Transition> &transitions)
+{
+	const unsigned int stride = 8;
+	T last = data[start];
+	uint64_t i = start + 1;
+
+	while (i < end) {
+		// Skip the runs without changes a few samples at a time
+		if (end - i >= stride) {
+			T diff = 0;
+
+			for (unsigned int k = 0; k < stride; k++)
+				diff |= data[i + k] ^ last;
+
+			if (!diff) {
+				i += stride;
+				continue;
+			}
+		}
+
+		const T sample = data[i];
+		if (sample != last) {
+			if ((sample ^ last) & mask)
+				transitions.push_back(
+					LogicSegment::Transition(i, sample));
+			last = sample;
+		}
+		i++;
+	}
+}
+
+// Returns the first index in [start, end) where the sample differs from
+// the previous one on the channels in mask, or end
+template <typename T>
+uint64_t first_change(const T *data, uint64_t start, uint64_t end, T mask)
+{
+	const unsigned int stride = 8;
+	uint64_t i = start;
+
+	while (i < end) {
+		// Compare a few samples at once; the loop has no dependencies
+		// between the lanes and is turned into SIMD instructions
+		if (end - i >= stride) {
+			T diff = 0;
+
+			for (unsigned int k = 0; k < stride; k++)
+				diff |= data[i + k] ^ data[i + k - 1];
+
+			if (!(diff & mask)) {
+				i += stride;
+				continue;
+			}
+		}
+
+		if ((data[i] ^ data[i - 1]) & mask)
+			return i;
+		i++;
+	}
+
+	return end;
+}
+
+}
+
+void LogicSegment::get_transitions(vector<Transition> &transitions,
+	uint64_t start, uint64_t end, uint64_t mask) const
+{
+	lock_guard<recursive_mutex> lock(mutex_);
+
+	end = min(end, sample_count_);
+	if (start >= end)
+		return;
+
+	if (transitions_) {
+		transitions_->get_transitions(start, end, mask, transitions);
+		return;
+	}
+
+	const uint8_t *const data = data_.data();
+
+	switch (unit_size_) {
+	case 1:
+		scan_transitions((const uint8_t*)data, start, end, mask,
+			transitions);
+		break;
+	case 2:
+		scan_transitions((const uint16_t*)data, start, end, mask,
+			transitions);
+		break;
+	case 4:
+		scan_transitions((const uint32_t*)data, start, end, mask,
+			transitions);
+		break;
+	case 8:
+		scan_transitions((const uint64_t*)data, start, end, mask,
+			transitions);
+		break;
+	default: {
+		uint64_t last = get_sample(start);
+
+		for (uint64_t i = start + 1; i < end; i++) {
+			const uint64_t sample = get_sample(i);
+
+			if ((sample ^ last) & mask)
+				transitions.push_back(Transition(i, sample));
+			last = sample;
+		}
+		break;
+	}
+	}
+}
+
+uint64_t LogicSegment::scan_change(uint64_t from, uint64_t end,
+	uint64_t mask) const
+{
+	const uint8_t *const data = data_.data();
+
+	switch (unit_size_) {
+	case 1:
+		return first_change((const uint8_t*)data, from, end,
+			(uint8_t)mask);
+	case 2:
+		return first_change((const uint16_t*)data, from, end,
+			(uint16_t)mask);
+	case 4:
+		return first_change((const uint32_t*)data, from, end,
+			(uint32_t)mask);
+	case 8:
+		return first_change((const uint64_t*)data, from, end, mask);
+	default:
+		for (; from < end; from++)
+			if ((get_sample(from) ^ get_sample(from - 1)) & mask)
+				return from;
+		return end;
+	}
+}
+
+uint64_t LogicSegment::find_change(uint64_t from, uint64_t end,
+	uint64_t mask) const
+{
+	from = max<uint64_t>(from, 1);
+	if (from >= end)
+		return end;
+
+	if (transitions_) {
+		uint64_t change = end;
+
+		for (unsigned int ch = 0; ch < unit_size_ * 8; ch++)
+			if ((mask >> ch) & 1)
+				change = min(change,
+					transitions_->next_edge(ch, from));
+
+		return change;
+	}
+
+	uint64_t i = from;
+
+	while (i < end) {
+		// Find the highest mip-map level whose block around i has no
+		// change on the channels
+		unsigned int level = 0;
+
+		while (level < ScaleStepCount && mip_map_[level].data) {
+			const uint64_t offset =
+				i >> ((level + 1) * MipMapScalePower);
+
+			if (offset >= mip_map_[level].length ||
+					(get_subsample(level, offset) & mask))
+				break;
+			level++;
+		}
+
+		if (level > 0) {
+			i = pow2_ceil(i + 1, level * MipMapScalePower);
+			continue;
+		}
+
+		// Look at the samples of the block, or at all the samples
+		// left if the mip-map doesn't cover them yet
+		const bool mapped = mip_map_[0].data &&
+			(i >> MipMapScalePower) < mip_map_[0].length;
+		const uint64_t block_end = mapped ?
+			min(end, pow2_ceil(i + 1, MipMapScalePower)) : end;
+		const uint64_t change = scan_change(i, block_end, mask);
+
+		if (change < block_end)
+			return change;
+		i = block_end;
+	}
+
+	return end;
+}
+
+template <typename Func>
+void LogicSegment::search(const SearchPattern &pattern, uint64_t start,
+	uint64_t end, Func func) const
+{
+	const uint64_t edges = pattern.rising | pattern.falling;
+	const uint64_t levels = pattern.mask | edges;
+	const uint64_t target = (pattern.value & pattern.mask & ~edges) |
+		pattern.rising;
+	const uint64_t width = max<uint64_t>(pattern.min_width, 1);
+
+	const auto matches = [&](uint64_t sample) {
+		return (sample & levels) == target;
+	};
+
+	// The levels hold for width samples if none of the channels
+	// changes in between
+	const auto wide_enough = [&](uint64_t index) {
+		return index + width <= sample_count_ &&
+			find_change(index + 1, index + width, levels) ==
+				index + width;
+	};
+
+	end = min(end, sample_count_);
+	if (!levels || start >= end)
+		return;
+
+	uint64_t i = start;
+
+	// The capture may start in the middle of a matching period
+	if (i == 0) {
+		if (!edges && matches(get_sample(0)) && wide_enough(0) &&
+				!func(0))
+			return;
+		i = 1;
+	}
+
+	// A match can only start where one of the channels changes
+	while ((i = find_change(i, end, levels)) < end) {
+		const uint64_t sample = get_sample(i);
+		const uint64_t prev = get_sample(i - 1);
+
+		if (matches(sample) && !matches(prev) &&
+				((sample ^ prev) & edges) == edges &&
+				wide_enough(i) && !func(i))
+			return;
+		i++;
+	}
+}
+
+void LogicSegment::find_matches(vector<uint64_t> &matches,
+	const SearchPattern &pattern, uint64_t start, uint64_t end,
+	uint64_t max_matches) const
+{
+	lock_guard<recursive_mutex> lock(mutex_);
+
+	uint64_t count = 0;
+
+	if (!max_matches)
+		return;
+
+	search(pattern, start, end, [&](uint64_t index) {
+		matches.push_back(index);
+		return ++count < max_matches;
+	});
+}
+
+bool LogicSegment::find_previous_match(const SearchPattern &pattern,
+	uint64_t before, uint64_t &index) const
+{
+	lock_guard<recursive_mutex> lock(mutex_);
+
+	uint64_t end = min(before, sample_count_);
+	uint64_t length = SearchWindow;
+	bool found = false;
+
+	// Search windows of growing size backwards from the sample, keeping
+	// the last match of the first window which has one
+	while (end > 0 && !found) {
+		const uint64_t start = end > length ? end - length : 0;
+
+		search(pattern, start, end, [&](uint64_t i) {
+			index = i;
+			found = true;
+			return true;
+		});
+
+		end = start;
+		length *= 2;
+	}
+
+	return found;
+}
+
+void LogicSegment::get_subsampled_transitions(vector<EdgePair> &edges,
+	uint64_t start, uint64_t end, float min_length, int sig_index)
+{
+	const uint64_t block_length = (uint64_t)max(min_length, 1.0f);
+	vector<uint64_t> channel_edges;
+
+	bool last_sample = transitions_->level(sig_index, start);
+	edges.push_back(EdgePair(start, last_sample));
+
+	transitions_->get_edges(sig_index, start + 1, end, channel_edges);
+
+	// Edges closer than the resolution are merged into a single edge,
+	// which takes the level at the end of the quantization block
+	for (size_t i = 0; i < channel_edges.size();) {
+		const uint64_t index = channel_edges[i];
+		const uint64_t limit = index + block_length;
+		size_t j = i;
+
+		while (j < channel_edges.size() && channel_edges[j] < limit)
+			j++;
+
+		last_sample ^= (j - i) & 1;
+		edges.push_back(EdgePair(index, last_sample));
+		i = j;
+	}
+
+	// Add the final state
+	const bool end_sample = transitions_->level(sig_index, end);
+	if (last_sample != end_sample)
+		edges.push_back(EdgePair(end, end_sample));
+	edges.push_back(EdgePair(end + 1, end_sample));
+}
+
+unsigned int LogicSegment::mipmap_min_level(float min_length)
+{
+	return max((int)floorf(logf(min_length) /
+		LogMipMapScaleFactor) - 1, 0);
+}
+
+uint64_t LogicSegment::mapped_end(unsigned int level) const
+{
+	if (transitions_)
+		return sample_count_;
+
+	return mip_map_[level].length <<
+		((level + 1) * MipMapScalePower);
+}
+
+uint64_t LogicSegment::get_mapped_end(float min_length) const
+{
+	lock_guard<recursive_mutex> lock(mutex_);
+
+	return min(sample_count_, mapped_end(mipmap_min_level(min_length)));
+}
+
+uint64_t LogicSegment::get_subsampled_edges(
 	std::vector<EdgePair> &edges,
 	uint64_t start, uint64_t end,
 	float min_length, int sig_index)
@@ -312,11 +843,20 @@ void LogicSegment::get_subsampled_edges(
 
 	lock_guard<recursive_mutex> lock(mutex_);
 
+	if (transitions_) {
+		get_subsampled_transitions(edges, start, end,
+			min_length, sig_index);
+		return end;
+	}
+
 	const uint64_t block_length = (uint64_t)max(min_length, 1.0f);
-	const unsigned int min_level = max((int)floorf(logf(min_length) /
-		LogMipMapScaleFactor) - 1, 0);
+	const unsigned int min_level = mipmap_min_level(min_length);
 	const uint64_t sig_mask = 1ULL << sig_index;
 
+	// The levels are published one after the other while the mip-map
+	// is built, so the blocks past this point may not be computed yet
+	const uint64_t mapped = min(end, mapped_end(min_level));
+
 	// Store the initial state
 	last_sample = (get_sample(start) & sig_mask) != 0;
 	edges.push_back(pair<int64_t, bool>(index++, last_sample));
@@ -432,6 +972,11 @@ void LogicSegment::get_subsampled_edges(
 				}
 			}
 
+			// Past the mapped blocks, look for the change in the
+			// samples themselves
+			if (index >= mapped)
+				index = scan_change(index, end, sig_mask);
+
 			// If individual samples within the limit of resolution,
 			// do a linear search for the next transition within the
 			// block
@@ -474,6 +1019,8 @@ void LogicSegment::get_subsampled_edges(
 	if (last_sample != end_sample)
 		edges.push_back(pair<int64_t, bool>(end, end_sample));
 	edges.push_back(pair<int64_t, bool>(end + 1, end_sample));
+
+	return mapped;
 }
 
 uint64_t LogicSegment::get_subsample(int level, uint64_t offset) const
@@ -486,7 +1033,7 @@ uint64_t LogicSegment::get_subsample(int level, uint64_t offset) const
 
 uint64_t LogicSegment::pow2_ceil(uint64_t x, unsigned int power)
 {
-	const uint64_t p = 1 << power;
+	const uint64_t p = 1ULL << power;
 	return (x + p - 1) / p * p;
 }
 
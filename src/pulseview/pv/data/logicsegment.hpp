@@ -23,6 +23,7 @@
 
 #include "segment.hpp"
 
+#include <memory>
 #include <utility>
 #include <vector>
 
@@ -41,6 +42,8 @@ struct LongPulses;
 namespace pv {
 namespace data {
 
+class TransitionList;
+
 class LogicSegment : public Segment
 {
 private:
@@ -57,31 +60,108 @@ private:
 	static const int MipMapScaleFactor;
 	static const float LogMipMapScaleFactor;
 	static const uint64_t MipMapDataUnit;
+	static const uint64_t MipMapParallelBlocks;
+	static const uint64_t SearchWindow;
 
 public:
 	typedef std::pair<int64_t, bool> EdgePair;
+	typedef std::pair<uint64_t, uint64_t> Transition;
+
+	/**
+	 * A condition on the channels, looked for by find_matches().
+	 */
+	struct SearchPattern
+	{
+		uint64_t mask;		///< Channels which must be at their level in value
+		uint64_t value;
+		uint64_t rising;	///< Channels which must go from low to high
+		uint64_t falling;	///< Channels which must go from high to low
+		uint64_t min_width;	///< Samples during which the levels must hold
+	};
 
 public:
 	LogicSegment(std::shared_ptr<sigrok::Logic> logic,
 		uint64_t samplerate, uint64_t expected_num_samples = 0);
 
+	/**
+	 * Creates an empty segment for samples that are not wrapped in
+	 * sigrok packets, i.e. captured straight from the hardware.
+	 * @param[in] unit_size The size of one sample, in bytes.
+	 * @param[in] transition_mode If true, only the transitions of each
+	 * channel are stored instead of the samples (see TransitionList).
+	 * Meant for long captures of sparse buses; a segment in this mode
+	 * can not be used as a ring buffer.
+	 */
+	LogicSegment(unsigned int unit_size,
+		uint64_t samplerate, uint64_t expected_num_samples = 0,
+		bool transition_mode = false);
+
 	virtual ~LogicSegment();
 
 	void append_payload(std::shared_ptr<sigrok::Logic> logic);
 	void replace_payload(std::shared_ptr<sigrok::Logic> logic);
 
+	/**
+	 * Same as the sigrok::Logic overloads, for raw samples of
+	 * @c unit_size() bytes each. The samples are copied once, straight
+	 * into the segment.
+	 */
+	void append_payload(const void *data, uint64_t samples);
+	void replace_payload(const void *data, uint64_t samples);
+
 	void get_samples(uint8_t *const data,
 		int64_t start_sample, int64_t end_sample) const;
 	uint64_t get_sample(uint64_t index) const;
 
+	bool transition_mode() const;
+
+	/**
+	 * Gets the samples in (start, end) where any of the channels in
+	 * mask changes, together with the value of the sample. Works on
+	 * both storage modes.
+	 */
+	void get_transitions(std::vector<Transition> &transitions,
+		uint64_t start, uint64_t end, uint64_t mask = ~0ULL) const;
+
+	/**
+	 * Finds the samples in [start, end) where the pattern starts to
+	 * match, up to max_matches of them. At such a sample all the
+	 * channels of the pattern are at their level, the edge channels
+	 * having just changed, and they weren't on the previous sample. The
+	 * levels then have to hold for at least min_width samples.
+	 */
+	void find_matches(std::vector<uint64_t> &matches,
+		const SearchPattern &pattern, uint64_t start, uint64_t end,
+		uint64_t max_matches = ~0ULL) const;
+
+	/**
+	 * Finds the last match of the pattern before the given sample.
+	 * Returns false if there is none.
+	 */
+	bool find_previous_match(const SearchPattern &pattern,
+		uint64_t before, uint64_t &index) const;
+
 private:
 	uint64_t unpack_sample(const uint8_t *ptr) const;
 	void pack_sample(uint8_t *ptr, uint64_t value);
 	
-	void reallocate_mipmap_level(MipMapLevel &m);
+	void reallocate_mipmap_level(MipMapLevel &m, uint64_t length);
 
 	void append_payload_to_mipmap(uint64_t prev_active=0);
 
+	/**
+	 * Computes the blocks [prev_index, end_index) of a mip-map level.
+	 * Large ranges are split among several threads.
+	 * @param[in] last The sample preceding the first block, only used
+	 * for the first level.
+	 */
+	template <typename T>
+	void build_mipmap_level(unsigned int level,
+		uint64_t prev_index, uint64_t end_index, uint64_t last);
+
+	void build_mipmap_level_generic(unsigned int level,
+		uint64_t prev_index, uint64_t end_index, uint64_t last);
+
 
 
 public:
@@ -94,20 +174,59 @@ public:
 	 * @param[in] min_length The minimum number of samples that
 	 * can be resolved at this level of detail.
 	 * @param[in] sig_index The index of the signal.
+	 * @return The sample up to which the mip-map was used. The edges
+	 * after it were found in samples which are still being mapped, and
+	 * may be placed differently once the mip-map covers them.
 	 */
-	void get_subsampled_edges(std::vector<EdgePair> &edges,
+	uint64_t get_subsampled_edges(std::vector<EdgePair> &edges,
 		uint64_t start, uint64_t end,
 		float min_length, int sig_index);
 
+	/**
+	 * Returns the sample up to which get_subsampled_edges() currently
+	 * uses the mip-map at this level of detail.
+	 */
+	uint64_t get_mapped_end(float min_length) const;
+
 private:
+	void get_subsampled_transitions(std::vector<EdgePair> &edges,
+		uint64_t start, uint64_t end,
+		float min_length, int sig_index);
+
 	uint64_t get_subsample(int level, uint64_t offset) const;
 
+	static unsigned int mipmap_min_level(float min_length);
+
+	/**
+	 * The number of samples covered by the published blocks of a
+	 * mip-map level. Called with the mutex held.
+	 */
+	uint64_t mapped_end(unsigned int level) const;
+
+	/**
+	 * Returns the first sample in [from, end) which differs from the
+	 * previous one on the channels in mask, or end. The mip-map blocks
+	 * without changes are skipped.
+	 */
+	uint64_t find_change(uint64_t from, uint64_t end, uint64_t mask) const;
+
+	uint64_t scan_change(uint64_t from, uint64_t end, uint64_t mask) const;
+
+	/**
+	 * Calls func(index) for the matches of the pattern in [start, end)
+	 * until it returns false.
+	 */
+	template <typename Func>
+	void search(const SearchPattern &pattern, uint64_t start,
+		uint64_t end, Func func) const;
+
 	static uint64_t pow2_ceil(uint64_t x, unsigned int power);
 
 private:
 	struct MipMapLevel mip_map_[ScaleStepCount];
 	uint64_t last_append_sample_;
 	bool replace_mode;
+	std::unique_ptr<TransitionList> transitions_;
 
 	friend struct LogicSegmentTest::Pow2;
 	friend struct LogicSegmentTest::Basic;
@@ -37,7 +37,8 @@ Segment::Segment(uint64_t samplerate, unsigned int unit_size) :
 	samplerate_(samplerate),
 	capacity_(0),
 	unit_size_(unit_size),
-	active_sample_index_(0)
+	active_sample_index_(0),
+	generation_(0)
 {
 	lock_guard<recursive_mutex> lock(mutex_);
 	assert(unit_size_ > 0);
@@ -79,6 +80,12 @@ unsigned int Segment::unit_size() const
 	return unit_size_;
 }
 
+uint64_t Segment::generation() const
+{
+	lock_guard<recursive_mutex> lock(mutex_);
+	return generation_;
+}
+
 void Segment::set_capacity(const uint64_t new_capacity)
 {
 	lock_guard<recursive_mutex> lock(mutex_);
@@ -97,7 +104,7 @@ uint64_t Segment::capacity() const
 	return data_.size();
 }
 
-void Segment::append_data(void *data, uint64_t samples)
+void Segment::append_data(const void *data, uint64_t samples)
 {
 	lock_guard<recursive_mutex> lock(mutex_);
 
@@ -115,7 +122,7 @@ void Segment::append_data(void *data, uint64_t samples)
 	active_sample_index_ = total_sample_count_;
 }
 
-void Segment::replace_data(void *data, uint64_t samples)
+void Segment::replace_data(const void *data, uint64_t samples)
 {
         lock_guard<recursive_mutex> lock(mutex_);
         assert(capacity_ == sample_count_);
@@ -126,13 +133,14 @@ void Segment::replace_data(void *data, uint64_t samples)
         if( samples > free_space )
                 samples_to_copy = free_space;
 
+        generation_++;
         memcpy((uint8_t*)data_.data() + active_sample_index_ * unit_size_,
                data, samples_to_copy * unit_size_);
 
         if(samples_to_copy !=  samples) {
                 samples_left =  samples - samples_to_copy;
                 memcpy((uint8_t*)data_.data(),
-                        (uint8_t*)data + samples_to_copy * unit_size_,
+                        (const uint8_t*)data + samples_to_copy * unit_size_,
                         samples_left * unit_size_);
         }
         total_sample_count_ += samples;
@@ -46,6 +46,15 @@ public:
 
 	unsigned int unit_size() const;
 
+	/**
+	 * @brief Get the number of times the samples have been overwritten.
+	 *
+	 * Appending samples leaves the ones already in the segment untouched
+	 * and doesn't change the generation, so whatever was computed from
+	 * them stays valid.
+	 */
+	uint64_t generation() const;
+
 	/**
 	 * @brief Increase the capacity of the segment.
 	 *
@@ -74,8 +83,8 @@ public:
 	uint64_t capacity() const;
 
 protected:
-	void append_data(void *data, uint64_t samples);
-	void replace_data(void *data, uint64_t samples);
+	void append_data(const void *data, uint64_t samples);
+	void replace_data(const void *data, uint64_t samples);
 
 protected:
 	mutable std::recursive_mutex mutex_;
@@ -87,6 +96,7 @@ protected:
 	double samplerate_;
 	uint64_t capacity_;
 	unsigned int unit_size_;
+	uint64_t generation_;
 };
 
 } // namespace data
@@ -0,0 +1,385 @@
+/*
+ * Copyright 2019 Analog Devices, Inc.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Radio; see the file LICENSE.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include "transitionlist.hpp"
+
+#include <algorithm>
+#include <cassert>
+
+using std::pair;
+using std::vector;
+
+namespace pv {
+namespace data {
+
+namespace {
+
+/* Number of samples compared at once when looking for a change */
+const unsigned int ScanStride = 8;
+
+void encode_delta(vector<uint8_t> &out, uint64_t delta)
+{
+	while (delta >= 0x80) {
+		out.push_back((uint8_t)(delta | 0x80));
+		delta >>= 7;
+	}
+	out.push_back((uint8_t)delta);
+}
+
+uint64_t decode_delta(const uint8_t *&ptr)
+{
+	uint64_t delta = 0;
+	unsigned int shift = 0;
+
+	while (*ptr & 0x80) {
+		delta |= (uint64_t)(*ptr++ & 0x7f) << shift;
+		shift += 7;
+	}
+	delta |= (uint64_t)(*ptr++) << shift;
+
+	return delta;
+}
+
+uint64_t read_sample(const uint8_t *ptr, unsigned int unit_size)
+{
+	uint64_t value = 0;
+
+	for (unsigned int i = 0; i < unit_size; i++)
+		value |= (uint64_t)ptr[i] << (8 * i);
+
+	return value;
+}
+
+void write_sample(uint8_t *ptr, uint64_t value, unsigned int unit_size)
+{
+	for (unsigned int i = 0; i < unit_size; i++)
+		ptr[i] = value >> (8 * i);
+}
+
+}
+
+TransitionList::TransitionList(unsigned int unit_size) :
+	unit_size_(unit_size),
+	channels_(unit_size * 8),
+	sample_count_(0),
+	initial_(0),
+	last_sample_(0),
+	edge_count_(0),
+	memory_used_(0)
+{
+	assert(unit_size > 0 && unit_size <= sizeof(uint64_t));
+
+	for (Channel &ch : channels_)
+		ch.edges = 0;
+}
+
+void TransitionList::append(const void *data, uint64_t samples)
+{
+	const uint8_t *ptr = (const uint8_t*)data;
+
+	if (!samples)
+		return;
+
+	if (sample_count_ == 0) {
+		initial_ = last_sample_ = read_sample(ptr, unit_size_);
+		ptr += unit_size_;
+		samples--;
+		sample_count_++;
+	}
+
+	// The typed scans need the samples to be aligned
+	const bool aligned = ((uintptr_t)ptr % unit_size_) == 0;
+
+	switch (aligned ? unit_size_ : 0) {
+	case 1:
+		scan((const uint8_t*)ptr, samples);
+		break;
+	case 2:
+		scan((const uint16_t*)ptr, samples);
+		break;
+	case 4:
+		scan((const uint32_t*)ptr, samples);
+		break;
+	case 8:
+		scan((const uint64_t*)ptr, samples);
+		break;
+	default:
+		scan_generic(ptr, samples);
+		break;
+	}
+
+	sample_count_ += samples;
+}
+
+template <typename T>
+void TransitionList::scan(const T *data, uint64_t samples)
+{
+	const uint64_t base = sample_count_;
+	T last = (T)last_sample_;
+	uint64_t i = 0;
+
+	while (i < samples) {
+		// Skip the runs without changes a few samples at a time;
+		// the comparison is turned into SIMD instructions
+		if (samples - i >= ScanStride) {
+			T diff = 0;
+
+			for (unsigned int k = 0; k < ScanStride; k++)
+				diff |= data[i + k] ^ last;
+
+			if (!diff) {
+				i += ScanStride;
+				continue;
+			}
+		}
+
+		const T sample = data[i];
+		if (sample != last) {
+			push_edges((uint64_t)(T)(sample ^ last), base + i);
+			last = sample;
+		}
+		i++;
+	}
+
+	last_sample_ = last;
+}
+
+void TransitionList::scan_generic(const uint8_t *data, uint64_t samples)
+{
+	const uint64_t base = sample_count_;
+
+	for (uint64_t i = 0; i < samples; i++) {
+		const uint64_t sample = read_sample(data + i * unit_size_,
+			unit_size_);
+
+		if (sample != last_sample_) {
+			push_edges(sample ^ last_sample_, base + i);
+			last_sample_ = sample;
+		}
+	}
+}
+
+void TransitionList::push_edges(uint64_t diff, uint64_t index)
+{
+	while (diff) {
+		Channel &ch = channels_[__builtin_ctzll(diff)];
+		diff &= diff - 1;
+
+		if (ch.blocks.empty() || ch.blocks.back().count == BlockEdges) {
+			Block block;
+
+			block.first = block.last = index;
+			block.before = ch.edges;
+			block.count = 1;
+			ch.blocks.push_back(block);
+			memory_used_ += sizeof(Block);
+		} else {
+			Block &block = ch.blocks.back();
+			const size_t size = block.deltas.size();
+
+			encode_delta(block.deltas, index - block.last);
+			memory_used_ += block.deltas.size() - size;
+			block.last = index;
+			block.count++;
+		}
+
+		ch.edges++;
+		edge_count_++;
+	}
+}
+
+uint64_t TransitionList::sample_count() const
+{
+	return sample_count_;
+}
+
+uint64_t TransitionList::edge_count() const
+{
+	return edge_count_;
+}
+
+size_t TransitionList::memory_used() const
+{
+	return memory_used_;
+}
+
+int64_t TransitionList::find_block(const Channel &ch, uint64_t index) const
+{
+	const auto it = std::upper_bound(ch.blocks.begin(), ch.blocks.end(),
+		index, [](uint64_t i, const Block &b) { return i < b.first; });
+
+	return (int64_t)(it - ch.blocks.begin()) - 1;
+}
+
+uint64_t TransitionList::edges_up_to(const Channel &ch, uint64_t index) const
+{
+	const int64_t b = find_block(ch, index);
+
+	if (b < 0)
+		return 0;
+
+	const Block &block = ch.blocks[b];
+	if (index >= block.last)
+		return block.before + block.count;
+
+	const uint8_t *ptr = block.deltas.data();
+	uint64_t edge = block.first;
+	unsigned int n = 1;
+
+	for (; n < block.count; n++) {
+		edge += decode_delta(ptr);
+		if (edge > index)
+			break;
+	}
+
+	return block.before + n;
+}
+
+bool TransitionList::level(unsigned int channel, uint64_t index) const
+{
+	assert(channel < channels_.size());
+
+	const bool initial = (initial_ >> channel) & 1;
+
+	return initial ^ (edges_up_to(channels_[channel], index) & 1);
+}
+
+uint64_t TransitionList::sample(uint64_t index) const
+{
+	uint64_t value = 0;
+
+	for (unsigned int ch = 0; ch < channels_.size(); ch++)
+		if (level(ch, index))
+			value |= 1ULL << ch;
+
+	return value;
+}
+
+void TransitionList::get_edges(unsigned int channel, uint64_t start,
+	uint64_t end, vector<uint64_t> &edges) const
+{
+	assert(channel < channels_.size());
+
+	const Channel &ch = channels_[channel];
+	const int64_t first = std::max<int64_t>(find_block(ch, start), 0);
+
+	for (size_t b = first; b < ch.blocks.size(); b++) {
+		const Block &block = ch.blocks[b];
+		const uint8_t *ptr = block.deltas.data();
+		uint64_t edge = block.first;
+
+		if (block.first >= end)
+			break;
+		if (block.last < start)
+			continue;
+
+		for (unsigned int n = 0; n < block.count; n++) {
+			if (n)
+				edge += decode_delta(ptr);
+			if (edge >= end)
+				return;
+			if (edge >= start)
+				edges.push_back(edge);
+		}
+	}
+}
+
+uint64_t TransitionList::next_edge(unsigned int channel, uint64_t index) const
+{
+	assert(channel < channels_.size());
+
+	const Channel &ch = channels_[channel];
+	const int64_t first = std::max<int64_t>(find_block(ch, index), 0);
+
+	for (size_t b = first; b < ch.blocks.size(); b++) {
+		const Block &block = ch.blocks[b];
+		const uint8_t *ptr = block.deltas.data();
+		uint64_t edge = block.first;
+
+		if (block.last < index)
+			continue;
+
+		for (unsigned int n = 0; n < block.count; n++) {
+			if (n)
+				edge += decode_delta(ptr);
+			if (edge >= index)
+				return edge;
+		}
+	}
+
+	return ~0ULL;
+}
+
+void TransitionList::get_transitions(uint64_t start, uint64_t end,
+	uint64_t mask, vector<Transition> &transitions) const
+{
+	vector< pair<uint64_t, uint64_t> > changes;
+	vector<uint64_t> edges;
+
+	// Collect the edges of all the channels, as the complete value of
+	// the samples is returned, then merge them by sample index
+	for (unsigned int ch = 0; ch < channels_.size(); ch++) {
+		edges.clear();
+		get_edges(ch, start + 1, end, edges);
+
+		for (uint64_t e : edges)
+			changes.push_back(pair<uint64_t, uint64_t>(e, 1ULL << ch));
+	}
+
+	std::sort(changes.begin(), changes.end());
+
+	uint64_t value = sample(start);
+
+	for (size_t i = 0; i < changes.size();) {
+		const uint64_t index = changes[i].first;
+		uint64_t diff = 0;
+
+		for (; i < changes.size() && changes[i].first == index; i++)
+			diff |= changes[i].second;
+
+		value ^= diff;
+
+		if (diff & mask)
+			transitions.push_back(Transition(index, value));
+	}
+}
+
+void TransitionList::get_samples(uint8_t *data, uint64_t start,
+	uint64_t end) const
+{
+	vector<Transition> transitions;
+	uint64_t value = sample(start);
+	uint64_t index = start;
+
+	assert(start <= end);
+
+	get_transitions(start, end, ~0ULL, transitions);
+	transitions.push_back(Transition(end, 0));
+
+	for (const Transition &t : transitions) {
+		for (; index < t.first; index++) {
+			write_sample(data, value, unit_size_);
+			data += unit_size_;
+		}
+		value = t.second;
+	}
+}
+
+} // namespace data
+} // namespace pv
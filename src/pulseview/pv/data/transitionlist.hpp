@@ -0,0 +1,146 @@
+/*
+ * Copyright 2019 Analog Devices, Inc.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Radio; see the file LICENSE.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef PULSEVIEW_PV_DATA_TRANSITIONLIST_HPP
+#define PULSEVIEW_PV_DATA_TRANSITIONLIST_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace pv {
+namespace data {
+
+/**
+ * Run-length storage of logic samples.
+ *
+ * Instead of the samples, the list keeps the level of every channel at
+ * the first sample and, for each channel, the indexes of the samples
+ * where the channel changes. The indexes are delta-encoded (LEB128) in
+ * blocks of BlockEdges edges, so the memory used is proportional to the
+ * activity on the bus rather than to the length of the capture.
+ */
+class TransitionList
+{
+public:
+	typedef std::pair<uint64_t, uint64_t> Transition;
+
+	static const unsigned int BlockEdges = 256;
+
+public:
+	/**
+	 * @param[in] unit_size The size of one sample, in bytes (at most 8).
+	 */
+	explicit TransitionList(unsigned int unit_size);
+
+	/**
+	 * Appends samples of unit_size bytes each.
+	 */
+	void append(const void *data, uint64_t samples);
+
+	uint64_t sample_count() const;
+
+	/**
+	 * The number of edges stored, on all the channels.
+	 */
+	uint64_t edge_count() const;
+
+	/**
+	 * The memory used by the edge blocks, in bytes.
+	 */
+	size_t memory_used() const;
+
+	bool level(unsigned int channel, uint64_t index) const;
+
+	uint64_t sample(uint64_t index) const;
+
+	/**
+	 * Expands the samples [start, end) into unit_size byte samples.
+	 */
+	void get_samples(uint8_t *data, uint64_t start, uint64_t end) const;
+
+	/**
+	 * Gets the edges of one channel in [start, end). An edge is stored as
+	 * the index of the first sample with the new level.
+	 */
+	void get_edges(unsigned int channel, uint64_t start, uint64_t end,
+		std::vector<uint64_t> &edges) const;
+
+	/**
+	 * Returns the first edge of a channel at or after index, or ~0 if
+	 * there is none.
+	 */
+	uint64_t next_edge(unsigned int channel, uint64_t index) const;
+
+	/**
+	 * Gets the samples in (start, end) where any of the channels in
+	 * mask changes, together with the complete value of the sample.
+	 */
+	void get_transitions(uint64_t start, uint64_t end, uint64_t mask,
+		std::vector<Transition> &transitions) const;
+
+private:
+	struct Block
+	{
+		uint64_t first;		///< Index of the first edge
+		uint64_t last;		///< Index of the last edge
+		uint64_t before;	///< Number of edges in the previous blocks
+		unsigned int count;
+		std::vector<uint8_t> deltas;
+	};
+
+	struct Channel
+	{
+		std::vector<Block> blocks;
+		uint64_t edges;
+	};
+
+	template <typename T>
+	void scan(const T *data, uint64_t samples);
+
+	void scan_generic(const uint8_t *data, uint64_t samples);
+
+	void push_edges(uint64_t diff, uint64_t index);
+
+	/**
+	 * Returns the index of the last block whose first edge is at or
+	 * before index, or -1 if there is none.
+	 */
+	int64_t find_block(const Channel &ch, uint64_t index) const;
+
+	/**
+	 * Counts the edges at or before index.
+	 */
+	uint64_t edges_up_to(const Channel &ch, uint64_t index) const;
+
+private:
+	const unsigned int unit_size_;
+	std::vector<Channel> channels_;
+	uint64_t sample_count_;
+	uint64_t initial_;
+	uint64_t last_sample_;
+	uint64_t edge_count_;
+	size_t memory_used_;
+};
+
+} // namespace data
+} // namespace pv
+
+#endif // PULSEVIEW_PV_DATA_TRANSITIONLIST_HPP
@@ -26,6 +26,7 @@
 #include <iio.h>
 #include <iostream>
 #include "logic_analyzer.hpp"
+#include "../session.hpp"
 
 using std::recursive_mutex;
 using std::lock_guard;
@@ -51,9 +52,15 @@ BinaryStream::BinaryStream(const std::shared_ptr<sigrok::Context> &context,
 	autoTrigger(false),
         data_(nullptr),
         stream_mode(false),
-        actual_buffersize(0)
+        actual_buffersize(0),
+	capture_session_(nullptr),
+	holdoff_(0)
 {
-	/* 10 buffers, 10ms each -> 250ms before we lose data */
+	/*
+	 * The kernel keeps the blocks queued to the DMA, so the next buffer
+	 * is filled by the hardware while the previous one is decoded and
+	 * displayed. 10 buffers, 10ms each -> 250ms before we lose data
+	 */
 	if(dev)
 		iio_device_set_kernel_buffers_count(dev_, 25);
 }
@@ -125,6 +132,64 @@ void BinaryStream::start()
 	}
 }
 
+void BinaryStream::set_capture_session(pv::Session *session)
+{
+	capture_session_ = session;
+}
+
+/*
+ * The DIO words in the iio buffer have the layout of a 16 channel logic
+ * sample, so they are appended to the logic segment as they are. The
+ * sigrok input module is only used when no session was given.
+ */
+void BinaryStream::send(const void *data, size_t nbytes)
+{
+	if (!capture_session_) {
+		input_->send((void *)data, nbytes);
+		return;
+	}
+
+	try {
+		capture_session_->feed_in_logic(data,
+			nbytes / sizeof(uint16_t), sizeof(uint16_t));
+	} catch (std::bad_alloc) {
+		qDebug() << "Out of memory, acquisition stopped.";
+		capture_session_->set_out_of_memory();
+		interrupt_ = true;
+	}
+}
+
+void BinaryStream::end()
+{
+	if (capture_session_)
+		capture_session_->feed_in_end();
+	else
+		input_->end();
+}
+
+void BinaryStream::set_holdoff(double seconds)
+{
+	holdoff_ = seconds;
+}
+
+double BinaryStream::get_holdoff() const
+{
+	return holdoff_;
+}
+
+bool BinaryStream::holdoff_expired()
+{
+	const double holdoff = holdoff_;
+	const auto now = std::chrono::steady_clock::now();
+
+	if (holdoff > 0 && now - last_capture_ <
+			std::chrono::duration<double>(holdoff))
+		return false;
+
+	last_capture_ = now;
+	return true;
+}
+
 void BinaryStream::run()
 {
 	if(!dev_)
@@ -136,6 +201,7 @@ void BinaryStream::run()
 	size_t size_to_display;
 	input_->reset();
 	interrupt_ = false;
+	last_capture_ = std::chrono::steady_clock::time_point();
         while (!interrupt_)
         {
                 nbytes_rx = 0;
@@ -148,9 +214,17 @@ void BinaryStream::run()
 		if(data_)
 		{
                         nbytes_rx = iio_buffer_refill(data_);
-			std::this_thread::sleep_for(std::chrono::milliseconds(5)); // implement soft holdoff of 5ms
 		}
 
+                /* Captures triggered during the holdoff are dropped */
+                if( nbytes_rx > 0 && nrx == 0 && !stream_mode &&
+                                !holdoff_expired() ) {
+                        if(autoTrigger) {
+                                la->stopTimeout();
+                        }
+                        continue;
+                }
+
                 if( nbytes_rx > 0 ) {
                         if( actual_buffersize != buffersize_ ) {
                                 nbytes_rx -= ((actual_buffersize-buffersize_) * 2);
@@ -160,17 +234,24 @@ void BinaryStream::run()
                         size_to_display = (nrx > entire_buffersize && !stream_mode) ?
                                                 nbytes_rx-2*(nrx-entire_buffersize) : nbytes_rx;
                         if(data_)
-                                input_->send(iio_buffer_start(data_), (size_t)(size_to_display));
+                                send(iio_buffer_start(data_), (size_t)(size_to_display));
                         la->bufferSentSignal(false);
 
                         if( nrx >= entire_buffersize && !stream_mode) {
                                 size_t remaining_samples = 2 * (nrx - entire_buffersize);
                                 if( !single_ ) {
-                                        input_->end();
-                                        if(data_ && remaining_samples > 0)
-                                                input_->send((char*)iio_buffer_start(data_)+(size_t)(size_to_display),
-                                                     remaining_samples);
+                                        end();
                                         nrx = 0;
+                                        /* The rest of the buffer starts the next
+                                         * frame, unless the holdoff drops it: the
+                                         * following buffers must not be stitched
+                                         * to samples captured before the holdoff */
+                                        if(data_ && remaining_samples > 0 &&
+                                                        holdoff_expired()) {
+                                                send((char*)iio_buffer_start(data_)+(size_t)(size_to_display),
+                                                     remaining_samples);
+                                                nrx = remaining_samples / 2;
+                                        }
                                         la->bufferSentSignal(true);
                                 }
                         }
@@ -187,7 +268,7 @@ void BinaryStream::run()
                         }
                 }
         }
-        input_->end();
+        end();
         interrupt_ = false;
         single_ = false;
 }
@@ -21,6 +21,7 @@
 #define PULSEVIEW_PV_DEVICE_BINARY_STREAM_HPP
 
 #include <atomic>
+#include <chrono>
 
 #include <libsigrokcxx/libsigrokcxx.hpp>
 #include "device.hpp"
@@ -38,6 +39,8 @@ namespace adiscope {
 }
 
 namespace pv {
+class Session;
+
 namespace devices {
 
 class BinaryStream final : public Device
@@ -92,7 +95,27 @@ public:
         bool get_single();
 
         bool is_running();
+
+	/**
+	 * Hands the captured samples straight to the given session instead
+	 * of going through the sigrok input module. The input module is
+	 * still used to describe the device (channels, sample rate).
+	 */
+	void set_capture_session(pv::Session *session);
+
+	/**
+	 * Minimum time between two displayed captures, in seconds. Triggers
+	 * received while the holdoff is running are ignored. Does not apply
+	 * to the stream mode.
+	 */
+	void set_holdoff(double seconds);
+
+	double get_holdoff() const;
 private:
+	void send(const void *data, size_t nbytes);
+	void end();
+	bool holdoff_expired();
+
 	const std::shared_ptr<sigrok::Context> context_;
 	const std::shared_ptr<sigrok::InputFormat> format_;
 	std::map<std::string, Glib::VariantBase> options_;
@@ -112,6 +135,9 @@ private:
 	ssize_t nbytes_rx;
 	mutable std::recursive_mutex data_mutex_;
         bool stream_mode;
+	pv::Session *capture_session_;
+	std::atomic<double> holdoff_;
+	std::chrono::steady_clock::time_point last_capture_;
 };
 
 } // namespace devices
@@ -98,7 +98,8 @@ Session::Session(DeviceManager &device_manager) :
 	timeSpan(0),
 	timespanLimitStream(0),
 	screen_mode_(false),
-	entire_buffersize_(0)
+	entire_buffersize_(0),
+	transition_storage_(false)
 {
 }
 
@@ -428,6 +429,16 @@ bool Session::is_screen_mode()
 	return screen_mode_;
 }
 
+void Session::set_transition_storage(bool value)
+{
+	transition_storage_ = value;
+}
+
+bool Session::is_transition_storage()
+{
+	return transition_storage_;
+}
+
 void Session::set_samplerate(double value)
 {
 	cur_samplerate_ = value;
@@ -615,6 +626,11 @@ void Session::sample_thread_proc(shared_ptr<devices::Device> device,
 		error_handler(tr("Out of memory, acquisition stopped."));
 }
 
+void Session::set_out_of_memory()
+{
+	out_of_memory_ = true;
+}
+
 void Session::feed_in_header()
 {
 	if(timespanLimitStream == 0)
@@ -671,9 +687,15 @@ void Session::feed_in_frame_begin()
 
 void Session::feed_in_logic(shared_ptr<Logic> logic)
 {
-	lock_guard<recursive_mutex> lock(data_mutex_);
+	feed_in_logic(logic->data_pointer(),
+		logic->data_length() / logic->unit_size(),
+		logic->unit_size());
+}
 
-	const size_t sample_count = logic->data_length() / logic->unit_size();
+void Session::feed_in_logic(const void *data, uint64_t sample_count,
+	unsigned int unit_size)
+{
+	lock_guard<recursive_mutex> lock(data_mutex_);
 
 	if (!logic_data_) {
 		// The only reason logic_data_ would not have been created is
@@ -694,7 +716,8 @@ void Session::feed_in_logic(shared_ptr<Logic> logic)
 		// Create a new data segment
 		cur_logic_segment_ = shared_ptr<data::LogicSegment>(
 			new data::LogicSegment(
-				logic, cur_samplerate_, sample_count));
+				unit_size, cur_samplerate_, sample_count,
+				transition_storage_ && !screen_mode_));
 		logic_data_->push_segment(cur_logic_segment_);
 
 		// @todo Putting this here means that only listeners querying
@@ -704,17 +727,30 @@ void Session::feed_in_logic(shared_ptr<Logic> logic)
 		frame_began();
 		new_segment_received();
 	}
+
+	assert(cur_logic_segment_->unit_size() == unit_size);
+
 	if( (entire_buffersize_ - get_logic_sample_count() < sample_count)
 			&& screen_mode_) {
-		cur_logic_segment_->replace_payload(logic);
+		cur_logic_segment_->replace_payload(data, sample_count);
 	}
 	else {
 		// Append to the existing data segment
-		cur_logic_segment_->append_payload(logic);
+		cur_logic_segment_->append_payload(data, sample_count);
 	}
 	data_received();
 }
 
+void Session::feed_in_end()
+{
+	if(!screen_mode_) {
+		lock_guard<recursive_mutex> lock(data_mutex_);
+		cur_logic_segment_.reset();
+		cur_analog_segments_.clear();
+	}
+	frame_ended();
+}
+
 bool Session::is_data()
 {
 	if(logic_data_->segments().size() == 0)
@@ -847,17 +883,9 @@ void Session::data_feed_in(shared_ptr<sigrok::Device> device,
 		break;
 
 	case SR_DF_END:
-	{
-		{
-			if(!screen_mode_) {
-				lock_guard<recursive_mutex> lock(data_mutex_);
-				cur_logic_segment_.reset();
-				cur_analog_segments_.clear();
-			}
-			frame_ended();
-		}
+		feed_in_end();
 		break;
-	}
+
 	default:
 		break;
 	}
@@ -147,6 +147,14 @@ public:
 
 	bool is_screen_mode();
 
+	/**
+	 * Stores the next captures as lists of transitions instead of
+	 * samples. Not used in screen mode, where segments wrap around.
+	 */
+	void set_transition_storage(bool value);
+
+	bool is_transition_storage();
+
 	void set_samplerate(double value);
 
 	void set_timeSpan(double value);
@@ -163,6 +171,28 @@ public:
 
 	void clear_data();
 
+	/**
+	 * Appends raw logic samples to the current segment, bypassing the
+	 * sigrok packet path. Called from the sampling thread by devices
+	 * that capture samples natively, such as the logic analyzer.
+	 * @param[in] data The samples, @c unit_size bytes each.
+	 * @param[in] sample_count The number of samples.
+	 * @param[in] unit_size The size of one sample, in bytes.
+	 */
+	void feed_in_logic(const void *data, uint64_t sample_count,
+		unsigned int unit_size);
+
+	/**
+	 * Ends the current frame; the native counterpart of SR_DF_END.
+	 */
+	void feed_in_end();
+
+	/**
+	 * Flags the acquisition as stopped for lack of memory. The error
+	 * is reported when the capture ends, as for sigrok packets.
+	 */
+	void set_out_of_memory();
+
 private:
 	void set_capture_state(capture_state state);
 
@@ -219,6 +249,8 @@ private:
 
 	bool screen_mode_;
 
+	bool transition_storage_;
+
 	double timeSpan;
 
 	double timespanLimitStream;
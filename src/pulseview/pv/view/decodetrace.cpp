@@ -235,6 +235,11 @@ void DecodeTrace::paint_mid(QPainter &p, const ViewItemPaintParams &pp)
 	pair<uint64_t, uint64_t> sample_range = get_sample_range(
 		pp.left(), pp.right());
 
+	double samples_per_pixel, pixels_offset;
+	tie(pixels_offset, samples_per_pixel) =
+		get_pixels_offset_samples_per_pixel();
+	const uint64_t min_length = samples_per_pixel;
+
 	assert(decoder_stack_);
 	const vector<Row> rows(decoder_stack_->get_visible_rows());
 
@@ -258,10 +263,15 @@ void DecodeTrace::paint_mid(QPainter &p, const ViewItemPaintParams &pp)
 		boost::hash_combine(base_colour, row.row());
 		base_colour >>= 16;
 
+		// Annotations narrower than a pixel are fetched as blocks, so
+		// that zoomed out views don't go through all of them
 		vector<Annotation> annotations;
-		decoder_stack_->get_annotation_subset(annotations, row,
-			sample_range.first,sample_range.second);
-		if (!annotations.empty()) {
+		vector<RowData::Block> blocks;
+		decoder_stack_->get_annotation_subset(annotations, blocks, row,
+			sample_range.first, sample_range.second, min_length);
+		if (!annotations.empty() || !blocks.empty()) {
+			draw_coarse_blocks(blocks, p, annotation_height, y,
+				base_colour);
 			draw_annotations(annotations, p, annotation_height, pp, y,
 				base_colour, row_title_width);
 
@@ -533,6 +543,33 @@ void DecodeTrace::draw_annotation_block(
 		QRectF(start, top, end - start, bottom - top), h/4, h/4);
 }
 
+void DecodeTrace::draw_coarse_blocks(
+	const vector<pv::data::decode::RowData::Block> &blocks, QPainter &p,
+	int h, int y, size_t base_colour) const
+{
+	double samples_per_pixel, pixels_offset;
+	tie(pixels_offset, samples_per_pixel) =
+		get_pixels_offset_samples_per_pixel();
+
+	const double top = y + .5 - h / 2;
+	const double bottom = y + .5 + h / 2;
+
+	for (const auto &b : blocks) {
+		const double start = b.start_sample / samples_per_pixel -
+			pixels_offset;
+		const double end = b.end_sample / samples_per_pixel -
+			pixels_offset;
+		const bool single_format = b.format >= 0;
+		const size_t colour = (base_colour + b.format) % countof(Colours);
+
+		p.setPen((single_format ? OutlineColours[colour] : Qt::gray));
+		p.setBrush(QBrush((single_format ? Colours[colour] : Qt::gray),
+			Qt::Dense4Pattern));
+		p.drawRoundedRect(
+			QRectF(start, top, end - start, bottom - top), h/4, h/4);
+	}
+}
+
 void DecodeTrace::draw_instant(const pv::data::decode::Annotation &a, QPainter &p,
 	int h, double x, int y) const
 {
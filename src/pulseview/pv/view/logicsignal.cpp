@@ -110,7 +110,8 @@ LogicSignal::LogicSignal(
 	trigger_high_(nullptr),
 	trigger_falling_(nullptr),
 	trigger_low_(nullptr),
-	trigger_change_(nullptr)
+	trigger_change_(nullptr),
+	edge_cache_()
 {
 	shared_ptr<Trigger> trigger;
 
@@ -171,11 +172,8 @@ void LogicSignal::scale_handle_dragged(int offset)
 
 void LogicSignal::paint_mid(QPainter &p, const ViewItemPaintParams &pp)
 {
-	QLineF *line;
 	QColor penColor;
 
-	vector< pair<int64_t, bool> > edges;
-
 	assert(channel_);
 	assert(data_);
 	assert(owner_);
@@ -216,48 +214,119 @@ void LogicSignal::paint_mid(QPainter &p, const ViewItemPaintParams &pp)
 	const uint64_t end_sample = min(max(ceil(end).convert_to<int64_t>(),
 		(int64_t)0), last_sample);
 
-	segment->get_subsampled_edges(edges, start_sample, end_sample,
-		samples_per_pixel / Oversampling, channel_->index());
-	assert(edges.size() >= 2);
+	update_edges(segment, start_sample, end_sample, samples_per_pixel);
+	update_lines(samples_per_pixel, pixels_offset, pp.left(),
+		high_offset, low_offset);
 
-	// Paint the edges
-	const unsigned int edge_count = edges.size() - 2;
-	QLineF *const edge_lines = new QLineF[edge_count];
-	line = edge_lines;
-
-	for (auto i = edges.cbegin() + 1; i != edges.cend() - 1; i++) {
-		const float x = ((*i).first / samples_per_pixel -
-			pixels_offset) + pp.left();
-		*line++ = QLineF(x, high_offset, x, low_offset);
-	}
+	const EdgeCache &c = edge_cache_;
 
+	// Paint the edges
 	penColor = edgecolour().isValid() ? edgecolour() : EdgeColour;
 	p.setPen(QPen(penColor, getCh_thickness()));
-	p.drawLines(edge_lines, edge_count);
-	delete[] edge_lines;
+	p.drawLines(c.edge_lines.data(), c.edge_lines.size());
 
 	// Paint the caps
-	const unsigned int max_cap_line_count = edges.size();
-	QLineF *const cap_lines = new QLineF[max_cap_line_count];
-
 	penColor = highcolour().isValid() ? highcolour() : HighColour;
 	p.setPen(QPen(penColor, getCh_thickness()));
-	paint_caps(p, cap_lines, edges, true, samples_per_pixel,
-		pixels_offset, pp.left(), high_offset);
+	p.drawLines(c.high_lines.data(), c.high_lines.size());
 
 	penColor = lowcolour().isValid() ? lowcolour() : LowColour;
 	p.setPen(QPen(penColor, getCh_thickness()));
-	paint_caps(p, cap_lines, edges, false, samples_per_pixel,
-        pixels_offset, pp.left(), low_offset);
-
+	p.drawLines(c.low_lines.data(), c.low_lines.size());
 
 //	const int signal_margin =
 //		QFontMetrics(QApplication::font()).height() / 2;
 //	p.setPen(QPen(QColor(255, 255, 255, 30*256/100)));
 //	paint_axis(p, pp, low_offset + signal_margin);
 //	paint_axis(p, pp, high_offset - signal_margin);
+}
+
+void LogicSignal::update_edges(
+	const shared_ptr<pv::data::LogicSegment> &segment,
+	int64_t start_sample, uint64_t end_sample, double samples_per_pixel)
+{
+	EdgeCache &c = edge_cache_;
+	const float min_length = samples_per_pixel / Oversampling;
+
+	// Read before looking at the samples, so that edges computed while
+	// the segment is overwritten are never taken as up to date
+	const uint64_t generation = segment->generation();
+
+	const bool same_view = c.segment.lock() == segment &&
+		c.generation == generation &&
+		c.samples_per_pixel == samples_per_pixel &&
+		c.start_sample == start_sample;
+
+	// The edges past the mapped end were found in samples the mip-map
+	// didn't cover yet, so they are kept only until it does
+	if (same_view && c.end_sample == end_sample &&
+		min(end_sample, segment->get_mapped_end(min_length)) ==
+			c.mapped_end)
+		return;
+
+	if (same_view && end_sample >= c.end_sample &&
+		c.mapped_end > (uint64_t)start_sample) {
+		// Samples were appended, or mapped: the edges from the mapped
+		// end onwards, including the final markers, are replaced by
+		// the edges computed from there
+		vector< pair<int64_t, bool> > tail;
+
+		c.mapped_end = segment->get_subsampled_edges(tail, c.mapped_end,
+			end_sample, min_length, channel_->index());
+		assert(tail.size() >= 2);
 
-	delete[] cap_lines;
+		while (c.edges.back().first >= tail.front().first)
+			c.edges.pop_back();
+
+		const bool same_level =
+			c.edges.back().second == tail.front().second;
+		c.edges.insert(c.edges.end(),
+			tail.begin() + (same_level ? 1 : 0), tail.end());
+	} else {
+		c.edges.clear();
+		c.mapped_end = segment->get_subsampled_edges(c.edges,
+			start_sample, end_sample, min_length,
+			channel_->index());
+	}
+	assert(c.edges.size() >= 2);
+
+	c.segment = segment;
+	c.generation = generation;
+	c.samples_per_pixel = samples_per_pixel;
+	c.start_sample = start_sample;
+	c.end_sample = end_sample;
+	c.lines_valid = false;
+}
+
+void LogicSignal::update_lines(double samples_per_pixel,
+	double pixels_offset, float x_offset, float high_offset,
+	float low_offset)
+{
+	EdgeCache &c = edge_cache_;
+
+	if (c.lines_valid && c.pixels_offset == pixels_offset &&
+		c.x_offset == x_offset && c.high_offset == high_offset &&
+		c.low_offset == low_offset)
+		return;
+
+	// The buffers keep their capacity from one paint to the next
+	c.edge_lines.clear();
+	for (auto i = c.edges.cbegin() + 1; i != c.edges.cend() - 1; i++) {
+		const float x = ((*i).first / samples_per_pixel -
+			pixels_offset) + x_offset;
+		c.edge_lines.push_back(QLineF(x, high_offset, x, low_offset));
+	}
+
+	build_caps(c.high_lines, c.edges, true, samples_per_pixel,
+		pixels_offset, x_offset, high_offset);
+	build_caps(c.low_lines, c.edges, false, samples_per_pixel,
+		pixels_offset, x_offset, low_offset);
+
+	c.lines_valid = true;
+	c.pixels_offset = pixels_offset;
+	c.x_offset = x_offset;
+	c.high_offset = high_offset;
+	c.low_offset = low_offset;
 }
 
 void LogicSignal::paint_fore(QPainter &p, const ViewItemPaintParams &pp)
@@ -297,23 +366,21 @@ void LogicSignal::paint_fore(QPainter &p, const ViewItemPaintParams &pp)
 	}
 }
 
-void LogicSignal::paint_caps(QPainter &p, QLineF *const lines,
-	vector< pair<int64_t, bool> > &edges, bool level,
+void LogicSignal::build_caps(vector<QLineF> &lines,
+	const vector< pair<int64_t, bool> > &edges, bool level,
 	double samples_per_pixel, double pixels_offset, float x_offset,
-	float y_offset)
+	float y_offset) const
 {
-	QLineF *line = lines;
+	lines.clear();
 
 	for (auto i = edges.begin(); i != (edges.end() - 1); i++)
 		if ((*i).second == level) {
-			*line++ = QLineF(
+			lines.push_back(QLineF(
 				((*i).first / samples_per_pixel -
 					pixels_offset) + x_offset, y_offset,
 				((*(i+1)).first / samples_per_pixel -
-					pixels_offset) + x_offset, y_offset);
+					pixels_offset) + x_offset, y_offset));
 		}
-
-	p.drawLines(lines, line - lines);
 }
 
 void LogicSignal::init_trigger_actions(QWidget *parent)
@@ -22,10 +22,12 @@
 #define PULSEVIEW_PV_VIEW_LOGICSIGNAL_HPP
 
 #include <QCache>
+#include <QLineF>
 
 #include "signal.hpp"
 
 #include <memory>
+#include <vector>
 
 class QIcon;
 class QToolBar;
@@ -42,6 +44,7 @@ class Device;
 
 namespace data {
 class Logic;
+class LogicSegment;
 }
 
 namespace view {
@@ -117,10 +120,45 @@ public:
 	void setSignal_height(int signal_height);
 
 private:
-	void paint_caps(QPainter &p, QLineF *const lines,
-			std::vector< std::pair<int64_t, bool> > &edges,
+	/**
+	 * The edges found for the last painted view, and the lines drawn
+	 * from them. The edges are reused while the segment, the zoom and
+	 * the first sample don't change; samples appended to the segment
+	 * only extend them. The lines are rebuilt when the edges change or
+	 * the signal moves on the screen.
+	 */
+	struct EdgeCache
+	{
+		std::weak_ptr<pv::data::LogicSegment> segment;
+		uint64_t generation;
+		double samples_per_pixel;
+		int64_t start_sample;
+		uint64_t end_sample;
+		uint64_t mapped_end;	///< The edges after it are recomputed
+		std::vector< std::pair<int64_t, bool> > edges;
+
+		bool lines_valid;
+		double pixels_offset;
+		float x_offset;
+		float high_offset;
+		float low_offset;
+		std::vector<QLineF> edge_lines;
+		std::vector<QLineF> high_lines;
+		std::vector<QLineF> low_lines;
+	};
+
+	void update_edges(
+		const std::shared_ptr<pv::data::LogicSegment> &segment,
+		int64_t start_sample, uint64_t end_sample,
+		double samples_per_pixel);
+
+	void update_lines(double samples_per_pixel, double pixels_offset,
+		float x_offset, float high_offset, float low_offset);
+
+	void build_caps(std::vector<QLineF> &lines,
+		const std::vector< std::pair<int64_t, bool> > &edges,
 		bool level, double samples_per_pixel, double pixels_offset,
-		float x_offset, float y_offset);
+		float x_offset, float y_offset) const;
 
 	void init_trigger_actions(QWidget *parent);
 
@@ -152,6 +190,8 @@ private:
 	QAction *trigger_low_;
 	QAction *trigger_change_;
 
+	EdgeCache edge_cache_;
+
 	static QCache<QString, const QIcon> icon_cache_;
 	static QCache<QString, const QPixmap> pixmap_cache_;
 };
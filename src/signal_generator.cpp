@@ -23,6 +23,7 @@
 #include "spinbox_a.hpp"
 #include "ui_signal_generator.h"
 #include "channel_widget.hpp"
+#include "dac_streamer.hpp"
 
 #include <cmath>
 
@@ -50,13 +51,13 @@
 #include <gnuradio/blocks/multiply_const_ff.h>
 #include <gnuradio/blocks/add_const_ff.h>
 #include <gnuradio/blocks/add_ff.h>
-#include <gnuradio/blocks/repeat.h>
-#include <gnuradio/blocks/keep_one_in_n.h>
 #include <gnuradio/blocks/nop.h>
 #include <gnuradio/blocks/copy.h>
 #include <gnuradio/blocks/skiphead.h>
 #include <gnuradio/blocks/vector_sink_s.h>
 #include <gnuradio/blocks/null_source.h>
+#include <gnuradio/filter/firdes.h>
+#include <gnuradio/filter/pfb_arb_resampler_fff.h>
 #include <gnuradio/iio/device_sink.h>
 #include <gnuradio/iio/math.h>
 #include <matio.h>
@@ -71,6 +72,14 @@
 
 #define AMPLITUDE_VOLTS	5.0
 
+/* Polyphase resampler used to preview files at the plot sample rate */
+#define RESAMPLER_NB_FILTERS	32
+#define RESAMPLER_BW		0.4
+#define RESAMPLER_TB		0.2
+#define RESAMPLER_ATTENUATION	80.0
+#define RESAMPLER_MAX_TAPS	256 // per filter of the bank
+#define RESAMPLER_CACHE_SIZE	8
+
 using namespace adiscope;
 using namespace gr;
 
@@ -368,6 +377,7 @@ SignalGenerator::SignalGenerator(struct iio_context *_ctx,
 		ptr->file_offset = fileOffset->value();
 		ptr->file_phase = filePhase->value();
 		ptr->file_type=FORMAT_NO_FILE;
+		ptr->file_streamed=false;
 		ptr->file_nr_of_channels=0;
 		ptr->file_channel=0;
 
@@ -963,8 +973,23 @@ void SignalGenerator::updatePreview()
 		basic_block_sptr source;
 
 		if ((*it)->enableButton()->isChecked()) {
+			auto ptr = getData(*it);
+			double phase = 0.0;
+
+			if (ptr->type == SIGNAL_TYPE_WAVEFORM) {
+				int full_periods=(int)((double)zoomT1OnScreen*ptr->frequency);
+				double phase_in_time = zoomT1OnScreen - full_periods/ptr->frequency;
+				phase = (phase_in_time*ptr->frequency) * 360.0;
+			}
+
+			auto samples = renderPreview(*ptr, sample_rate,
+					nb_points + nb_points_correction, phase);
 
-			source = getSource((*it), sample_rate, top, true);
+			if (samples) {
+				source = blocks::vector_source_f::make(*samples);
+			} else {
+				source = getSource((*it), sample_rate, top, true);
+			}
 			enabled = true;
 		} else {
 			source = blocks::nop::make(sizeof(float));
@@ -1034,6 +1059,13 @@ bool SignalGenerator::loadParametersFromFile(
 	ptr->file_nr_of_channels=0;
 	ptr->file_nr_of_samples.clear();
 	ptr->file_channel=0;
+	ptr->file_streamed=false;
+
+	std::shared_ptr<GenericDac> dac ;
+	for(auto ch : channel_dac)
+		if(ptr->iio_ch==ch.first){
+			dac=ch.second;
+			break;}
 
 	if (ptr->file_type==FORMAT_BIN_FLOAT) {
 		ptr->file_nr_of_samples.push_back(info.size() / sizeof(float));
@@ -1099,26 +1131,40 @@ bool SignalGenerator::loadParametersFromFile(
 	}
 
 	if (ptr->file_type==FORMAT_CSV) {
+		unsigned int nr_of_columns = 0;
+		size_t nr_of_samples = 0;
+		double sample_rate = 0;
+
+		/* Count the rows first: the files that don't fit in the DAC
+		 * memory are streamed and never parsed as a whole */
+		SampleFileReader::scanCsv(ptr->file, nr_of_columns,
+					  nr_of_samples, sample_rate);
+
+		if (nr_of_samples <= dac->maxNumberOfSamples()) {
+			try {
+				fileManager->open(ptr->file, FileManager::IMPORT);
+			} catch(FileManagerException &e) {
+				ptr->file_message=QString::fromLocal8Bit(e.what());
+				ptr->file_nr_of_samples.push_back(0);
+				ptr->file_type=FORMAT_NO_FILE;
+				return false;
+			}
 
-		try {
-			fileManager->open(ptr->file, FileManager::IMPORT);
-		} catch(FileManagerException &e) {
-			ptr->file_message=QString::fromLocal8Bit(e.what());
-			ptr->file_nr_of_samples.push_back(0);
-			ptr->file_type=FORMAT_NO_FILE;
-			return false;
+			nr_of_columns = fileManager->getNrOfChannels();
+			nr_of_samples = fileManager->getNrOfSamples();
+			sample_rate = fileManager->getSampleRate();
 		}
 
 		ptr->file_data.clear();
-		ptr->file_nr_of_channels = fileManager->getNrOfChannels();
+		ptr->file_nr_of_channels = nr_of_columns;
 
-		if(fileManager->getSampleRate())
-			ptr->file_sr = fileManager->getSampleRate();
+		if(sample_rate)
+			ptr->file_sr = sample_rate;
 
 		ptr->file_channel=0; // autoselect channel 0
 		for (auto i=0; i<ptr->file_nr_of_channels; i++) {
 			ptr->file_channel_names.push_back("Column " + QString::number(i));
-			ptr->file_nr_of_samples.push_back(fileManager->getNrOfSamples());
+			ptr->file_nr_of_samples.push_back(nr_of_samples);
 		}
 
 		ptr->file_message="CSV";
@@ -1169,21 +1215,24 @@ bool SignalGenerator::loadParametersFromFile(
 
 	ui->fileChannel->setEnabled(ptr->file_nr_of_channels > 1);
 
-	std::shared_ptr<GenericDac> dac ;
-	for(auto ch : channel_dac)
-		if(ptr->iio_ch==ch.first){
-			dac=ch.second;
-			break;}
-
 	for(auto ch_samples : ptr->file_nr_of_samples)
 	{
 		if(ch_samples > dac->maxNumberOfSamples())
 		{
-			ptr->file_message = "File too big. Too many samples";
-			ptr->file_type=FORMAT_NO_FILE;
+			/* Files that don't fit in the DAC memory are played
+			 * back with non-cyclic buffers, straight from disk */
+			if (ptr->file_type == FORMAT_MAT) {
+				ptr->file_message = "File too big. Too many samples";
+				ptr->file_type=FORMAT_NO_FILE;
+			} else {
+				ptr->file_streamed = true;
+			}
 		}
 	}
 
+	if (ptr->file_streamed)
+		ptr->file_message += " (streamed)";
+
 	ptr->file_amplitude=1.0;
 	ptr->file_offset=0;
 	ptr->file_phase=0;
@@ -1254,7 +1303,7 @@ void SignalGenerator::start()
 	}
 
 	/* Avoid from being started twice */
-	if (buffers.size() > 0) {
+	if (buffers.size() > 0 || streamers.size() > 0) {
 		return;
 	}
 
@@ -1283,9 +1332,16 @@ void SignalGenerator::start()
 
 		/* First, disable all the channels of this device */
 		unsigned int nb = iio_device_get_channels_count(dev);
+		std::vector<bool> was_enabled(nb);
+		bool was_dma_sync = false;
+
+		iio_device_attr_read_bool(dev, "dma_sync", &was_dma_sync);
 
 		for (unsigned int i = 0; i < nb; i++) {
-			iio_channel_disable(iio_device_get_channel(dev, i));
+			struct iio_channel *chn = iio_device_get_channel(dev, i);
+
+			was_enabled[i] = iio_channel_is_enabled(chn);
+			iio_channel_disable(chn);
 		}
 
 		/* Then enable the channels that we want */
@@ -1298,6 +1354,44 @@ void SignalGenerator::start()
 		/* Enable the (optional) DMA sync */
 		iio_device_attr_write_bool(dev, "dma_sync", true);
 
+		/* Streamed files need a device for themselves */
+		auto streamed = std::find_if(enabled_channels.begin(),
+					     enabled_channels.end(),
+					     [&](struct iio_channel *chn) {
+			return dev == iio_channel_get_device(chn) &&
+				isStreamed(chn);
+		});
+
+		if (streamed != enabled_channels.end()) {
+			try {
+				startStreaming(dev, *streamed);
+			} catch (std::runtime_error&) {
+				/* Leave the device as it was */
+				for (unsigned int i = 0; i < nb; i++) {
+					struct iio_channel *chn =
+						iio_device_get_channel(dev, i);
+
+					if (was_enabled[i]) {
+						iio_channel_enable(chn);
+					} else {
+						iio_channel_disable(chn);
+					}
+				}
+
+				iio_device_attr_write_bool(dev, "dma_sync",
+							   was_dma_sync);
+				throw;
+			}
+
+			for (int i = enabled_channels.size() - 1; i >= 0; i--) {
+				if (dev == iio_channel_get_device(
+						enabled_channels[i])) {
+					enabled_channels.remove(i);
+				}
+			}
+			continue;
+		}
+
 		double best_rate = get_best_sample_rate(dev);
 		size_t samples_count = get_samples_count(dev, best_rate);
 
@@ -1327,11 +1421,8 @@ void SignalGenerator::start()
 
 			enabled_channels.remove(enabled_channels.indexOf(each));
 
-			top_block = gr::make_top_block("Signal Generator");
-
 			void *ptr = iio_channel_get_data(each);
 			QWidget *w = static_cast<QWidget *>(ptr);
-			auto source = getSource(w, best_rate, top_block);
 			float volts_to_raw_coef;
 			double vlsb = 1;
 			double corr = 1; // interpolation correction
@@ -1359,6 +1450,21 @@ void SignalGenerator::start()
 			// instead of 12 bit(data is shifted to the left)
 			// Divide by corr when interpolation is used
 			volts_to_raw_coef = (-1 * (1 / vlsb) * 16) / corr;
+
+			/* Waveforms with a closed form are rendered directly */
+			auto raw = renderRaw(*getData(w), best_rate, samples_count,
+					     dac->vOutL(), dac->vOutH(),
+					     volts_to_raw_coef);
+
+			if (raw) {
+				iio_channel_write(each, buf, raw->data(),
+						  samples_count * sizeof(short));
+				continue;
+			}
+
+			top_block = gr::make_top_block("Signal Generator");
+
+			auto source = getSource(w, best_rate, top_block);
 			auto f2s = blocks::float_to_short::make(1,
 			                                        volts_to_raw_coef);
 			auto head = blocks::head::make(
@@ -1403,10 +1509,109 @@ void SignalGenerator::start()
 
 		iio_device_attr_write_bool(dev, "dma_sync", false);
 	}
+
+	for (auto streamer : streamers) {
+		const struct iio_device *dev = iio_channel_get_device(
+				streamer->channel());
+
+		iio_device_attr_write_bool(dev, "dma_sync", false);
+	}
+}
+
+bool SignalGenerator::isStreamed(struct iio_channel *chn)
+{
+	QWidget *w = static_cast<QWidget *>(iio_channel_get_data(chn));
+	auto ptr = getData(w);
+
+	return ptr->type == SIGNAL_TYPE_BUFFER && ptr->file_streamed &&
+		ptr->file_type != FORMAT_NO_FILE;
+}
+
+void SignalGenerator::startStreaming(const struct iio_device *dev,
+		struct iio_channel *chn)
+{
+	QWidget *w = static_cast<QWidget *>(iio_channel_get_data(chn));
+	auto ptr = getData(w);
+	unsigned long final_rate;
+	unsigned long oversampling;
+	double vlsb = 1;
+	double corr = 1;
+
+	/* The other channels of the device stay disabled */
+	for (unsigned int i = 0; i < iio_device_get_channels_count(dev); i++) {
+		struct iio_channel *each = iio_device_get_channel(dev, i);
+
+		if (each != chn) {
+			iio_channel_disable(each);
+		}
+	}
+
+	/* Files without a sample rate use the one set in the UI */
+	double rate = get_forced_sample_rate(dev);
+	if (rate == 0) {
+		rate = ptr->file_sr ? ptr->file_sr : fileSampleRate->value();
+	}
+	if (rate == 0) {
+		throw std::runtime_error("Unable to stream file");
+	}
+
+	calc_sampling_params(dev, rate, final_rate, oversampling);
+
+	auto pair_it = std::find_if(channel_dac.begin(), channel_dac.end(),
+				    [&chn](const QPair<struct iio_channel *,
+	std::shared_ptr<GenericDac>>& element) {
+		return element.first == chn;
+	});
+
+	if (pair_it == channel_dac.end()) {
+		throw std::runtime_error("Unable to stream file");
+	}
+
+	std::shared_ptr<GenericDac> dac = (*pair_it).second;
+	vlsb = dac->vlsb();
+
+	auto m2k_dac = std::dynamic_pointer_cast<M2kDac>(dac);
+	if (m2k_dac) {
+		corr = m2k_dac->compTable(final_rate);
+	}
+
+	float volts_to_raw_coef = (-1 * (1 / vlsb) * 16) / corr;
+
+	if (iio_device_find_attr(dev, "oversampling_ratio")) {
+		iio_device_attr_write_longlong(dev,
+		                               "oversampling_ratio", oversampling);
+	}
+
+	iio_device_attr_write_longlong(dev, "sampling_frequency",
+	                               final_rate);
+
+	SampleFileReader *reader = SampleFileReader::create(*ptr);
+	if (!reader) {
+		throw std::runtime_error("Unable to open file for streaming");
+	}
+
+	auto streamer = new DacFileStreamer(chn, reader,
+			ptr->file_amplitude, ptr->file_offset, ptr->file_phase,
+			dac->vOutL(), dac->vOutH(), volts_to_raw_coef);
+
+	if (!streamer->start()) {
+		delete streamer;
+		throw std::runtime_error("Unable to create buffer");
+	}
+
+	qDebug(CAT_SIGNAL_GENERATOR) << QString("Streaming %1 at %2 SPS")
+		.arg(ptr->file).arg(final_rate);
+
+	streamers.append(streamer);
 }
 
 void SignalGenerator::stop()
 {
+	for (auto each : streamers) {
+		delete each;
+	}
+
+	streamers.clear();
 
 	for (auto each : buffers) {
 		iio_buffer_destroy(each);
@@ -1510,6 +1715,154 @@ basic_block_sptr SignalGenerator::getSignalSource(gr::top_block_sptr top,
 
 }
 
+bool SignalGenerator::getWaveformParams(const signal_generator_data& data,
+		double phase_correction, waveform_params& params)
+{
+	double phase;
+
+	switch (data.type) {
+	case SIGNAL_TYPE_CONSTANT:
+		params.shape = SYNTH_CONSTANT;
+		params.offset = data.constant;
+		break;
+
+	case SIGNAL_TYPE_WAVEFORM:
+		params.frequency = data.frequency;
+		params.amplitude = data.amplitude / 2.0;
+		params.offset = data.offset;
+
+		/* Same phase conventions as getSignalSource() */
+		phase = data.phase + phase_correction;
+
+		if (data.waveform == SG_TRI_WAVE) {
+			phase = std::fmod(phase + 90.0, 360.0);
+		} else if (data.waveform == SG_SQR_WAVE) {
+			phase = std::fmod(phase + 180.0, 360.0);
+		} else if (phase < 0) {
+			phase = phase + 360.0;
+		}
+
+		params.phase = phase * 0.01745329;
+		params.shape = SYNTH_TRAPEZOID;
+		params.holdh = params.holdl = 0;
+
+		switch (data.waveform) {
+		case SG_SIN_WAVE:
+			params.shape = SYNTH_SINE;
+			break;
+		case SG_SQR_WAVE:
+			params.rise = params.fall = 0;
+			params.holdh = data.dutycycle / 100.0;
+			params.holdl = 1.0 - data.dutycycle / 100.0;
+			break;
+		case SG_TRI_WAVE:
+			params.rise = params.fall = 1;
+			break;
+		case SG_SAW_WAVE:
+			params.rise = 1;
+			params.fall = 0;
+			break;
+		case SG_INV_SAW_WAVE:
+			params.rise = 0;
+			params.fall = 1;
+			break;
+		case SG_TRA_WAVE:
+			params.rise = data.rise;
+			params.fall = data.fall;
+			params.holdh = data.holdh;
+			params.holdl = data.holdl;
+			break;
+		default:
+			return false;
+		}
+		break;
+
+	default:
+		/* Files and math functions still go through GNU Radio */
+		return false;
+	}
+
+	params.noise_type = (int) data.noiseType;
+	params.noise_amplitude = data.noiseAmplitude;
+
+	return true;
+}
+
+WaveformCache<short>::buffer_sptr SignalGenerator::renderRaw(
+		const signal_generator_data& data, double sample_rate,
+		size_t nb_samples, float low, float high, float coef)
+{
+	WaveformCache<short>::key key;
+
+	if (!getWaveformParams(data, 0.0, key.params)) {
+		return WaveformCache<short>::buffer_sptr();
+	}
+
+	key.sample_rate = sample_rate;
+	key.nb_samples = nb_samples;
+	key.low = low;
+	key.high = high;
+	key.coef = coef;
+
+	auto cached = raw_cache.find(key);
+	if (cached) {
+		return cached;
+	}
+
+	QElapsedTimer timer;
+	timer.start();
+
+	std::vector<float> volts(nb_samples);
+	auto raw = std::make_shared<std::vector<short>>(nb_samples);
+
+	WaveformSynth::generate(key.params, sample_rate,
+				volts.data(), nb_samples);
+	if (key.params.has_noise()) {
+		WaveformSynth::addNoise(key.params, volts.data(),
+					nb_samples, rand());
+	}
+	WaveformSynth::toRaw(volts.data(), raw->data(), nb_samples,
+			     low, high, coef);
+
+	qDebug(CAT_SIGNAL_GENERATOR) << "Rendered" << nb_samples
+		<< "samples in" << timer.nsecsElapsed() / 1000 << "us";
+
+	raw_cache.insert(key, raw);
+	return raw;
+}
+
+WaveformCache<float>::buffer_sptr SignalGenerator::renderPreview(
+		const signal_generator_data& data, double sample_rate,
+		size_t nb_samples, double phase_correction)
+{
+	WaveformCache<float>::key key;
+
+	if (!getWaveformParams(data, phase_correction, key.params)) {
+		return WaveformCache<float>::buffer_sptr();
+	}
+
+	key.sample_rate = sample_rate;
+	key.nb_samples = nb_samples;
+	key.low = key.high = key.coef = 0;
+
+	auto cached = preview_cache.find(key);
+	if (cached) {
+		return cached;
+	}
+
+	auto samples = std::make_shared<std::vector<float>>(nb_samples);
+
+	WaveformSynth::generate(key.params, sample_rate,
+				samples->data(), nb_samples);
+	if (key.params.has_noise()) {
+		WaveformSynth::addNoise(key.params, samples->data(),
+					nb_samples, rand());
+	}
+
+	preview_cache.insert(key, samples);
+	return samples;
+}
+
 void SignalGenerator::loadFileChannelData(QWidget *obj)
 {
 	auto ptr = getData(obj);
@@ -1527,6 +1880,29 @@ void SignalGenerator::loadFileChannelData(QWidget *obj)
 			return;
 		}
 
+		/* Only the part that fits in the DAC memory is needed for
+		 * the preview of a streamed file */
+		if (ptr->file_streamed) {
+			std::unique_ptr<SampleFileReader> reader(
+					SampleFileReader::create(*ptr));
+
+			size_t max_samples = 0;
+
+			for (auto ch : channel_dac) {
+				if (ch.first == ptr->iio_ch) {
+					max_samples = ch.second->maxNumberOfSamples();
+				}
+			}
+
+			if (reader) {
+				ptr->file_data.resize(max_samples);
+				ptr->file_data.resize(reader->read(
+						ptr->file_data.data(),
+						ptr->file_data.size()));
+			}
+			return;
+		}
+
 		for (auto x : fileManager->read(ptr->file_channel)) {
 			ptr->file_data.push_back(x);
 		}
@@ -1675,33 +2051,22 @@ gr::basic_block_sptr SignalGenerator::getSource(QWidget *obj,
 			top->connect(add,0,phase_skip,0);
 
 			if (preview) {
-				auto ratio = sample_rate/ptr->file_sr;
-				long m,n;
-				bool ok=false;
-				for(auto precision=8;precision<2048;precision<<=1)
-				{
-					reduceFraction(ratio,&m,&n,precision);
-					if(m!=0 && n!=0)
-					{
-						ok=true;
-						break;
-					}
-				}
-				if(!ok)
-				{
+				double ratio = sample_rate/ptr->file_sr;
+
+				if (!std::isfinite(ratio) || ratio <= 0.0) {
 					return blocks::nop::make(sizeof(float));
 				}
 
+				const std::vector<float>& taps = resamplerTaps(ratio);
+				auto resampler = filter::pfb_arb_resampler_fff::make(
+						ratio, taps, RESAMPLER_NB_FILTERS);
 
-				auto interp= blocks::repeat::make(sizeof(float),m);
-				auto decim=blocks::keep_one_in_n::make(sizeof(float),n);
 				// Special noise handling for buffer previewer.
 				// Add noise before resampling, so noise is applied on buffered
 				// samples not displayed samples
 				top->connect(noiseSrc,0,noiseAdd,0);
 				top->connect(phase_skip,0,noiseAdd,1);
-				top->connect(noiseAdd,0,interp,0);
-				top->connect(interp,0,decim,0);
+				top->connect(noiseAdd,0,resampler,0);
 
 				double buffer_freq = 1;
 				if (ptr->file_nr_of_samples.size() > 0) {
@@ -1711,8 +2076,13 @@ gr::basic_block_sptr SignalGenerator::getSource(QWidget *obj,
 				int full_periods=(int)((double)zoomT1OnScreen * buffer_freq);
 				double phase_in_time = zoomT1OnScreen - (full_periods/buffer_freq);
 				unsigned long samples_to_skip = phase_in_time * samp_rate;
+
+				// Compensate the group delay of the resampler
+				size_t taps_per_filter = taps.size() / RESAMPLER_NB_FILTERS;
+				samples_to_skip += std::lround((taps_per_filter - 1) / 2.0 * ratio);
+
 				auto skip = blocks::skiphead::make(sizeof(float),samples_to_skip);
-				top->connect(decim,0,skip,0);
+				top->connect(resampler,0,skip,0);
 				// return before readding the noise.
 				return skip;
 			} else {
@@ -2118,14 +2488,37 @@ void SignalGenerator::calc_sampling_params(const iio_device *dev,
 	}
 }
 
-void SignalGenerator::reduceFraction(double input, long *numerator, long *denominator, long precision)
+const std::vector<float>& SignalGenerator::resamplerTaps(double ratio)
 {
-    double integral = std::floor(input);
-    double frac = input - integral;
-    long gcd_ = gcd(round(frac * precision), precision);
+	auto it = resampler_taps.find(ratio);
+
+	if (it != resampler_taps.end()) {
+		return it->second;
+	}
+
+	if (resampler_taps.size() >= RESAMPLER_CACHE_SIZE) {
+		resampler_taps.clear();
+	}
+
+	/* The filter bank runs at RESAMPLER_NB_FILTERS times the file rate;
+	 * when decimating, the cutoff follows the output rate. The
+	 * transition band is kept wide enough to bound the number of taps
+	 * per filter for very large decimation ratios. */
+	double rate = std::min(ratio, 1.0);
+	double cutoff = RESAMPLER_BW * rate;
+	double transition = std::max(RESAMPLER_TB * rate,
+			RESAMPLER_ATTENUATION / (22.0 * RESAMPLER_MAX_TAPS));
+
+	std::vector<float> taps = filter::firdes::low_pass_2(
+			RESAMPLER_NB_FILTERS, RESAMPLER_NB_FILTERS,
+			cutoff, transition, RESAMPLER_ATTENUATION,
+			filter::firdes::WIN_BLACKMAN);
+
+	/* Pad the prototype to a multiple of the number of filters */
+	taps.resize((taps.size() + RESAMPLER_NB_FILTERS - 1) /
+		    RESAMPLER_NB_FILTERS * RESAMPLER_NB_FILTERS, 0.0f);
 
-    *denominator = precision / gcd_;
-    *numerator = (round(frac * precision) / gcd_) + ((long)integral*(*denominator));
+	return resampler_taps.insert(std::make_pair(ratio, taps)).first->second;
 }
 
 size_t SignalGenerator::gcd(size_t a, size_t b)
@@ -32,6 +32,8 @@
 #include <QQueue>
 #include <QSharedPointer>
 
+#include <map>
+
 #include "apiObject.hpp"
 #include "filter.hpp"
 #include "oscilloscope_plot.hpp"
@@ -39,6 +41,7 @@
 #include "tool.hpp"
 #include "hw_dac.h"
 #include "filemanager.h"
+#include "waveform_synth.hpp"
 
 #include "gnuradio/analog/noise_type.h"
 
@@ -62,6 +65,7 @@ class SignalGenerator_API;
 class GenericDac;
 class ChannelWidget;
 class PhaseSpinButton;
+class DacFileStreamer;
 class PositionSpinButton;
 class ScaleSpinButton;
 
@@ -178,16 +182,24 @@ private:
 	QQueue<QPair<int, bool>> menuButtonActions;
 
 	QVector<struct iio_buffer *> buffers;
+	QVector<DacFileStreamer *> streamers;
 	QVector<ChannelWidget *> channels;
 	QVector<QPair<struct iio_channel *,
 		        std::shared_ptr<adiscope::GenericDac>>> channel_dac;
 
+	WaveformCache<short> raw_cache;
+	WaveformCache<float> preview_cache;
+	std::map<double, std::vector<float>> resampler_taps;
+
 	QSharedPointer<signal_generator_data> getData(QWidget *obj);
 	QSharedPointer<signal_generator_data> getCurrentData();
 	void renameConfigPanel();
 
 	void start();
 	void stop();
+	void startStreaming(const struct iio_device *dev,
+			    struct iio_channel *chn);
+	bool isStreamed(struct iio_channel *chn);
 	void resetZoom();
 
 	void updatePreview();
@@ -201,12 +213,24 @@ private:
 		double sample_rate,
 	        struct signal_generator_data& data, double phase_correction=0.0);
 
+	bool getWaveformParams(const struct signal_generator_data& data,
+			       double phase_correction,
+			       struct waveform_params& params);
+	WaveformCache<short>::buffer_sptr renderRaw(
+			const struct signal_generator_data& data,
+			double sample_rate, size_t nb_samples,
+			float low, float high, float coef);
+	WaveformCache<float>::buffer_sptr renderPreview(
+			const struct signal_generator_data& data,
+			double sample_rate, size_t nb_samples,
+			double phase_correction = 0.0);
+
 	gr::basic_block_sptr getNoise(QWidget *obj,gr::top_block_sptr top);
 	gr::basic_block_sptr getSource(QWidget *obj,
 				       double sample_rate,
 	                               gr::top_block_sptr top, bool     phase_correction=false);
 
-	static void reduceFraction(double input,long *numerator, long *denominator, long precision=1000000);
+	const std::vector<float>& resamplerTaps(double ratio);
 	static size_t gcd(size_t a, size_t b);
 	static size_t lcm(size_t a, size_t b);
 	static int sg_waveform_to_idx(enum sg_waveform wave);
@@ -319,6 +343,7 @@ struct signal_generator_data {
 	QString file_message;
 	QStringList file_channel_names;
 	enum sg_file_format file_type;
+	bool file_streamed; // too big for the DAC memory, streamed from disk
 	wav_header_t file_wav_hdr;
 	//bool file_loaded;
 	// SIGNAL_TYPE_MATH
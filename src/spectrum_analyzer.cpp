@@ -45,6 +45,8 @@
 #include "channel_widget.hpp"
 #include "db_click_buttons.hpp"
 #include "filemanager.h"
+#include "capture_file.hpp"
+#include "export_service.hpp"
 #include "spectrum_analyzer_api.hpp"
 
 /* Generated UI */
@@ -153,6 +155,7 @@ SpectrumAnalyzer::SpectrumAnalyzer(struct iio_context *ctx, Filter *filt,
 	}
 
 	ui->setupUi(this);
+	exporter = new ExportService(this);
 	// Temporarily disable the delta marker button
 	ui->pushButton_4->hide();
 
@@ -443,31 +446,81 @@ void SpectrumAnalyzer::on_btnExport_clicked()
 	export_dialog->setFileMode( QFileDialog::AnyFile );
 	export_dialog->setAcceptMode( QFileDialog::AcceptSave );
 	export_dialog->setNameFilters({"Comma-separated values files (*.csv)",
-					       "Tab-delimited values files (*.txt)"});
+					       "Tab-delimited values files (*.txt)",
+					       "Scopy capture files (*.npz)"});
 
-	if (export_dialog->exec()) {
-		FileManager fm("Spectrum Analyzer");
-		fm.open(export_dialog->selectedFiles().at(0), FileManager::EXPORT);
+	if (!export_dialog->exec())
+		return;
 
-		QVector<double> frequency_data;
-		int nr_samples = fft_plot->Curve(0)->data()->size();
-		for (int i = 0; i < nr_samples; ++i) {
-			frequency_data.push_back(fft_plot->Curve(0)->sample(i).x());
-		}
+	if (exporter->isRunning()) {
+		qDebug(CAT_SPECTRUM_ANALYZER) << "An export is already running";
+		return;
+	}
 
-		fm.save(frequency_data, "Frequency(Hz)");
+	/* Snapshot of the traces; the file is written by the export service */
+	QString fileName = export_dialog->selectedFiles().at(0);
+	const bool capture = export_dialog->selectedNameFilter().contains("*.npz");
+	const int nr_samples = fft_plot->Curve(0)->data()->size();
+	QVector<double> frequency_data(nr_samples);
+	QVector<QVector<double>> columns;
+	QStringList names;
 
-		for (int i = 0; i < channels.size(); ++i) {
-			QVector<double> data;
-			for (int j = 0; j < nr_samples; ++j) {
-				data.push_back(fft_plot->Curve(i)->sample(j).y());
-			}
-			fm.save(data, "Amplitude CH" + QString::number(i + 1) + "(db)");
-		}
+	for (int i = 0; i < nr_samples; ++i)
+		frequency_data[i] = fft_plot->Curve(0)->sample(i).x();
 
-		fm.performWrite();
+	for (int i = 0; i < channels.size(); ++i) {
+		QVector<double> data(nr_samples);
+
+		for (int j = 0; j < nr_samples; ++j)
+			data[j] = fft_plot->Curve(i)->sample(j).y();
+
+		columns.push_back(data);
+		names.push_back("Amplitude CH" + QString::number(i + 1) + "(db)");
 	}
 
+	if (capture && !CaptureFileReader::isCaptureFile(fileName))
+		fileName += ".npz";
+
+	bool started = exporter->start([=](ExportService::Job& job) -> bool {
+		if (!capture) {
+			FileManager fm("Spectrum Analyzer");
+
+			fm.open(fileName, FileManager::EXPORT);
+			fm.save(frequency_data, "Frequency(Hz)");
+			fm.save(columns, names);
+
+			return fm.performWrite(&job);
+		}
+
+		CaptureFileWriter writer;
+		CaptureInfo info;
+
+		info.tool = "Spectrum Analyzer";
+		info.x_name = "Frequency(Hz)";
+		info.x = frequency_data;
+		info.channel_names = names;
+		info.gain.fill(1.0, columns.size());
+		info.offset.fill(0.0, columns.size());
+
+		std::vector<double> data(nr_samples * columns.size());
+		for (int i = 0; i < columns.size(); ++i)
+			for (int j = 0; j < nr_samples; ++j)
+				data[j * columns.size() + i] = columns[i][j];
+
+		if (!writer.open(fileName, info, CaptureFileWriter::FLOAT64,
+				 nr_samples) || !writer.write(data.data(), nr_samples))
+			return false;
+
+		job.addBytes(data.size() * sizeof(double));
+		job.reportProgress(nr_samples, nr_samples);
+
+		return writer.close();
+	});
+
+	if (started)
+		exporter->showProgress(this, fileName);
+	else
+		qDebug(CAT_SPECTRUM_ANALYZER) << "An export is already running";
 }
 
 void SpectrumAnalyzer::triggerRightMenuToggle(CustomPushButton *btn, bool checked)
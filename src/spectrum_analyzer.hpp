@@ -55,6 +55,7 @@ class SpectrumChannel;
 class Filter;
 class ChannelWidget;
 class DbClickButtons;
+class ExportService;
 }
 
 class QPushButton;
@@ -167,6 +168,7 @@ private:
 	QButtonGroup *settings_group;
 	QButtonGroup *channels_group;
 	FftDisplayPlot *fft_plot;
+	ExportService *exporter;
 
 	PositionSpinButton *range;
 	PositionSpinButton *top;
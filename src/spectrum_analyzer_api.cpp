@@ -66,6 +66,20 @@ QList<double> SpectrumChannel_API::freq() const
 	return frequency_data;
 }
 
+QByteArray SpectrumChannel_API::dataBuffer() const
+{
+	int i = sp->ch_api.indexOf(const_cast<SpectrumChannel_API*>(this));
+	if (i < 0)
+		return QByteArray();
+
+	return arrayBuffer(sp->fft_plot->Curve(i)->data());
+}
+
+QByteArray SpectrumChannel_API::freqBuffer() const
+{
+	return arrayBuffer(sp->fft_plot->Curve(0)->data(), true);
+}
+
 int SpectrumMarker_API::chId()
 {
 	return m_chid;
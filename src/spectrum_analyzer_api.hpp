@@ -77,6 +77,8 @@ class SpectrumChannel_API : public ApiObject
 	Q_PROPERTY(int averaging READ averaging WRITE setAveraging);
 	Q_PROPERTY(QList<double> data READ data STORED false)
 	Q_PROPERTY(QList<double> freq READ freq STORED false)
+	Q_PROPERTY(QByteArray data_buffer READ dataBuffer STORED false)
+	Q_PROPERTY(QByteArray freq_buffer READ freqBuffer STORED false)
 
 public:
 	explicit SpectrumChannel_API(SpectrumAnalyzer *sp,
@@ -97,6 +99,10 @@ public:
 	QList<double> data() const;
 	QList<double> freq() const;
 
+	/* Same as data and freq, as Float64Array buffers */
+	QByteArray dataBuffer() const;
+	QByteArray freqBuffer() const;
+
 private:
 	SpectrumAnalyzer *sp;
 	boost::shared_ptr<SpectrumChannel> spch;
@@ -43,6 +43,8 @@ class ToolLauncher;
 
 class Tool : public QWidget
 {
+	friend class ToolLauncher;
+
 	Q_OBJECT
 
 public:
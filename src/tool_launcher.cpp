@@ -37,11 +37,13 @@
 #include "user_notes.hpp"
 #include "external_script_api.hpp"
 #include "animationmanager.h"
+#include "trace.hpp"
 
 #include "ui_device.h"
 #include "ui_tool_launcher.h"
 
 #include <QDebug>
+#include <QElapsedTimer>
 #include <QtConcurrentRun>
 #include <QSignalTransition>
 #include <QMessageBox>
@@ -84,8 +86,11 @@ ToolLauncher::ToolLauncher(QString prevCrashDump, QWidget *parent) :
 	manual_calibration_enabled(false),
 	devices_btn_group(new QButtonGroup(this)),
 	selectedDev(nullptr),
-	m_use_decoders(true)
+	m_use_decoders(true),
+	eager_tools(false)
 {
+	TRACE_SCOPE("ToolLauncher::ToolLauncher");
+
 	if (!isatty(STDIN_FILENO))
 		notifier.setEnabled(false);
 
@@ -183,6 +188,13 @@ ToolLauncher::ToolLauncher(QString prevCrashDump, QWidget *parent) :
 	connect(toolMenu["Calibration"]->getToolBtn(), SIGNAL(clicked()), this,
 		SLOT(btnCalibration_clicked()));
 
+	/* A tool started from the menu is created when its button is
+	 * pressed, so that it sees the toggle which follows */
+	for (auto option : toolMenu) {
+		connect(option->getToolStopBtn(), &QPushButton::pressed,
+			[=]() { loadTool(option->getName()); });
+	}
+
 
 		//option background
 	connect(toolMenu["Oscilloscope"]->getToolBtn(), SIGNAL(toggled(bool)), this,
@@ -501,6 +513,8 @@ void ToolLauncher::saveSettings()
 
 void ToolLauncher::runProgram(const QString& program, const QString& fn)
 {
+	prepareScript();
+
 	QJSValue val = js_engine.evaluate(program, fn);
 
 	int ret = EXIT_SUCCESS;
@@ -524,6 +538,7 @@ void ToolLauncher::search()
 
 QVector<QString> ToolLauncher::searchDevices()
 {
+	TRACE_SCOPE("ToolLauncher::searchDevices");
 	struct iio_context_info **info;
 	unsigned int nb_contexts;
 	QVector<QString> uris;
@@ -1053,46 +1068,55 @@ void ToolLauncher::setButtonBackground(bool on)
 
 void ToolLauncher::btnOscilloscope_clicked()
 {
+	loadTool("Oscilloscope");
 	swapMenu(static_cast<QWidget *>(oscilloscope));
 }
 
 void ToolLauncher::btnSignalGenerator_clicked()
 {
+	loadTool("Signal Generator");
 	swapMenu(static_cast<QWidget *>(signal_generator));
 }
 
 void ToolLauncher::btnDMM_clicked()
 {
+	loadTool("Voltmeter");
 	swapMenu(static_cast<QWidget *>(dmm));
 }
 
 void ToolLauncher::btnPowerControl_clicked()
 {
+	loadTool("Power Supply");
 	swapMenu(static_cast<QWidget *>(power_control));
 }
 
 void ToolLauncher::btnLogicAnalyzer_clicked()
 {
+	loadTool("Logic Analyzer");
 	swapMenu(static_cast<QWidget *>(logic_analyzer));
 }
 
 void adiscope::ToolLauncher::btnPatternGenerator_clicked()
 {
+	loadTool("Pattern Generator");
 	swapMenu(static_cast<QWidget *>(pattern_generator));
 }
 
 void adiscope::ToolLauncher::btnNetworkAnalyzer_clicked()
 {
+	loadTool("Network Analyzer");
 	swapMenu(static_cast<QWidget *>(network_analyzer));
 }
 
 void adiscope::ToolLauncher::btnSpectrumAnalyzer_clicked()
 {
+	loadTool("Spectrum Analyzer");
 	swapMenu(static_cast<QWidget *>(spectrum_analyzer));
 }
 
 void adiscope::ToolLauncher::btnDigitalIO_clicked()
 {
+	loadTool("Digital IO");
 	swapMenu(static_cast<QWidget *>(dio));
 }
 
@@ -1331,9 +1355,59 @@ void adiscope::ToolLauncher::destroyContext()
 		dioManager = nullptr;
 	}
 
+	/* The tools never opened are disabled like the deleted ones */
+	for (const QString& name : toolFactories.keys())
+		toolMenu[name]->setDisabled(true);
+	toolFactories.clear();
+
 	toolList.clear();
 }
 
+void ToolLauncher::addToolFactory(const QString& name,
+				  const std::function<Tool *()>& factory)
+{
+	toolFactories[name] = factory;
+	toolMenu[name]->setDisabled(false);
+
+	if (eager_tools)
+		loadTool(name);
+}
+
+void ToolLauncher::loadTool(const QString& name)
+{
+	auto it = toolFactories.find(name);
+
+	if (it == toolFactories.end())
+		return;
+
+	const std::function<Tool *()> factory = it.value();
+	TRACE_SCOPE(name + " constructor");
+	QElapsedTimer timer;
+
+	toolFactories.erase(it);
+	timer.start();
+
+	Tool *tool = factory();
+	toolList.push_back(tool);
+
+	/* The tool loaded its own settings; apply the session on top */
+	if (!pathToFile.isEmpty()) {
+		QSettings session(pathToFile, QSettings::IniFormat);
+
+		tool->api->load(session);
+		tool->settingsLoaded();
+	}
+
+	qDebug(CAT_TOOL_LAUNCHER) << name << "created in"
+				  << timer.elapsed() << "ms";
+}
+
+void ToolLauncher::loadAllTools()
+{
+	for (const QString& name : toolFactories.keys())
+		loadTool(name);
+}
+
 bool ToolLauncher::loadDecoders(QString path)
 {
 	static bool srd_loaded = false;
@@ -1366,29 +1440,38 @@ void adiscope::ToolLauncher::calibrate()
 	if (!skip_calibration) {
 		ok=false;
 		calibrating=true;
-		auto old_dmm_text = toolMenu["Voltmeter"]->getToolBtn()->text();
-		auto old_osc_text = toolMenu["Oscilloscope"]->getToolBtn()->text();
-		auto old_siggen_text = toolMenu["Signal Generator"]->getToolBtn()->text();
-		auto old_spectrum_text = toolMenu["Spectrum Analyzer"]->getToolBtn()->text();
-		auto old_network_text = toolMenu["Network Analyzer"]->getToolBtn()->text();
-
-		toolMenu["Voltmeter"]->getToolBtn()->setText("Calibrating...");
-		toolMenu["Oscilloscope"]->getToolBtn()->setText("Calibrating...");
-		toolMenu["Signal Generator"]->getToolBtn()->setText("Calibrating...");
-		toolMenu["Spectrum Analyzer"]->getToolBtn()->setText("Calibrating...");
-		toolMenu["Network Analyzer"]->getToolBtn()->setText("Calibrating...");
-
-		if (calib->isInitialized()) {
-			calib->setHardwareInCalibMode();
-			ok = calib->calibrateAll();
-			calib->restoreHardwareFromCalibMode();
-		}
 
-		toolMenu["Voltmeter"]->getToolBtn()->setText(old_dmm_text);
-		toolMenu["Oscilloscope"]->getToolBtn()->setText(old_osc_text);
-		toolMenu["Signal Generator"]->getToolBtn()->setText(old_siggen_text);
-		toolMenu["Spectrum Analyzer"]->getToolBtn()->setText(old_spectrum_text);
-		toolMenu["Network Analyzer"]->getToolBtn()->setText(old_network_text);
+		/* A device calibrated recently, at about the same temperature,
+		 * is not calibrated again */
+		Calibration::cache_status cache = calib->loadCachedCalibration();
+
+		if (cache == Calibration::CACHE_VALID) {
+			ok = true;
+		} else {
+			auto old_dmm_text = toolMenu["Voltmeter"]->getToolBtn()->text();
+			auto old_osc_text = toolMenu["Oscilloscope"]->getToolBtn()->text();
+			auto old_siggen_text = toolMenu["Signal Generator"]->getToolBtn()->text();
+			auto old_spectrum_text = toolMenu["Spectrum Analyzer"]->getToolBtn()->text();
+			auto old_network_text = toolMenu["Network Analyzer"]->getToolBtn()->text();
+
+			toolMenu["Voltmeter"]->getToolBtn()->setText("Calibrating...");
+			toolMenu["Oscilloscope"]->getToolBtn()->setText("Calibrating...");
+			toolMenu["Signal Generator"]->getToolBtn()->setText("Calibrating...");
+			toolMenu["Spectrum Analyzer"]->getToolBtn()->setText("Calibrating...");
+			toolMenu["Network Analyzer"]->getToolBtn()->setText("Calibrating...");
+
+			if (calib->isInitialized()) {
+				calib->setHardwareInCalibMode();
+				ok = calib->calibrateAll();
+				calib->restoreHardwareFromCalibMode();
+			}
+
+			toolMenu["Voltmeter"]->getToolBtn()->setText(old_dmm_text);
+			toolMenu["Oscilloscope"]->getToolBtn()->setText(old_osc_text);
+			toolMenu["Signal Generator"]->getToolBtn()->setText(old_siggen_text);
+			toolMenu["Spectrum Analyzer"]->getToolBtn()->setText(old_spectrum_text);
+			toolMenu["Network Analyzer"]->getToolBtn()->setText(old_network_text);
+		}
 	}
 
 	calibrating=false;
@@ -1401,24 +1484,30 @@ void adiscope::ToolLauncher::calibrate()
 
 void adiscope::ToolLauncher::enableAdcBasedTools()
 {
+	TRACE_SCOPE("ToolLauncher::enableAdcBasedTools");
+
 	if (filter->compatible(TOOL_OSCILLOSCOPE)) {
-		oscilloscope = new Oscilloscope(ctx, filter, adc,
-						toolMenu["Oscilloscope"]->getToolStopBtn(),
-						&js_engine, this);
-		toolList.push_back(oscilloscope);
-		adc_users_group.addButton(toolMenu["Oscilloscope"]->getToolStopBtn());
-		connect(oscilloscope, &Oscilloscope::showTool, [=]() {
-			toolMenu["Oscilloscope"]->getToolBtn()->click();
+		addToolFactory("Oscilloscope", [=]() -> Tool * {
+			oscilloscope = new Oscilloscope(ctx, filter, adc,
+							toolMenu["Oscilloscope"]->getToolStopBtn(),
+							&js_engine, this);
+			adc_users_group.addButton(toolMenu["Oscilloscope"]->getToolStopBtn());
+			connect(oscilloscope, &Oscilloscope::showTool, [=]() {
+				toolMenu["Oscilloscope"]->getToolBtn()->click();
+			});
+			return oscilloscope;
 		});
 	}
 
 	if (filter->compatible(TOOL_DMM)) {
-		dmm = new DMM(ctx, filter, adc, toolMenu["Voltmeter"]->getToolStopBtn(),
-				&js_engine, this);
-		adc_users_group.addButton(toolMenu["Voltmeter"]->getToolStopBtn());\
-		toolList.push_back(dmm);
-		connect(dmm, &DMM::showTool, [=]() {
-			toolMenu["Voltmeter"]->getToolBtn()->click();
+		addToolFactory("Voltmeter", [=]() -> Tool * {
+			dmm = new DMM(ctx, filter, adc, toolMenu["Voltmeter"]->getToolStopBtn(),
+					&js_engine, this);
+			adc_users_group.addButton(toolMenu["Voltmeter"]->getToolStopBtn());
+			connect(dmm, &DMM::showTool, [=]() {
+				toolMenu["Voltmeter"]->getToolBtn()->click();
+			});
+			return dmm;
 		});
 	}
 
@@ -1428,6 +1517,8 @@ void adiscope::ToolLauncher::enableAdcBasedTools()
 		adc_users_group.addButton(toolMenu["Debugger"]->getToolStopBtn());
 		QObject::connect(debugger, &Debugger::newDebuggerInstance, this,
 				 &ToolLauncher::addDebugWindow);
+		QObject::connect(debugger, &Debugger::scriptAboutToRun, this,
+				 &ToolLauncher::prepareScript);
 	}
 
 	if (filter->compatible(TOOL_CALIBRATION)) {
@@ -1438,24 +1529,31 @@ void adiscope::ToolLauncher::enableAdcBasedTools()
 	}
 
 	if (filter->compatible(TOOL_SPECTRUM_ANALYZER)) {
-		spectrum_analyzer = new SpectrumAnalyzer(ctx, filter, adc,
-			toolMenu["Spectrum Analyzer"]->getToolStopBtn(),&js_engine, this);
-		toolList.push_back(spectrum_analyzer);
-		adc_users_group.addButton(toolMenu["Spectrum Analyzer"]->getToolStopBtn());
-		connect(spectrum_analyzer, &SpectrumAnalyzer::showTool, [=]() {
-			toolMenu["Spectrum Analyzer"]->getToolBtn()->click();
+		addToolFactory("Spectrum Analyzer", [=]() -> Tool * {
+			spectrum_analyzer = new SpectrumAnalyzer(ctx, filter, adc,
+				toolMenu["Spectrum Analyzer"]->getToolStopBtn(),&js_engine, this);
+			adc_users_group.addButton(toolMenu["Spectrum Analyzer"]->getToolStopBtn());
+			connect(spectrum_analyzer, &SpectrumAnalyzer::showTool, [=]() {
+				toolMenu["Spectrum Analyzer"]->getToolBtn()->click();
+			});
+			return spectrum_analyzer;
 		});
 	}
 
 	if (filter->compatible((TOOL_NETWORK_ANALYZER))) {
-		network_analyzer = new NetworkAnalyzer(ctx, filter, adc, dacs,
-			toolMenu["Network Analyzer"]->getToolStopBtn(), &js_engine, this);
-		adc_users_group.addButton(toolMenu["Network Analyzer"]->getToolStopBtn());
-		toolList.push_back(network_analyzer);
-		connect(network_analyzer, &NetworkAnalyzer::showTool, [=]() {
-			toolMenu["Network Analyzer"]->getToolBtn()->click();
+		addToolFactory("Network Analyzer", [=]() -> Tool * {
+			/* The buffer previewer shows the oscilloscope's data */
+			loadTool("Oscilloscope");
+
+			network_analyzer = new NetworkAnalyzer(ctx, filter, adc, dacs,
+				toolMenu["Network Analyzer"]->getToolStopBtn(), &js_engine, this);
+			adc_users_group.addButton(toolMenu["Network Analyzer"]->getToolStopBtn());
+			connect(network_analyzer, &NetworkAnalyzer::showTool, [=]() {
+				toolMenu["Network Analyzer"]->getToolBtn()->click();
+			});
+			network_analyzer->setOscilloscope(oscilloscope);
+			return network_analyzer;
 		});
-		network_analyzer->setOscilloscope(oscilloscope);
 	}
 
 	Q_EMIT adcToolsCreated();
@@ -1464,12 +1562,16 @@ void adiscope::ToolLauncher::enableAdcBasedTools()
 
 void adiscope::ToolLauncher::enableDacBasedTools()
 {
+	TRACE_SCOPE("ToolLauncher::enableDacBasedTools");
+
 	if (filter->compatible(TOOL_SIGNAL_GENERATOR)) {
-		signal_generator = new SignalGenerator(ctx, dacs, filter,
-			toolMenu["Signal Generator"]->getToolStopBtn(), &js_engine, this);
-		toolList.push_back(signal_generator);
-		connect(signal_generator, &SignalGenerator::showTool, [=]() {
-			toolMenu["Signal Generator"]->getToolBtn()->click();
+		addToolFactory("Signal Generator", [=]() -> Tool * {
+			signal_generator = new SignalGenerator(ctx, dacs, filter,
+				toolMenu["Signal Generator"]->getToolStopBtn(), &js_engine, this);
+			connect(signal_generator, &SignalGenerator::showTool, [=]() {
+				toolMenu["Signal Generator"]->getToolBtn()->click();
+			});
+			return signal_generator;
 		});
 	}
 	if (pathToFile != "") {
@@ -1483,6 +1585,7 @@ void adiscope::ToolLauncher::enableDacBasedTools()
 
 bool adiscope::ToolLauncher::switchContext(const QString& uri)
 {
+	TRACE_SCOPE("ToolLauncher::switchContext");
 	destroyContext();
 
 	if (uri.startsWith("ip:")) {
@@ -1493,6 +1596,7 @@ bool adiscope::ToolLauncher::switchContext(const QString& uri)
 	if (dev->infoPage()->ctx()) {
 		ctx = dev->infoPage()->ctx();
 	} else {
+		TRACE_SCOPE("iio_create_context_from_uri");
 		ctx = iio_create_context_from_uri(uri.toStdString().c_str());
 	}
 
@@ -1583,40 +1687,48 @@ bool adiscope::ToolLauncher::switchContext(const QString& uri)
 	}
 
 	if (filter->compatible(TOOL_DIGITALIO)) {
-		dio = new DigitalIO(ctx, filter, toolMenu["Digital IO"]->getToolStopBtn(),
-				dioManager, &js_engine, this);
-		toolList.push_back(dio);
-		connect(dio, &DigitalIO::showTool, [=]() {
-			toolMenu["Digital IO"]->getToolBtn()->click();
+		addToolFactory("Digital IO", [=]() -> Tool * {
+			dio = new DigitalIO(ctx, filter, toolMenu["Digital IO"]->getToolStopBtn(),
+					dioManager, &js_engine, this);
+			connect(dio, &DigitalIO::showTool, [=]() {
+				toolMenu["Digital IO"]->getToolBtn()->click();
+			});
+			return dio;
 		});
 	}
 
 
 	if (filter->compatible(TOOL_POWER_CONTROLLER)) {
-		power_control = new PowerController(ctx, toolMenu["Power Supply"]->getToolStopBtn(),
-				&js_engine, this);
-		toolList.push_back(power_control);
-		connect(power_control, &PowerController::showTool, [=]() {
-			toolMenu["Power Supply"]->getToolBtn()->click();
+		addToolFactory("Power Supply", [=]() -> Tool * {
+			power_control = new PowerController(ctx, toolMenu["Power Supply"]->getToolStopBtn(),
+					&js_engine, this);
+			connect(power_control, &PowerController::showTool, [=]() {
+				toolMenu["Power Supply"]->getToolBtn()->click();
+			});
+			return power_control;
 		});
 	}
 
 	if (filter->compatible(TOOL_LOGIC_ANALYZER)) {
-		logic_analyzer = new LogicAnalyzer(ctx, filter, toolMenu["Logic Analyzer"]->getToolStopBtn(),
-				&js_engine, this);
-		toolList.push_back(logic_analyzer);
-		connect(logic_analyzer, &LogicAnalyzer::showTool, [=]() {
-			toolMenu["Logic Analyzer"]->getToolBtn()->click();
+		addToolFactory("Logic Analyzer", [=]() -> Tool * {
+			logic_analyzer = new LogicAnalyzer(ctx, filter, toolMenu["Logic Analyzer"]->getToolStopBtn(),
+					&js_engine, this);
+			connect(logic_analyzer, &LogicAnalyzer::showTool, [=]() {
+				toolMenu["Logic Analyzer"]->getToolBtn()->click();
+			});
+			return logic_analyzer;
 		});
 	}
 
 
 	if (filter->compatible((TOOL_PATTERN_GENERATOR))) {
-		pattern_generator = new PatternGenerator(ctx, filter,
-				toolMenu["Pattern Generator"]->getToolStopBtn(), &js_engine,dioManager, this);
-		toolList.push_back(pattern_generator);
-		connect(pattern_generator, &PatternGenerator::showTool, [=]() {
-			toolMenu["Pattern Generator"]->getToolBtn()->click();
+		addToolFactory("Pattern Generator", [=]() -> Tool * {
+			pattern_generator = new PatternGenerator(ctx, filter,
+					toolMenu["Pattern Generator"]->getToolStopBtn(), &js_engine,dioManager, this);
+			connect(pattern_generator, &PatternGenerator::showTool, [=]() {
+				toolMenu["Pattern Generator"]->getToolBtn()->click();
+			});
+			return pattern_generator;
 		});
 	}
 
@@ -1648,6 +1760,13 @@ bool adiscope::ToolLauncher::switchContext(const QString& uri)
 	return true;
 }
 
+void ToolLauncher::prepareScript()
+{
+	/* Scripts expect the objects of all the tools */
+	eager_tools = true;
+	loadAllTools();
+}
+
 void ToolLauncher::hasText()
 {
 	QTextStream in(stdin);
@@ -1659,6 +1778,8 @@ void ToolLauncher::hasText()
 	unsigned int nb_closing_braces = js_cmd.count(QChar('}'));
 
 	if (nb_open_braces == nb_closing_braces) {
+		prepareScript();
+
 		QJSValue val = js_engine.evaluate(js_cmd);
 
 		if (val.isError()) {
@@ -1859,6 +1980,8 @@ void ToolLauncher::detachToolOnPosition(int position)
 {
 	for (const auto x : toolMenu)
 		if (x->getPosition() == position){
+			loadTool(x->getName());
+
 			if (x->getName() == "Oscilloscope")
 				oscilloscope->detached();
 			else if (x->getName() == "Digital IO")
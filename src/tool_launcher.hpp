@@ -33,6 +33,8 @@
 #include <info_widget.h>
 #include <QTextBrowser>
 
+#include <functional>
+
 #include "apiObject.hpp"
 #include "dmm.hpp"
 #include "filter.hpp"
@@ -138,6 +140,7 @@ private Q_SLOTS:
 	void enableDacBasedTools();
 
 	void hasText();
+	void prepareScript();
 
 	void btnDigitalIO_clicked();
 
@@ -183,6 +186,13 @@ private:
 	void setupAddPage();
 	void allowExternalScript(bool);
 
+	/* The tools are created on first use. The factory of an available
+	 * tool is kept until then, under the name of its menu option. */
+	void addToolFactory(const QString& name,
+			    const std::function<Tool *()>& factory);
+	void loadTool(const QString& name);
+	void loadAllTools();
+
 private:
 	Ui::ToolLauncher *ui;
 	struct iio_context *ctx;
@@ -194,6 +204,8 @@ private:
 
 	std::vector<DeviceWidget *> devices;
 	QVector<Tool*> toolList;
+	QMap<QString, std::function<Tool *()>> toolFactories;
+	bool eager_tools;
 
 	QTimer *search_timer, *alive_timer;
 	QFutureWatcher<QVector<QString>> watcher;
@@ -239,6 +239,9 @@ void ToolLauncher_API::save(const QString& file)
 {
 	QSettings settings(file, QSettings::IniFormat);
 
+	/* A session holds the state of all the tools */
+	tl->loadAllTools();
+
 	this->ApiObject::save(settings);
 
 	if (tl->notesPanel)
@@ -273,6 +276,8 @@ void ToolLauncher::addDebugWindow()
 			&js_engine, this);
 	QObject::connect(debug, &Debugger::newDebuggerInstance, this,
 			 &ToolLauncher::addDebugWindow);
+	QObject::connect(debug, &Debugger::scriptAboutToRun, this,
+			 &ToolLauncher::prepareScript);
 
 	window->setCentralWidget(debug);
 	window->resize(sizeHint());
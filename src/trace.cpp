@@ -0,0 +1,167 @@
+/*
+ * Copyright 2019 Analog Devices, Inc.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Radio; see the file LICENSE.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+
+#include "trace.hpp"
+#include "logging_categories.h"
+
+#include <QElapsedTimer>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QMap>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QThread>
+
+#include <algorithm>
+#include <atomic>
+#include <vector>
+
+using namespace adiscope;
+
+namespace {
+
+struct Event
+{
+	QByteArray name;
+	qint64 start, duration;	/* in us */
+	int thread;
+};
+
+std::atomic<bool> enabled(false);
+QMutex mutex;
+QElapsedTimer trace_clock;
+QString trace_file;
+std::vector<Event> events;
+QMap<Qt::HANDLE, int> threads;
+
+/* Called with the mutex held */
+int threadIndex()
+{
+	const Qt::HANDLE id = QThread::currentThreadId();
+	auto it = threads.find(id);
+
+	if (it == threads.end())
+		it = threads.insert(id, threads.size() + 1);
+
+	return it.value();
+}
+}
+
+void Trace::start(const QString& filename)
+{
+	QMutexLocker lock(&mutex);
+
+	trace_file = filename;
+	events.clear();
+	threads.clear();
+	threadIndex();
+	trace_clock.start();
+	enabled = true;
+}
+
+bool Trace::isEnabled()
+{
+	return enabled;
+}
+
+qint64 Trace::now()
+{
+	return trace_clock.nsecsElapsed() / 1000;
+}
+
+void Trace::complete(const QByteArray& name, qint64 start, qint64 duration)
+{
+	QMutexLocker lock(&mutex);
+	Event event = { name, start, duration, threadIndex() };
+
+	events.push_back(event);
+	qDebug(CAT_TRACE) << name.constData() << "took"
+			  << duration / 1000.0 << "ms";
+}
+
+void Trace::finish()
+{
+	if (!enabled)
+		return;
+
+	QMutexLocker lock(&mutex);
+	QJsonArray array;
+
+	enabled = false;
+
+	for (const Event& event : events) {
+		QJsonObject obj;
+
+		obj["name"] = QString::fromUtf8(event.name);
+		obj["cat"] = "scopy";
+		obj["ph"] = "X";
+		obj["ts"] = (double)event.start;
+		obj["dur"] = (double)event.duration;
+		obj["pid"] = 1;
+		obj["tid"] = event.thread;
+
+		array.append(obj);
+	}
+
+	QJsonObject root;
+	root["traceEvents"] = array;
+	root["displayTimeUnit"] = "ms";
+
+	QFile file(trace_file);
+	if (file.open(QIODevice::WriteOnly))
+		file.write(QJsonDocument(root).toJson(QJsonDocument::Compact));
+	else
+		qDebug(CAT_TRACE) << "Can't write" << trace_file;
+
+	/* The total time spent in each scope, longest first */
+	QMap<QByteArray, QPair<int, qint64>> totals;
+
+	for (const Event& event : events) {
+		totals[event.name].first++;
+		totals[event.name].second += event.duration;
+	}
+
+	QList<QByteArray> names = totals.keys();
+	std::sort(names.begin(), names.end(),
+		  [&](const QByteArray& a, const QByteArray& b) {
+		return totals[a].second > totals[b].second;
+	});
+
+	for (const QByteArray& name : names)
+		qDebug(CAT_TRACE) << name.constData() << ":"
+				  << totals[name].second / 1000.0 << "ms in"
+				  << totals[name].first << "call(s)";
+
+	events.clear();
+}
+
+void TraceScope::begin(const QString& name)
+{
+	this->name = name.toUtf8();
+	start = Trace::now();
+}
+
+TraceScope::~TraceScope()
+{
+	if (start >= 0 && Trace::isEnabled())
+		Trace::complete(name, start, Trace::now() - start);
+}
@@ -0,0 +1,88 @@
+/*
+ * Copyright 2019 Analog Devices, Inc.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Radio; see the file LICENSE.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+
+#ifndef TRACE_HPP
+#define TRACE_HPP
+
+#include <QByteArray>
+#include <QString>
+
+namespace adiscope {
+
+/*
+ * Records named scopes, mostly around the startup and the connection to
+ * a device, and writes them as Chrome trace events (chrome://tracing,
+ * Perfetto). Each scope is also logged in the "trace" category when it
+ * ends, and finish() logs a summary of the time spent in each scope.
+ *
+ * Nothing is recorded until start() is called; a disabled scope only
+ * costs the test of a flag and never builds its name.
+ */
+class Trace
+{
+public:
+	static void start(const QString& filename);
+
+	/* Writes the trace file and logs the summary */
+	static void finish();
+
+	static bool isEnabled();
+
+private:
+	friend class TraceScope;
+
+	static qint64 now();
+	static void complete(const QByteArray& name, qint64 start,
+			     qint64 duration);
+};
+
+class TraceScope
+{
+public:
+	/* name_func returns the name of the scope; it is only called when
+	 * tracing is enabled */
+	template <typename NameFunc>
+	explicit TraceScope(NameFunc name_func) :
+		start(-1)
+	{
+		if (Trace::isEnabled())
+			begin(name_func());
+	}
+
+	~TraceScope();
+
+private:
+	QByteArray name;
+	qint64 start;
+
+	void begin(const QString& name);
+};
+}
+
+#define TRACE_CONCAT_(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_(a, b)
+
+/* Traces the rest of the enclosing block. The name is only evaluated
+ * when tracing is enabled. */
+#define TRACE_SCOPE(name) \
+	adiscope::TraceScope TRACE_CONCAT(trace_scope_, __LINE__)( \
+		[&]() { return QString(name); })
+
+#endif /* TRACE_HPP */
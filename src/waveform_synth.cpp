@@ -0,0 +1,231 @@
+/*
+ * Copyright 2019 Analog Devices, Inc.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Radio; see the file LICENSE.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include "waveform_synth.hpp"
+
+#include <gnuradio/analog/noise_type.h>
+#include <volk/volk.h>
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+
+using namespace adiscope;
+
+/* Used as slope for segments of zero length, i.e. vertical edges */
+#define VERTICAL_SLOPE	1e12f
+
+const size_t WaveformSynth::block_size;
+
+waveform_params::waveform_params() :
+	shape(SYNTH_CONSTANT),
+	frequency(0), amplitude(0), offset(0), phase(0),
+	rise(0.5), holdh(0), fall(0.5), holdl(0),
+	noise_type(0), noise_amplitude(0)
+{
+}
+
+bool waveform_params::operator==(const waveform_params& other) const
+{
+	return shape == other.shape && frequency == other.frequency &&
+		amplitude == other.amplitude && offset == other.offset &&
+		phase == other.phase && rise == other.rise &&
+		holdh == other.holdh && fall == other.fall &&
+		holdl == other.holdl && noise_type == other.noise_type &&
+		noise_amplitude == other.noise_amplitude;
+}
+
+/* Position inside the period of the first sample of a block, in [0, 1) */
+static double block_start_position(double phase, double step, size_t first)
+{
+	double pos = phase / (2 * M_PI) + step * (double) first;
+
+	return pos - std::floor(pos);
+}
+
+void WaveformSynth::generate(const waveform_params& p, double sample_rate,
+		float *out, size_t n, size_t first)
+{
+	switch (p.shape) {
+	case SYNTH_SINE:
+		generateSine(p, sample_rate, out, n, first);
+		break;
+	case SYNTH_TRAPEZOID:
+		generateTrapezoid(p, sample_rate, out, n, first);
+		break;
+	case SYNTH_CONSTANT:
+	default:
+		std::fill(out, out + n, (float) p.offset);
+		break;
+	}
+}
+
+void WaveformSynth::generateSine(const waveform_params& p,
+		double sample_rate, float *out, size_t n, size_t first)
+{
+	const double step = p.frequency / sample_rate;
+	const float amplitude = p.amplitude;
+	const float offset = p.offset;
+	const float fstep = step;
+
+	for (size_t done = 0; done < n; done += block_size) {
+		const size_t len = std::min(block_size, n - done);
+		const float start = block_start_position(p.phase, step,
+				first + done);
+		float *dst = out + done;
+
+		/* No data dependencies between iterations: this loop is
+		 * unrolled into SIMD instructions by the compiler. */
+		for (size_t i = 0; i < len; i++) {
+			float x = start + fstep * (float) i;
+			x -= (float) (int) x;
+
+			/* Map to [-pi, pi), then fold to [-pi/2, pi/2] */
+			float t = (float) (2 * M_PI) * (x - 0.5f);
+			t = t > (float) M_PI_2 ? (float) M_PI - t : t;
+			t = t < (float) -M_PI_2 ? (float) -M_PI - t : t;
+
+			float t2 = t * t;
+			float s = t * (1.0f + t2 * (-1.0f / 6 + t2 * (1.0f / 120 +
+				t2 * (-1.0f / 5040 + t2 * (1.0f / 362880 +
+				t2 * (-1.0f / 39916800))))));
+
+			/* sin(2 * pi * x) = -sin(2 * pi * (x - 0.5)) */
+			dst[i] = offset - amplitude * s;
+		}
+	}
+}
+
+void WaveformSynth::generateTrapezoid(const waveform_params& p,
+		double sample_rate, float *out, size_t n, size_t first)
+{
+	const double step = p.frequency / sample_rate;
+	const double total = p.rise + p.holdh + p.fall + p.holdl;
+	const float fstep = step;
+	const float low = p.offset - p.amplitude;
+	const float span = 2 * p.amplitude;
+
+	if (total <= 0) {
+		std::fill(out, out + n, (float) p.offset);
+		return;
+	}
+
+	/* Segment boundaries, relative to the period */
+	const float rise = p.rise / total;
+	const float fall_start = (p.rise + p.holdh) / total;
+	const float fall_end = (p.rise + p.holdh + p.fall) / total;
+
+	/* The output level is min(up, down), clamped to [0, 1], where
+	 * up = x * up_slope + up_bias and down = (fall_end - x) * down_slope */
+	const float up_slope = rise > 0 ? 1.0f / rise : 0.0f;
+	const float up_bias = rise > 0 ? 0.0f : 1.0f;
+	const float down_slope = fall_end > fall_start ?
+		1.0f / (fall_end - fall_start) : VERTICAL_SLOPE;
+
+	for (size_t done = 0; done < n; done += block_size) {
+		const size_t len = std::min(block_size, n - done);
+		const float start = block_start_position(p.phase, step,
+				first + done);
+		float *dst = out + done;
+
+		for (size_t i = 0; i < len; i++) {
+			float x = start + fstep * (float) i;
+			x -= (float) (int) x;
+
+			float up = x * up_slope + up_bias;
+			float down = (fall_end - x) * down_slope;
+			float level = std::min(up, down);
+
+			level = std::max(0.0f, std::min(1.0f, level));
+			dst[i] = low + span * level;
+		}
+	}
+}
+
+void WaveformSynth::addNoise(const waveform_params& p, float *out, size_t n,
+		unsigned int seed)
+{
+	std::mt19937 gen(seed);
+	std::uniform_real_distribution<float> uniform(0.0f, 1.0f);
+	std::normal_distribution<float> gaussian(0.0f, 1.0f);
+	float limit = p.noise_amplitude / 2;
+	float divider;
+
+	/* Same scaling as the noise_source_f + rail_ff chain */
+	switch (p.noise_type) {
+	case gr::analog::GR_IMPULSE:
+		limit = p.noise_amplitude;
+		divider = 15;
+		break;
+	case gr::analog::GR_GAUSSIAN:
+		divider = 7;
+		break;
+	case gr::analog::GR_UNIFORM:
+		divider = 2;
+		break;
+	case gr::analog::GR_LAPLACIAN:
+		divider = 14;
+		break;
+	default:
+		return;
+	}
+
+	const float ampl = p.noise_amplitude / divider;
+
+	for (size_t i = 0; i < n; i++) {
+		float z;
+
+		switch (p.noise_type) {
+		case gr::analog::GR_UNIFORM:
+			z = 2.0f * uniform(gen) - 1.0f;
+			break;
+		case gr::analog::GR_GAUSSIAN:
+			z = gaussian(gen);
+			break;
+		case gr::analog::GR_LAPLACIAN:
+			z = uniform(gen) - 0.5f;
+			z = z > 0 ? -std::log(1.0f - 2 * z) :
+				std::log(1.0f + 2 * z);
+			break;
+		case gr::analog::GR_IMPULSE:
+		default:
+			z = -(float) M_SQRT2 * std::log(1.0f - uniform(gen));
+			z = std::fabs(z) <= 9.0f ? 0.0f : z;
+			break;
+		}
+
+		out[i] += std::max(-limit, std::min(limit, ampl * z));
+	}
+}
+
+void WaveformSynth::toRaw(const float *in, short *out, size_t n,
+		float low, float high, float coef)
+{
+	float tmp[block_size];
+
+	for (size_t done = 0; done < n; done += block_size) {
+		const size_t len = std::min(block_size, n - done);
+
+		for (size_t i = 0; i < len; i++) {
+			tmp[i] = std::max(low, std::min(high, in[done + i]));
+		}
+
+		volk_32f_s32f_convert_16i(out + done, tmp, coef, len);
+	}
+}
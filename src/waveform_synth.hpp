@@ -0,0 +1,159 @@
+/*
+ * Copyright 2019 Analog Devices, Inc.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Radio; see the file LICENSE.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef WAVEFORM_SYNTH_HPP
+#define WAVEFORM_SYNTH_HPP
+
+#include <cstddef>
+#include <list>
+#include <memory>
+#include <vector>
+
+namespace adiscope {
+
+enum synth_shape {
+	SYNTH_CONSTANT,
+	SYNTH_SINE,
+	SYNTH_TRAPEZOID,
+};
+
+/*
+ * Closed-form description of a periodic waveform.
+ *
+ * The trapezoid covers square, triangle, sawtooth and the user defined
+ * trapezoidal shape. A period is split in four segments, in this order:
+ * rise, hold high, fall, hold low. The segment lengths are relative and
+ * are normalized by their sum.
+ *
+ * The phase is expressed in radians, as for gr::analog::sig_source_f.
+ * Noise types use the values of gr::analog::noise_type_t; 0 means no
+ * noise.
+ */
+struct waveform_params {
+	enum synth_shape shape;
+	double frequency;
+	double amplitude;
+	double offset;
+	double phase;
+
+	double rise;
+	double holdh;
+	double fall;
+	double holdl;
+
+	int noise_type;
+	double noise_amplitude;
+
+	waveform_params();
+	bool operator==(const waveform_params& other) const;
+	bool has_noise() const { return noise_type != 0; }
+};
+
+/*
+ * Vectorizable waveform kernels writing straight into sample buffers,
+ * used in place of a sig_source_f -> rail_ff -> float_to_short flowgraph.
+ */
+class WaveformSynth
+{
+public:
+	/* Generate n samples, starting with sample index 'first' */
+	static void generate(const waveform_params& p, double sample_rate,
+			float *out, size_t n, size_t first = 0);
+
+	/* Add noise to an already generated waveform */
+	static void addNoise(const waveform_params& p, float *out, size_t n,
+			unsigned int seed);
+
+	/* Clamp to [low, high], scale by 'coef' and convert to raw DAC codes */
+	static void toRaw(const float *in, short *out, size_t n,
+			float low, float high, float coef);
+
+private:
+	static const size_t block_size = 1024;
+
+	static void generateSine(const waveform_params& p,
+			double sample_rate, float *out, size_t n, size_t first);
+	static void generateTrapezoid(const waveform_params& p,
+			double sample_rate, float *out, size_t n, size_t first);
+};
+
+/*
+ * Small LRU cache of rendered buffers. The key is the complete set of
+ * parameters a buffer was rendered with, so a hit can be pushed to the
+ * hardware or to the preview plot without generating it again.
+ */
+template <typename T>
+class WaveformCache
+{
+public:
+	struct key {
+		waveform_params params;
+		double sample_rate;
+		size_t nb_samples;
+		float low, high, coef;
+
+		bool operator==(const key& other) const
+		{
+			return params == other.params &&
+				sample_rate == other.sample_rate &&
+				nb_samples == other.nb_samples &&
+				low == other.low && high == other.high &&
+				coef == other.coef;
+		}
+	};
+
+	typedef std::shared_ptr<const std::vector<T>> buffer_sptr;
+
+	explicit WaveformCache(size_t capacity = 8) : capacity(capacity) {}
+
+	buffer_sptr find(const key& k)
+	{
+		for (auto it = entries.begin(); it != entries.end(); ++it) {
+			if (it->first == k) {
+				entries.splice(entries.begin(), entries, it);
+				return entries.front().second;
+			}
+		}
+
+		return buffer_sptr();
+	}
+
+	void insert(const key& k, buffer_sptr buffer)
+	{
+		/* Rendering noise is not deterministic; never cache it */
+		if (k.params.has_noise()) {
+			return;
+		}
+
+		entries.push_front(std::make_pair(k, buffer));
+
+		while (entries.size() > capacity) {
+			entries.pop_back();
+		}
+	}
+
+	void clear() { entries.clear(); }
+
+private:
+	size_t capacity;
+	std::list<std::pair<key, buffer_sptr>> entries;
+};
+}
+
+#endif /* WAVEFORM_SYNTH_HPP */